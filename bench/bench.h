@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// One measurement. Metrics ending in _per_second are better higher, all
+// others (ns_per_op) better lower.
+struct bench_result {
+    std::string name;
+    std::string metric;
+    double value = 0;
+    // Macro benchmarks: the metric at each thread count.
+    std::vector<std::pair<int, double>> scaling;
+};
+
+struct bench_options {
+    // Substring a benchmark name must contain to run.
+    std::string filter;
+    // Thread counts for scaling curves; the last one is reported as value.
+    std::vector<int> threads;
+    // Minimum time spent per microbenchmark.
+    double min_seconds = 0.2;
+    // Smaller macro scenes, for a quick check.
+    bool quick = false;
+
+    bool selected(const std::string& name) const { return filter.empty() || name.find(filter) != std::string::npos; }
+};
+
+// Keeps the compiler from discarding a computed value.
+template <typename T>
+inline void keep(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    volatile char sink = *reinterpret_cast<const volatile char*>(&value);
+    (void) sink;
+#endif
+}
+
+// Average time of op(), run in batches of batch until at least minSeconds
+// have passed, in nanoseconds per call divided by opsPerCall.
+template <typename F>
+double ns_per_op(double minSeconds, F&& op, int batch = 64, double opsPerCall = 1) {
+    using clock = std::chrono::steady_clock;
+    // One untimed batch to warm caches and branch predictors.
+    for (int i = 0; i < batch; i++) op();
+    uint64_t calls = 0;
+    auto start = clock::now();
+    double elapsed = 0;
+    do {
+        for (int i = 0; i < batch; i++) op();
+        calls += uint64_t(batch);
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < minSeconds);
+    return elapsed * 1e9 / (double(calls) * opsPerCall);
+}
+
+void run_micro_benchmarks(const bench_options& options, std::vector<bench_result>& results);
+void run_scene_benchmarks(const bench_options& options, std::vector<bench_result>& results);
+// Exhaustive correctness checks of fast paths against their reference;
+// too slow to run with every benchmark. Returns false on any mismatch.
+bool run_checks();
+
+// Largest resident set of the process so far, 0 where unknown.
+size_t peak_rss_bytes();
+
+bool write_bench_json(const std::string& path, const std::vector<bench_result>& results, const bench_options& options);
+// Reads back the results of write_bench_json, without scaling curves.
+std::optional<std::vector<bench_result>> read_bench_json(const std::string& path);
\ No newline at end of file
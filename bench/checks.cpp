@@ -0,0 +1,62 @@
+#include "bench.h"
+
+#include <image/encoding.h>
+#include <render/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdio>
+#include <span>
+#include <vector>
+
+namespace {
+
+// Every float bit pattern, NaNs and infinities included, through the table
+// (whole chunks take the SIMD path, 7-value spans the scalar tail) against
+// from_linear_scalar.
+uint64_t encoding_mismatches(const char* name, const color_encoding& encoding) {
+    encoding_table table(encoding);
+    if (!table.exact()) {
+        std::printf("%-36s inexact table, not used\n", name);
+        return 0;
+    }
+
+    constexpr uint64_t chunk = 1 << 20;
+    std::atomic<uint64_t> mismatches = 0;
+    std::atomic<uint64_t> firstMismatch = UINT64_MAX;
+    parallel_for(0, int64_t((uint64_t(1) << 32) / chunk), 1, [&](int64_t c) {
+        std::vector<float> in(chunk);
+        std::vector<uint8_t> expected(chunk), simd(chunk), tail(chunk);
+        for (uint64_t i = 0; i < chunk; i++)
+            in[i] = std::bit_cast<float>(uint32_t(uint64_t(c) * chunk + i));
+        encoding.from_linear_scalar(in, expected);
+        table.encode(in, simd);
+        for (size_t i = 0; i < chunk; i += 7) {
+            size_t n = std::min<size_t>(7, chunk - i);
+            table.encode(std::span(in).subspan(i, n), std::span(tail).subspan(i, n));
+        }
+        for (uint64_t i = 0; i < chunk; i++) {
+            if (simd[i] == expected[i] && tail[i] == expected[i]) continue;
+            mismatches++;
+            uint64_t pattern = uint64_t(c) * chunk + i, first = firstMismatch;
+            while (pattern < first && !firstMismatch.compare_exchange_weak(first, pattern)) {}
+        }
+    });
+
+    if (mismatches) {
+        std::printf("%-36s %llu mismatches, first at 0x%08llx\n", name, (unsigned long long) mismatches.load(),
+                    (unsigned long long) firstMismatch.load());
+    } else {
+        std::printf("%-36s all 2^32 patterns match\n", name);
+    }
+    return mismatches;
+}
+
+}
+
+bool run_checks() {
+    uint64_t failures = encoding_mismatches("check/linear_encoding_table", color_encoding{});
+    failures += encoding_mismatches("check/srgb_encoding_table", srgb_color_encoding{});
+    return failures == 0;
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "bench.h"
+
+#include <render/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+size_t peak_rss_bytes() {
+#if defined(__linux__)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return size_t(usage.ru_maxrss) * 1024;
+#elif defined(__APPLE__)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return size_t(usage.ru_maxrss);
+#endif
+    return 0;
+}
+
+static std::string quoted(const std::string& s) {
+    std::string result = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') result += '\\';
+        result += c;
+    }
+    return result + "\"";
+}
+
+bool write_bench_json(const std::string& path, const std::vector<bench_result>& results, const bench_options& options) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+    out.precision(9);
+    out << "{\n  \"version\": 1,\n  \"threads\": " << options.threads.back() << ",\n"
+        << "  \"peak_rss_bytes\": " << peak_rss_bytes() << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const bench_result& r = results[i];
+        out << "    {\"name\": " << quoted(r.name) << ", \"metric\": " << quoted(r.metric) << ", \"value\": " << r.value;
+        if (!r.scaling.empty()) {
+            out << ", \"scaling\": [";
+            for (size_t j = 0; j < r.scaling.size(); j++) {
+                out << (j ? ", " : "") << "{\"threads\": " << r.scaling[j].first << ", " << quoted(r.metric) << ": "
+                    << r.scaling[j].second << "}";
+            }
+            out << "]";
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return bool(out);
+}
+
+// Only needs to understand what write_bench_json writes: each result object
+// starts with its name, metric and value keys in that order.
+std::optional<std::vector<bench_result>> read_bench_json(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) return {};
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+
+    auto string_after = [&](const std::string& key, size_t& position) -> std::optional<std::string> {
+        size_t k = text.find("\"" + key + "\": \"", position);
+        if (k == std::string::npos) return {};
+        size_t begin = k + key.size() + 5, end = begin;
+        std::string value;
+        while (end < text.size() && text[end] != '"') {
+            if (text[end] == '\\') end++;
+            value += text[end++];
+        }
+        position = end;
+        return value;
+    };
+
+    std::vector<bench_result> results;
+    size_t position = text.find("\"results\"");
+    if (position == std::string::npos) return {};
+    while (true) {
+        std::optional<std::string> name = string_after("name", position);
+        if (!name) break;
+        std::optional<std::string> metric = string_after("metric", position);
+        if (!metric) return {};
+        size_t k = text.find("\"value\": ", position);
+        if (k == std::string::npos) return {};
+        bench_result result{*name, *metric, std::strtod(text.c_str() + k + 9, nullptr), {}};
+        results.push_back(std::move(result));
+        position = k;
+    }
+    return results;
+}
+
+static bool higher_is_better(const std::string& metric) {
+    return metric.size() > 11 && metric.compare(metric.size() - 11, 11, "_per_second") == 0;
+}
+
+int main(int argc, char** argv) {
+    bench_options options;
+    std::string output = "bench.json";
+    std::string baseline;
+    double tolerance = 0.1;
+    int maxThreads = int(std::max(1u, std::thread::hardware_concurrency()));
+    bool micro = true, scenes = true, checks = false;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--output") && i + 1 < argc) output = argv[++i];
+        else if (!std::strcmp(argv[i], "--baseline") && i + 1 < argc) baseline = argv[++i];
+        else if (!std::strcmp(argv[i], "--tolerance") && i + 1 < argc) tolerance = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc) options.filter = argv[++i];
+        else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) maxThreads = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--min-time") && i + 1 < argc) options.min_seconds = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--quick")) options.quick = true;
+        else if (!std::strcmp(argv[i], "--micro")) scenes = false;
+        else if (!std::strcmp(argv[i], "--scenes")) micro = false;
+        else if (!std::strcmp(argv[i], "--check")) checks = true;
+    }
+    // Scaling curves double the thread count up to the maximum.
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        options.threads.push_back(threads);
+    options.threads.push_back(maxThreads);
+
+    if (checks) {
+        init_thread_pool(maxThreads);
+        return run_checks() ? 0 : 1;
+    }
+
+    std::vector<bench_result> results;
+    // Microbenchmarks run on one thread; only the thread pool inside
+    // srgb_encode_table uses more.
+    init_thread_pool(maxThreads);
+    if (micro) run_micro_benchmarks(options, results);
+    if (scenes) run_scene_benchmarks(options, results);
+    std::printf("peak RSS: %.1f MB\n", double(peak_rss_bytes()) / (1 << 20));
+
+    if (!write_bench_json(output, results, options)) {
+        std::fprintf(stderr, "failed to write %s\n", output.c_str());
+        return 1;
+    }
+
+    if (baseline.empty()) return 0;
+    std::optional<std::vector<bench_result>> previous = read_bench_json(baseline);
+    if (!previous) {
+        std::fprintf(stderr, "failed to read %s\n", baseline.c_str());
+        return 1;
+    }
+    // Ratios are new over old, flipped for lower-is-better metrics so that
+    // above 1 is always faster.
+    int regressions = 0;
+    for (const bench_result& r : results) {
+        for (const bench_result& old : *previous) {
+            if (old.name != r.name || old.metric != r.metric || old.value <= 0 || r.value <= 0) continue;
+            double speedup = higher_is_better(r.metric) ? r.value / old.value : old.value / r.value;
+            bool regressed = speedup < 1 - tolerance;
+            regressions += regressed;
+            std::printf("%-36s %6.2fx%s\n", r.name.c_str(), speedup, regressed ? "  REGRESSION" : "");
+        }
+    }
+    return regressions ? 2 : 0;
+}
\ No newline at end of file
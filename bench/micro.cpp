@@ -0,0 +1,210 @@
+#include "bench.h"
+
+#include <camera/perspective.h>
+#include <image/image.h>
+#include <math/transform.h>
+#include <scene/scenes.h>
+#include <util/hash.h>
+
+#include <cstdio>
+#include <filesystem>
+
+namespace {
+
+float unit(uint64_t h) {
+    return float(h >> 40) * 0x1p-24f;
+}
+
+// Rays from a sphere of radius 3 towards random points inside the unit
+// sphere, so most of them hit a unit sphere at the origin.
+std::vector<ray> probe_rays(size_t count) {
+    std::vector<ray> rays;
+    rays.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        uint64_t h = mix_bits(i);
+        vec3f from = normalize(vec3f(unit(h) - 0.5f, unit(mix_bits(h)) - 0.5f, unit(mix_bits(h + 1)) - 0.5f)) * 3.f;
+        vec3f to(unit(mix_bits(h + 2)) - 0.5f, unit(mix_bits(h + 3)) - 0.5f, unit(mix_bits(h + 4)) - 0.5f);
+        rays.push_back(ray{from, normalize(to - from)});
+    }
+    return rays;
+}
+
+}
+
+void run_micro_benchmarks(const bench_options& options, std::vector<bench_result>& results) {
+    auto run = [&](const std::string& name, auto&& measure) {
+        if (!options.selected(name)) return;
+        double ns = measure();
+        results.push_back({name, "ns_per_op", ns, {}});
+        std::printf("%-36s %10.2f ns/op\n", name.c_str(), ns);
+    };
+
+    constexpr size_t count = 1024;
+    std::vector<vec3f> points(count);
+    for (size_t i = 0; i < count; i++)
+        points[i] = vec3f(unit(mix_bits(3 * i)), unit(mix_bits(3 * i + 1)), unit(mix_bits(3 * i + 2))) * 2.f - vec3f(1.f);
+
+    run("micro/vec3_dot_cross_normalize", [&] {
+        size_t i = 0;
+        return ns_per_op(options.min_seconds, [&] {
+            vec3f a = points[i % count], b = points[(i + 1) % count];
+            vec3f c = normalize(cross(a, b)) * dot(a, b);
+            keep(c);
+            i++;
+        }, 1024);
+    });
+
+    transform t = translate(vec3f(1, 2, 3)) * rotate_y(30.f) * scale(vec3f(1.5f));
+    run("micro/matrix4_multiply", [&] {
+        matrix<4> m = t.get_matrix();
+        return ns_per_op(options.min_seconds, [&] {
+            m = m * t.get_matrix();
+            keep(m);
+        }, 1024);
+    });
+
+    run("micro/transform_apply_point", [&] {
+        size_t i = 0;
+        return ns_per_op(options.min_seconds, [&] {
+            vec3f p = t.apply(points[i++ % count]);
+            keep(p);
+        }, 1024);
+    });
+
+    run("micro/transform_apply_ray", [&] {
+        size_t i = 0;
+        return ns_per_op(options.min_seconds, [&] {
+            ray r = t.apply(ray{points[i % count], points[(i + 1) % count]});
+            keep(r);
+            i++;
+        }, 1024);
+    });
+
+    perspective_camera camera({800, 600}, 45.f, look_at(vec3f(0, 0, -5), vec3f(0.f), vec3f(0, 1, 0)));
+    run("micro/camera_generate_ray", [&] {
+        int i = 0;
+        return ns_per_op(options.min_seconds, [&] {
+            std::optional<ray> r = camera.generate_ray({vec2f(float(i % 800), float(i / 800 % 600))});
+            keep(r);
+            i++;
+        }, 1024);
+    });
+
+    run("micro/camera_generate_rays_packet", [&] {
+        std::array<camera_sample_ctx, packet_width> ctx;
+        for (int i = 0; i < packet_width; i++)
+            ctx[i] = {vec2f(float(i), 0.f)};
+        ray_packet rays;
+        return ns_per_op(options.min_seconds, [&] {
+            camera.generate_rays(ctx, rays);
+            keep(rays);
+        }, 256, packet_width);
+    });
+
+    std::shared_ptr<triangle_mesh> sphere = sphere_mesh(64);
+    std::vector<ray> rays = probe_rays(count);
+    run("micro/mesh_intersect", [&] {
+        size_t i = 0;
+        return ns_per_op(options.min_seconds, [&] {
+            std::optional<shape_isect> isect = sphere->intersect(rays[i++ % count]);
+            keep(isect);
+        }, 256);
+    });
+
+    run("micro/mesh_intersects", [&] {
+        size_t i = 0;
+        return ns_per_op(options.min_seconds, [&] {
+            bool hit = sphere->intersects(rays[i++ % count]);
+            keep(hit);
+        }, 256);
+    });
+
+    run("micro/mesh_intersect_packet", [&] {
+        size_t i = 0;
+        return ns_per_op(options.min_seconds, [&] {
+            ray_packet packet;
+            packet.active = 0;
+            for (int j = 0; j < packet_width; j++)
+                packet.set(j, rays[(i + j) % count]);
+            shape_isect_packet isects;
+            sphere->intersect(packet, isects);
+            keep(isects);
+            i += packet_width;
+        }, 64, packet_width);
+    });
+
+    std::shared_ptr<bvh_aggregate> grid = instance_grid(sphere, 1024);
+    run("micro/instance_grid_intersect", [&] {
+        vec3f center = grid->bounds().centroid();
+        float size = length(grid->bounds().diagonal());
+        size_t i = 0;
+        return ns_per_op(options.min_seconds, [&] {
+            vec3f target = center + points[i % count] * (0.5f * size);
+            target.z = center.z;
+            ray r{center - vec3f(0, 0, size), normalize(target - (center - vec3f(0, 0, size)))};
+            std::optional<shape_isect> isect = grid->intersect(r);
+            keep(isect);
+            i++;
+        }, 256);
+    });
+
+    std::vector<float> linear(size_t(800) * 600 * 3);
+    for (size_t i = 0; i < linear.size(); i++)
+        linear[i] = unit(mix_bits(i)) * 1.2f;
+    std::vector<uint8_t> encoded(linear.size());
+    srgb_color_encoding srgb;
+    run("micro/srgb_encode_table", [&] {
+        return ns_per_op(options.min_seconds, [&] {
+            srgb.from_linear(linear, encoded);
+            keep(encoded[0]);
+        }, 1, double(linear.size()));
+    });
+
+    run("micro/srgb_encode_scalar", [&] {
+        return ns_per_op(options.min_seconds, [&] {
+            srgb.from_linear_scalar(linear, encoded);
+            keep(encoded[0]);
+        }, 1, double(linear.size()));
+    });
+
+    // Sums 8x8 footprints of a large image at random positions, as a filter
+    // or texture lookup would, and whole render tiles at random tile
+    // positions, both through pixel().
+    const std::pair<const char*, image_layout> layouts[] = {
+        {"linear", image_layout::linear}, {"tiled", image_layout::tiled}, {"morton", image_layout::morton}};
+    constexpr int image_size = 2048;
+    for (auto [layoutName, layout] : layouts) {
+        auto sum_footprints = [&](int footprint, int step) {
+            image2d image({image_size, image_size}, color_encoding{}, layout);
+            std::fill(image.data().begin(), image.data().end(), 1.f);
+            int positions = (image_size - footprint) / step;
+            size_t i = 0;
+            return ns_per_op(options.min_seconds, [&] {
+                uint64_t h = mix_bits(i++);
+                vec2i origin(int(h % positions) * step, int((h >> 32) % positions) * step);
+                float sum = 0.f;
+                for (int y = 0; y < footprint; y++)
+                    for (int x = 0; x < footprint; x++)
+                        sum += image.pixel(origin + vec2i(x, y))[0];
+                keep(sum);
+            }, 256, double(footprint) * footprint);
+        };
+        run(std::string("micro/image_footprint_") + layoutName, [&] { return sum_footprints(8, 1); });
+        run(std::string("micro/image_render_tile_") + layoutName, [&] {
+            return sum_footprints(image_tile_size, image_tile_size);
+        });
+    }
+
+    run("micro/png_write_800x600", [&] {
+        image2d image({800, 600}, srgb_color_encoding{});
+        std::copy(linear.begin(), linear.end(), image.data().begin());
+        std::string path = (std::filesystem::temp_directory_path() / "renderer_bench.png").string();
+        double ns = ns_per_op(options.min_seconds, [&] {
+            bool ok = image.write_png(path);
+            keep(ok);
+        }, 1);
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return ns;
+    });
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "bench.h"
+
+#include <camera/perspective.h>
+#include <integrator/path.h>
+#include <light/light_tree.h>
+#include <render/renderer.h>
+#include <sampler/sobol.h>
+#include <scene/scenes.h>
+
+#include <atomic>
+#include <cstdio>
+#include <functional>
+
+namespace {
+
+struct canonical_scene {
+    scene world;
+    std::unique_ptr<camera> cam;
+    // Path traced with lighting, or primary rays only.
+    bool shaded = false;
+    int spp = 1;
+};
+
+transform view_of(const shape& geometry) {
+    bounds3f b = geometry.bounds();
+    vec3f center = b.centroid();
+    return look_at(center - vec3f(0, 0, 1.5f * length(b.diagonal())), center, vec3f(0, 1, 0));
+}
+
+// Rays per second to render the scene once on the current pool.
+double trace(const canonical_scene& s, vec2i resolution) {
+    render_options options;
+    options.spp = s.spp;
+    sobol_sampler sampler;
+    path_integrator integrator(s.world, *s.cam, s.spp);
+    std::atomic<uint64_t> rays = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    render_tiles(resolution, options, [&](const tile& tile) {
+        integrator_stats stats;
+        for (int y = tile.min.y; y < tile.max.y; y++) {
+            for (int x = tile.min.x; x < tile.max.x; x++) {
+                for (int i = 0; i < s.spp; i++) {
+                    std::optional<ray> r = s.cam->generate_ray(camera_sample(sampler, {x, y}, uint32_t(i), options));
+                    if (!r) continue;
+                    if (s.shaded) {
+                        vec3f L = integrator.li(*r, sampler, {x, y}, uint32_t(i), stats);
+                        keep(L);
+                    } else {
+                        stats.rays++;
+                        std::optional<shape_isect> isect = s.world.geometry->intersect(*r);
+                        keep(isect);
+                    }
+                }
+            }
+        }
+        rays += stats.rays + stats.shadow_rays;
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return double(rays) / seconds;
+}
+
+}
+
+void run_scene_benchmarks(const bench_options& options, std::vector<bench_result>& results) {
+    vec2i resolution = options.quick ? vec2i(160, 120) : vec2i(400, 300);
+    std::shared_ptr<triangle_mesh> sphere = sphere_mesh(64);
+
+    auto run = [&](const std::string& name, const std::function<canonical_scene()>& build) {
+        if (!options.selected(name)) return;
+        canonical_scene s = build();
+        bench_result result{name, "rays_per_second", 0, {}};
+        for (int threads : options.threads) {
+            init_thread_pool(threads);
+            // Best of two, the first of which also warms up the caches.
+            double raysPerSecond = std::max(trace(s, resolution), trace(s, resolution));
+            result.scaling.push_back({threads, raysPerSecond});
+            std::printf("%-36s %10.2f Mrays/s  (%d threads)\n", name.c_str(), raysPerSecond * 1e-6, threads);
+        }
+        result.value = result.scaling.back().second;
+        results.push_back(std::move(result));
+    };
+
+    // A single finely tessellated mesh seen by camera rays alone.
+    run("scene/primary_rays", [&] {
+        canonical_scene s;
+        s.world.geometry = sphere;
+        s.cam = std::make_unique<perspective_camera>(resolution, 45.f, view_of(*sphere));
+        return s;
+    });
+
+    // Diffuse interreflection between instances under sun and sky.
+    run("scene/diffuse_gi", [&] {
+        canonical_scene s;
+        s.world.geometry = instance_grid(sphere, 64);
+        s.world.distant_lights = {{normalize(vec3f(0.4f, 1.f, -0.6f)), vec3f(3.f)}};
+        s.world.sky = vec3f(0.3f, 0.4f, 0.55f);
+        s.cam = std::make_unique<perspective_camera>(resolution, 45.f, view_of(*s.world.geometry));
+        s.shaded = true;
+        s.spp = 4;
+        return s;
+    });
+
+    // Next-event estimation over a light tree.
+    run("scene/many_lights", [&] {
+        canonical_scene s;
+        s.world.geometry = light_field(s.world, options.quick ? 1000 : 10000);
+        s.world.light_sampling = std::make_shared<light_tree>(s.world.lights());
+        float size = s.world.geometry->bounds().diagonal().x;
+        s.cam = std::make_unique<perspective_camera>(
+            resolution, 45.f, look_at(vec3f(0, 0.25f * size, -0.55f * size), vec3f(0.f), vec3f(0, 1, 0)));
+        s.shaded = true;
+        s.spp = 2;
+        return s;
+    });
+
+    // Camera rays through a large two-level hierarchy.
+    run("scene/heavy_instancing", [&] {
+        canonical_scene s;
+        s.world.geometry = instance_grid(sphere, options.quick ? 10000 : 100000);
+        s.cam = std::make_unique<perspective_camera>(resolution, 45.f, view_of(*s.world.geometry));
+        return s;
+    });
+}
\ No newline at end of file
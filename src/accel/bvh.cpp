@@ -0,0 +1,587 @@
+#include "bvh.h"
+
+#include <render/thread_pool.h>
+#include <shape/dispatch.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+struct bvh_build_primitive {
+    bounds3f bounds;
+    vec3f centroid;
+    uint32_t index;
+};
+
+struct bvh_build_node {
+    bounds3f bounds;
+    std::unique_ptr<bvh_build_node> children[2];
+    uint32_t first = 0, count = 0;
+    int axis = 0;
+};
+
+struct bvh_bin {
+    bounds3f bounds;
+    uint32_t count = 0;
+};
+
+static constexpr int max_bins = 32;
+static constexpr int64_t parallel_reduce_chunk = 1 << 16;
+static constexpr uint32_t max_leaf_primitives = UINT16_MAX;
+
+struct bvh_builder {
+    std::span<bvh_build_primitive> primitives;
+    const bvh_build_options& options;
+    std::atomic<uint32_t> nodeCount{0};
+
+    void compute_bounds(std::span<bvh_build_primitive> prims, bounds3f& bounds, bounds3f& centroidBounds) {
+        if (prims.size() < 2 * parallel_reduce_chunk) {
+            for (const bvh_build_primitive& p : prims) {
+                bounds = union_of(bounds, p.bounds);
+                centroidBounds = union_of(centroidBounds, p.centroid);
+            }
+            return;
+        }
+
+        int64_t chunks = (int64_t(prims.size()) + parallel_reduce_chunk - 1) / parallel_reduce_chunk;
+        std::vector<bounds3f> chunkBounds(chunks), chunkCentroids(chunks);
+        parallel_for(0, chunks, 1, [&](int64_t c) {
+            size_t end = std::min(prims.size(), size_t(c + 1) * parallel_reduce_chunk);
+            for (size_t i = c * parallel_reduce_chunk; i < end; i++) {
+                chunkBounds[c] = union_of(chunkBounds[c], prims[i].bounds);
+                chunkCentroids[c] = union_of(chunkCentroids[c], prims[i].centroid);
+            }
+        });
+        for (int64_t c = 0; c < chunks; c++) {
+            bounds = union_of(bounds, chunkBounds[c]);
+            centroidBounds = union_of(centroidBounds, chunkCentroids[c]);
+        }
+    }
+
+    int bin_of(const bvh_build_primitive& p, const bounds3f& centroidBounds, int axis, int nBins) const {
+        int b = int(float(nBins) * centroidBounds.offset(p.centroid)[axis]);
+        return clamp(b, 0, nBins - 1);
+    }
+
+    void fill_bins(std::span<bvh_build_primitive> prims, const bounds3f& centroidBounds, int axis, int nBins,
+                   std::array<bvh_bin, max_bins>& bins) {
+        auto fill = [&](size_t begin, size_t end, std::array<bvh_bin, max_bins>& out) {
+            for (size_t i = begin; i < end; i++) {
+                bvh_bin& bin = out[bin_of(prims[i], centroidBounds, axis, nBins)];
+                bin.count++;
+                bin.bounds = union_of(bin.bounds, prims[i].bounds);
+            }
+        };
+
+        if (prims.size() < 2 * parallel_reduce_chunk) {
+            fill(0, prims.size(), bins);
+            return;
+        }
+
+        int64_t chunks = (int64_t(prims.size()) + parallel_reduce_chunk - 1) / parallel_reduce_chunk;
+        std::vector<std::array<bvh_bin, max_bins>> chunkBins(chunks);
+        parallel_for(0, chunks, 1, [&](int64_t c) {
+            fill(c * parallel_reduce_chunk, std::min(prims.size(), size_t(c + 1) * parallel_reduce_chunk), chunkBins[c]);
+        });
+        for (int64_t c = 0; c < chunks; c++) {
+            for (int b = 0; b < nBins; b++) {
+                bins[b].count += chunkBins[c][b].count;
+                bins[b].bounds = union_of(bins[b].bounds, chunkBins[c][b].bounds);
+            }
+        }
+    }
+
+    std::unique_ptr<bvh_build_node> make_leaf(uint32_t first, uint32_t count, const bounds3f& bounds) {
+        auto node = std::make_unique<bvh_build_node>();
+        node->bounds = bounds;
+        node->first = first;
+        node->count = count;
+        return node;
+    }
+
+    std::unique_ptr<bvh_build_node> build(uint32_t first, uint32_t count, int depth) {
+        nodeCount.fetch_add(1, std::memory_order_relaxed);
+        std::span<bvh_build_primitive> prims = primitives.subspan(first, count);
+
+        bounds3f bounds, centroidBounds;
+        compute_bounds(prims, bounds, centroidBounds);
+
+        if (count == 1) return make_leaf(first, count, bounds);
+
+        int axis = centroidBounds.max_extent();
+        uint32_t mid;
+        if (centroidBounds.pmax[axis] == centroidBounds.pmin[axis]) {
+            if (count <= max_leaf_primitives) return make_leaf(first, count, bounds);
+            mid = count / 2;
+        } else if (depth >= bvh::max_sah_depth) {
+            mid = count / 2;
+            std::nth_element(prims.begin(), prims.begin() + mid, prims.end(),
+                             [axis](const bvh_build_primitive& a, const bvh_build_primitive& b) {
+                                 return a.centroid[axis] < b.centroid[axis];
+                             });
+        } else {
+            int nBins = clamp(options.bins, 2, max_bins);
+            std::array<bvh_bin, max_bins> bins{};
+            fill_bins(prims, centroidBounds, axis, nBins, bins);
+
+            // Sweep from the right to get the cost of every split position
+            // in a single pass, relative to a primitive intersection.
+            std::array<float, max_bins - 1> costs{};
+            bounds3f above;
+            uint32_t countAbove = 0;
+            for (int b = nBins - 1; b >= 1; b--) {
+                above = union_of(above, bins[b].bounds);
+                countAbove += bins[b].count;
+                costs[b - 1] = float(countAbove) * above.surface_area();
+            }
+            bounds3f below;
+            uint32_t countBelow = 0;
+            int splitBin = -1;
+            float minCost = infinity;
+            for (int b = 0; b < nBins - 1; b++) {
+                below = union_of(below, bins[b].bounds);
+                countBelow += bins[b].count;
+                costs[b] += float(countBelow) * below.surface_area();
+                if (costs[b] < minCost) {
+                    minCost = costs[b];
+                    splitBin = b;
+                }
+            }
+
+            float leafCost = float(count);
+            minCost = options.traversal_cost + minCost / bounds.surface_area();
+            if (count <= uint32_t(options.max_primitives_in_node) && minCost >= leafCost)
+                return make_leaf(first, count, bounds);
+
+            auto split = std::partition(prims.begin(), prims.end(), [&](const bvh_build_primitive& p) {
+                return bin_of(p, centroidBounds, axis, nBins) <= splitBin;
+            });
+            mid = uint32_t(split - prims.begin());
+            if (mid == 0 || mid == count) {
+                mid = count / 2;
+                std::nth_element(prims.begin(), prims.begin() + mid, prims.end(),
+                                 [axis](const bvh_build_primitive& a, const bvh_build_primitive& b) {
+                                     return a.centroid[axis] < b.centroid[axis];
+                                 });
+            }
+        }
+
+        auto node = std::make_unique<bvh_build_node>();
+        node->bounds = bounds;
+        node->axis = axis;
+        if (count > uint32_t(options.parallel_threshold)) {
+            task_group group;
+            group.run([&] { node->children[0] = build(first, mid, depth + 1); });
+            node->children[1] = build(first + mid, count - mid, depth + 1);
+            group.wait();
+        } else {
+            node->children[0] = build(first, mid, depth + 1);
+            node->children[1] = build(first + mid, count - mid, depth + 1);
+        }
+        return node;
+    }
+};
+
+static uint32_t flatten(const bvh_build_node& node, std::vector<bvh_node>& nodes, uint32_t& offset) {
+    uint32_t index = offset++;
+    bvh_node& linear = nodes[index];
+    linear.bounds = node.bounds;
+    linear.pad = 0;
+    if (node.count > 0) {
+        linear.primitives_offset = node.first;
+        linear.primitive_count = uint16_t(node.count);
+        linear.axis = 0;
+    } else {
+        linear.primitive_count = 0;
+        linear.axis = uint8_t(node.axis);
+        flatten(*node.children[0], nodes, offset);
+        uint32_t second = flatten(*node.children[1], nodes, offset);
+        nodes[index].second_child_offset = second;
+    }
+    return index;
+}
+
+struct bvh::build_state {
+    std::vector<bvh_node> nodes;
+    std::vector<uint32_t> primitives;
+    bvh_build_options options;
+
+    // Edit tracking, set up by track() on first use.
+    static constexpr uint32_t none = UINT32_MAX;
+    std::vector<uint32_t> parents, leafOf;
+    // Unnormalized SAH cost of each subtree, now and when tracking began
+    // or the subtree was last rebuilt. Costs are not divided by the
+    // subtree's own area, so a box that inflates because one primitive
+    // moved away counts against it.
+    std::vector<float> cost, baseline;
+    std::vector<uint8_t> marked;
+    std::vector<uint32_t> touched;
+
+    bool tracking() const { return !parents.empty(); }
+
+    float node_cost(uint32_t i) const {
+        const bvh_node& node = nodes[i];
+        float area = node.bounds.surface_area();
+        if (node.is_leaf()) return area * float(node.primitive_count);
+        return area * options.traversal_cost + cost[i + 1] + cost[node.second_child_offset];
+    }
+
+    void link() {
+        parents.assign(nodes.size(), none);
+        leafOf.resize(primitives.size());
+        for (uint32_t i = 0; i < nodes.size(); i++) {
+            const bvh_node& node = nodes[i];
+            if (node.is_leaf()) {
+                for (uint32_t p = 0; p < node.primitive_count; p++)
+                    leafOf[primitives[node.primitives_offset + p]] = i;
+            } else {
+                parents[i + 1] = i;
+                parents[node.second_child_offset] = i;
+            }
+        }
+    }
+
+    void track() {
+        if (tracking()) return;
+        link();
+        cost.resize(nodes.size());
+        baseline.resize(nodes.size());
+        marked.assign(nodes.size(), 0);
+        for (size_t i = nodes.size(); i-- > 0;) {
+            cost[i] = node_cost(uint32_t(i));
+            baseline[i] = cost[i];
+        }
+    }
+
+    struct subtree {
+        uint32_t root, endNode = 0;
+        int depth;
+        std::vector<bvh_node> nodes;
+    };
+
+    // Builds a replacement for the subtree at root over the same
+    // primitives, which are contiguous in depth-first order like its nodes.
+    // Interior offsets in the result are relative to the subtree.
+    void rebuild(subtree& s, const bounds_fn& primitiveBounds) {
+        uint32_t leftmost = s.root, rightmost = s.root;
+        while (!nodes[leftmost].is_leaf()) leftmost++;
+        while (!nodes[rightmost].is_leaf()) rightmost = nodes[rightmost].second_child_offset;
+        uint32_t firstPrimitive = nodes[leftmost].primitives_offset;
+        uint32_t endPrimitive = nodes[rightmost].primitives_offset + nodes[rightmost].primitive_count;
+        s.endNode = rightmost + 1;
+
+        std::vector<bvh_build_primitive> buildPrimitives(endPrimitive - firstPrimitive);
+        for (size_t i = 0; i < buildPrimitives.size(); i++) {
+            uint32_t index = primitives[firstPrimitive + i];
+            bounds3f b = primitiveBounds(index);
+            buildPrimitives[i] = {b, b.centroid(), index};
+        }
+        bvh_builder builder{buildPrimitives, options};
+        std::unique_ptr<bvh_build_node> root = builder.build(0, uint32_t(buildPrimitives.size()), s.depth);
+        s.nodes.resize(builder.nodeCount.load());
+        uint32_t offset = 0;
+        flatten(*root, s.nodes, offset);
+        for (bvh_node& node : s.nodes)
+            if (node.is_leaf()) node.primitives_offset += firstPrimitive;
+        for (size_t i = 0; i < buildPrimitives.size(); i++)
+            primitives[firstPrimitive + i] = buildPrimitives[i].index;
+    }
+
+    // Swaps rebuilt subtrees, sorted by root, into the node array in one
+    // pass. Nodes outside them move by the size change of every subtree
+    // that ends before them.
+    void splice(std::span<const subtree> subtrees) {
+        std::vector<int64_t> shifts(subtrees.size() + 1, 0);
+        for (size_t i = 0; i < subtrees.size(); i++)
+            shifts[i + 1] = shifts[i] + int64_t(subtrees[i].nodes.size()) - int64_t(subtrees[i].endNode - subtrees[i].root);
+        auto moved = [&](uint32_t old) {
+            auto after = std::upper_bound(subtrees.begin(), subtrees.end(), old,
+                                          [](uint32_t i, const subtree& s) { return i < s.endNode; });
+            return uint32_t(old + shifts[after - subtrees.begin()]);
+        };
+
+        std::vector<bvh_node> result;
+        std::vector<float> resultCost, resultBaseline;
+        size_t size = size_t(int64_t(nodes.size()) + shifts.back());
+        result.reserve(size);
+        resultCost.reserve(size);
+        resultBaseline.reserve(size);
+        auto copy = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                bvh_node node = nodes[i];
+                if (!node.is_leaf()) node.second_child_offset = moved(node.second_child_offset);
+                result.push_back(node);
+                resultCost.push_back(cost[i]);
+                resultBaseline.push_back(baseline[i]);
+            }
+        };
+
+        uint32_t next = 0;
+        for (const subtree& s : subtrees) {
+            copy(next, s.root);
+            uint32_t root = uint32_t(result.size());
+            for (bvh_node node : s.nodes) {
+                if (!node.is_leaf()) node.second_child_offset += root;
+                result.push_back(node);
+            }
+            resultCost.resize(result.size());
+            resultBaseline.resize(result.size());
+            next = s.endNode;
+        }
+        copy(next, uint32_t(nodes.size()));
+
+        nodes = std::move(result);
+        cost = std::move(resultCost);
+        baseline = std::move(resultBaseline);
+        marked.assign(nodes.size(), 0);
+        link();
+
+        for (const subtree& s : subtrees) {
+            uint32_t root = moved(s.root);
+            for (uint32_t i = root + uint32_t(s.nodes.size()); i-- > root;) {
+                cost[i] = node_cost(i);
+                baseline[i] = cost[i];
+            }
+        }
+        // Rebuilt subtrees keep their bounds but not their cost, which the
+        // ancestors include.
+        for (const subtree& s : subtrees) {
+            for (uint32_t i = parents[moved(s.root)]; i != none; i = parents[i])
+                cost[i] = node_cost(i);
+        }
+    }
+};
+
+bvh::bvh(std::span<const bounds3f> primitiveBounds, const bvh_build_options& options) {
+    if (primitiveBounds.empty()) return;
+
+    std::vector<bvh_build_primitive> buildPrimitives(primitiveBounds.size());
+    parallel_for(0, int64_t(primitiveBounds.size()), parallel_reduce_chunk, [&](int64_t i) {
+        buildPrimitives[i] = {primitiveBounds[i], primitiveBounds[i].centroid(), uint32_t(i)};
+    });
+
+    bvh_builder builder{buildPrimitives, options};
+    std::unique_ptr<bvh_build_node> root = builder.build(0, uint32_t(buildPrimitives.size()), 0);
+
+    owned = std::make_shared<build_state>();
+    owned->options = options;
+    owned->nodes.resize(builder.nodeCount.load());
+    uint32_t offset = 0;
+    flatten(*root, owned->nodes, offset);
+
+    owned->primitives.resize(buildPrimitives.size());
+    for (size_t i = 0; i < buildPrimitives.size(); i++)
+        owned->primitives[i] = buildPrimitives[i].index;
+
+    nodes = owned->nodes;
+    primitives = owned->primitives;
+}
+
+bool bvh::refit(std::span<const bounds3f> primitiveBounds) {
+    if (!owned) return nodes.empty();
+
+    // Children always follow their parent, so a reverse sweep sees both
+    // children of a node before the node itself.
+    std::vector<bvh_node>& ownedNodes = owned->nodes;
+    for (size_t i = ownedNodes.size(); i-- > 0;) {
+        bvh_node& node = ownedNodes[i];
+        bounds3f b;
+        if (node.is_leaf()) {
+            for (uint32_t primitive : leaf_primitives(node))
+                b = union_of(b, primitiveBounds[primitive]);
+        } else {
+            b = union_of(ownedNodes[i + 1].bounds, ownedNodes[node.second_child_offset].bounds);
+        }
+        node.bounds = b;
+    }
+
+    if (owned->tracking()) {
+        for (size_t i = ownedNodes.size(); i-- > 0;)
+            owned->cost[i] = owned->node_cost(uint32_t(i));
+        std::fill(owned->marked.begin(), owned->marked.end(), 1);
+    }
+    return true;
+}
+
+bool bvh::refit(const bounds_fn& primitiveBounds, std::span<const uint32_t> changed, bvh_update_stats* stats) {
+    if (!owned) return nodes.empty();
+    build_state& state = *owned;
+    state.track();
+
+    // Collect each changed leaf and the path above it once; paths merge at
+    // the first node an earlier primitive already reached.
+    std::vector<uint32_t>& touched = state.touched;
+    touched.clear();
+    for (uint32_t primitive : changed) {
+        for (uint32_t i = state.leafOf[primitive]; i != build_state::none && state.marked[i] != 2;
+             i = state.parents[i]) {
+            state.marked[i] = 2;
+            touched.push_back(i);
+        }
+    }
+    std::sort(touched.begin(), touched.end(), std::greater<>());
+
+    for (uint32_t i : touched) {
+        bvh_node& node = state.nodes[i];
+        bounds3f b;
+        if (node.is_leaf()) {
+            for (uint32_t primitive : leaf_primitives(node))
+                b = union_of(b, primitiveBounds(primitive));
+        } else {
+            b = union_of(state.nodes[i + 1].bounds, state.nodes[node.second_child_offset].bounds);
+        }
+        node.bounds = b;
+        state.cost[i] = state.node_cost(i);
+        state.marked[i] = 1;
+    }
+    if (stats) stats->refit_nodes += uint32_t(touched.size());
+    return true;
+}
+
+bool bvh::rebuild_degraded(const bounds_fn& primitiveBounds, bvh_update_stats* stats) {
+    if (!owned) return nodes.empty();
+    build_state& state = *owned;
+    if (!state.tracking()) return true;
+
+    // Walk down the marked nodes only and stop at the first degraded one on
+    // each path, so no subtree is rebuilt inside another.
+    std::vector<build_state::subtree> degraded;
+    std::vector<std::pair<uint32_t, int>> stack;
+    if (state.marked[0]) stack.push_back({0, 0});
+    while (!stack.empty()) {
+        auto [i, depth] = stack.back();
+        stack.pop_back();
+        const bvh_node& node = state.nodes[i];
+        state.marked[i] = 0;
+        if (node.is_leaf()) continue;
+        if (state.cost[i] > state.options.rebuild_threshold * state.baseline[i]) {
+            degraded.push_back({i, 0, depth, {}});
+            continue;
+        }
+        if (state.marked[i + 1]) stack.push_back({i + 1, depth + 1});
+        if (state.marked[node.second_child_offset]) stack.push_back({node.second_child_offset, depth + 1});
+    }
+    if (degraded.empty()) return true;
+
+    // The subtrees own disjoint node and primitive ranges, so they build
+    // in parallel and go back in together.
+    std::sort(degraded.begin(), degraded.end(),
+              [](const build_state::subtree& a, const build_state::subtree& b) { return a.root < b.root; });
+    parallel_for(0, int64_t(degraded.size()), 1, [&](int64_t i) {
+        state.rebuild(degraded[i], primitiveBounds);
+    });
+    if (stats) {
+        for (const build_state::subtree& s : degraded) {
+            stats->rebuilt_subtrees++;
+            for (const bvh_node& node : s.nodes)
+                stats->rebuilt_primitives += node.is_leaf() ? node.primitive_count : 0;
+        }
+    }
+    state.splice(degraded);
+
+    nodes = state.nodes;
+    primitives = state.primitives;
+    return true;
+}
+
+float bvh::sah_cost() const {
+    if (nodes.empty()) return 0;
+    std::vector<float> cost(nodes.size());
+    float traversalCost = owned ? owned->options.traversal_cost : bvh_build_options{}.traversal_cost;
+    for (size_t i = nodes.size(); i-- > 0;) {
+        const bvh_node& node = nodes[i];
+        float area = node.bounds.surface_area();
+        cost[i] = node.is_leaf() ? area * float(node.primitive_count)
+                                 : area * traversalCost + cost[i + 1] + cost[node.second_child_offset];
+    }
+    float rootArea = nodes[0].bounds.surface_area();
+    return rootArea > 0 ? cost[0] / rootArea : 0;
+}
+
+bvh_aggregate::bvh_aggregate(std::vector<std::shared_ptr<shape>> shapes, const bvh_build_options& options)
+    : shape(shape_kind::aggregate), shapes(std::move(shapes)) {
+    std::vector<bounds3f> shapeBounds(this->shapes.size());
+    parallel_for(0, int64_t(shapeBounds.size()), 1024, [&](int64_t i) {
+        shapeBounds[i] = this->shapes[i]->bounds();
+    });
+    accel = bvh(shapeBounds, options);
+}
+
+bvh_update_stats bvh_aggregate::update() {
+    bvh_update_stats stats;
+    if (dirtyShapes.empty()) return stats;
+    auto shapeBounds = [&](uint32_t i) { return shapes[i]->bounds(); };
+    accel.refit(shapeBounds, dirtyShapes, &stats);
+    accel.rebuild_degraded(shapeBounds, &stats);
+    dirtyShapes.clear();
+    return stats;
+}
+
+void bvh_aggregate::refit() {
+    std::vector<bounds3f> shapeBounds(shapes.size());
+    parallel_for(0, int64_t(shapeBounds.size()), 1024, [&](int64_t i) {
+        shapeBounds[i] = shapes[i]->bounds();
+    });
+    accel.refit(shapeBounds);
+}
+
+size_t bvh_aggregate::memory_bytes() const {
+    return shapes.size() * (sizeof(std::shared_ptr<shape>) + sizeof(uint32_t)) +
+           accel.node_span().size() * sizeof(bvh_node);
+}
+
+bounds3f bvh_aggregate::bounds() const {
+    return accel.bounds();
+}
+
+std::optional<shape_isect> bvh_aggregate::intersect(const ray& ray, float tMax) const {
+    std::optional<shape_isect> closest;
+    accel.intersect(ray, tMax, [&](uint32_t primitive, float& t) {
+        std::optional<shape_isect> isect =
+            dispatch_shape(*shapes[primitive], [&](const auto& s) { return s.intersect(ray, t); });
+        if (!isect) return false;
+        t = isect->t;
+        closest = isect;
+        return true;
+    });
+    return closest;
+}
+
+bool bvh_aggregate::intersects(const ray& ray, float tMax) const {
+    return accel.intersects(ray, tMax, [&](uint32_t primitive, float t) {
+        return dispatch_shape(*shapes[primitive], [&](const auto& s) { return s.intersects(ray, t); });
+    });
+}
+
+void bvh_aggregate::intersect(ray_packet& rays, shape_isect_packet& isects) const {
+    uint32_t active = rays.active;
+    accel.intersect(rays, [&](std::span<const uint32_t> leaf, ray_packet& packet, uint32_t lanes) {
+        packet.active = lanes;
+        for (uint32_t primitive : leaf)
+            dispatch_shape(*shapes[primitive], [&](const auto& s) { s.intersect(packet, isects); });
+        packet.active = active;
+    });
+}
+
+bool bvh::well_formed(std::span<const bvh_node> nodes, std::span<const uint32_t> primitives, size_t primitiveCount) {
+    if (nodes.empty()) return primitives.empty();
+    for (uint32_t primitive : primitives)
+        if (primitive >= primitiveCount) return false;
+
+    // Children come after their parent, so one forward pass sees every
+    // node's depth before its children's.
+    std::vector<uint8_t> depth(nodes.size(), 0);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const bvh_node& node = nodes[i];
+        if (node.is_leaf()) {
+            if (uint64_t(node.primitives_offset) + node.primitive_count > primitives.size()) return false;
+            continue;
+        }
+        if (depth[i] + 1 >= max_depth) return false;
+        if (i + 1 >= nodes.size() || node.second_child_offset <= i + 1 || node.second_child_offset >= nodes.size())
+            return false;
+        depth[i + 1] = std::max(depth[i + 1], uint8_t(depth[i] + 1));
+        depth[node.second_child_offset] = std::max(depth[node.second_child_offset], uint8_t(depth[i] + 1));
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <shape/shape.h>
+#include <util/profiler.h>
+
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Flattened depth-first node: the first child immediately follows its
+// parent, interior nodes store the offset of the second one. 32 bytes so two
+// nodes share a cache line.
+struct alignas(32) bvh_node {
+    bounds3f bounds;
+    union {
+        uint32_t primitives_offset;
+        uint32_t second_child_offset;
+    };
+    uint16_t primitive_count;
+    uint8_t axis;
+    uint8_t pad;
+
+    bool is_leaf() const { return primitive_count > 0; }
+};
+
+static_assert(sizeof(bvh_node) == 32);
+
+struct bvh_build_options {
+    int max_primitives_in_node = 4;
+    int bins = 16;
+    // SAH cost of visiting a node relative to intersecting one primitive.
+    float traversal_cost = 0.5f;
+    // Subtrees with more primitives than this are built as separate tasks.
+    int parallel_threshold = 1 << 14;
+    // bvh::rebuild_degraded rebuilds a subtree once its SAH cost exceeds
+    // this multiple of the cost it had when tracking began.
+    float rebuild_threshold = 1.5f;
+};
+
+// What an incremental update touched.
+struct bvh_update_stats {
+    uint32_t refit_nodes = 0;
+    uint32_t rebuilt_subtrees = 0;
+    uint32_t rebuilt_primitives = 0;
+};
+
+// Bounding volume hierarchy over an abstract set of primitives, identified
+// by their index into the bounds span passed at build time. Traversal hands
+// primitive indices back to a callback, so the same structure serves
+// aggregates of shapes and the triangles inside a single mesh.
+class bvh {
+public:
+    bvh() = default;
+    explicit bvh(std::span<const bounds3f> primitiveBounds, const bvh_build_options& options = {});
+    // Adopts prebuilt arrays (e.g. mapped from a cache file); storage keeps
+    // the memory behind them alive.
+    bvh(std::span<const bvh_node> nodes, std::span<const uint32_t> primitives, std::shared_ptr<const void> storage)
+        : storage(std::move(storage)), nodes(nodes), primitives(primitives) {}
+    // Not copyable: rebuild_degraded replaces the node storage, which would
+    // leave a copy's spans dangling. Moves leave the source empty.
+    bvh(const bvh&) = delete;
+    bvh& operator=(const bvh&) = delete;
+    bvh(bvh&& other) noexcept
+        : storage(std::move(other.storage)), owned(std::move(other.owned)),
+          nodes(std::exchange(other.nodes, {})), primitives(std::exchange(other.primitives, {})) {}
+    bvh& operator=(bvh&& other) noexcept {
+        storage = std::move(other.storage);
+        owned = std::move(other.owned);
+        nodes = std::exchange(other.nodes, {});
+        primitives = std::exchange(other.primitives, {});
+        return *this;
+    }
+
+    // Whether untrusted arrays can be traversed without reading out of
+    // bounds: children follow their parent, leaves and primitive indices lie
+    // in range and no path is deeper than the traversal stack.
+    static bool well_formed(std::span<const bvh_node> nodes, std::span<const uint32_t> primitives,
+                            size_t primitiveCount);
+
+    bounds3f bounds() const {
+        return nodes.empty() ? bounds3f{} : nodes[0].bounds;
+    }
+
+    std::span<const bvh_node> node_span() const { return nodes; }
+
+    // Recomputes every node's bounds bottom-up for moved primitives while
+    // keeping the topology. Only trees built in memory can be refit.
+    // Returns false for adopted arrays.
+    bool refit(std::span<const bounds3f> primitiveBounds);
+    std::span<const uint32_t> primitive_span() const { return primitives; }
+
+    // Incremental updates for edits that touch few primitives. The first
+    // call sets up parent links and per-node SAH costs, so trees that never
+    // change pay nothing for them.
+    using bounds_fn = std::function<bounds3f(uint32_t primitive)>;
+    // Refits only the leaves holding the changed primitives and their
+    // ancestors, and marks them for rebuild_degraded.
+    bool refit(const bounds_fn& primitiveBounds, std::span<const uint32_t> changed, bvh_update_stats* stats = nullptr);
+    // Rebuilds, in place, the topmost marked subtrees whose SAH cost has
+    // grown past rebuild_threshold times their cost when tracking began
+    // (or when they were last rebuilt), then clears the marks.
+    bool rebuild_degraded(const bounds_fn& primitiveBounds, bvh_update_stats* stats = nullptr);
+
+    // SAH cost of the tree relative to one primitive intersection.
+    float sah_cost() const;
+
+    // Deepest tree the builder produces; SAH splits give way to equal-count
+    // splits past max_sah_depth so traversal stacks can stay fixed-size.
+    static constexpr int max_sah_depth = 64;
+    static constexpr int max_depth = 128;
+
+    // intersectPrimitive(uint32_t primitive, float& tMax) -> bool shrinks tMax
+    // on a hit; traversal visits the near child first so it can cull early.
+    template <typename F>
+    bool intersect(const ray& r, float& tMax, F&& intersectPrimitive) const {
+        return traverse<false>(r, tMax, [&](std::span<const uint32_t> leaf, float& t) {
+            bool hit = false;
+            for (uint32_t primitive : leaf)
+                hit |= intersectPrimitive(primitive, t);
+            return hit;
+        });
+    }
+
+    // testPrimitive(uint32_t primitive, float tMax) -> bool; stops at the
+    // first hit.
+    template <typename F>
+    bool intersects(const ray& r, float tMax, F&& testPrimitive) const {
+        return traverse<true>(r, tMax, [&](std::span<const uint32_t> leaf, float& t) {
+            for (uint32_t primitive : leaf)
+                if (testPrimitive(primitive, t)) return true;
+            return false;
+        });
+    }
+
+    // Leaf-granular variants for callers that batch the primitives of a
+    // leaf: intersectLeaf(std::span<const uint32_t> primitives, float& tMax).
+    template <typename F>
+    bool intersect_leaves(const ray& r, float& tMax, F&& intersectLeaf) const {
+        return traverse<false>(r, tMax, intersectLeaf);
+    }
+    template <typename F>
+    bool intersects_leaves(const ray& r, float tMax, F&& testLeaf) const {
+        return traverse<true>(r, tMax, testLeaf);
+    }
+
+    // Packet traversal: node bounds are tested against all lanes at once and
+    // intersectLeaf(std::span<const uint32_t> primitives, ray_packet& rays,
+    // uint32_t lanes) is called with the lanes that reached the leaf. Packets whose rays do
+    // not share a direction octant are traced one lane at a time.
+    template <typename F>
+    void intersect(ray_packet& rays, F&& intersectLeaf) const {
+        if (nodes.empty() || !rays.active) return;
+        if (!rays.coherent()) {
+            for (int i = 0; i < packet_width; i++) {
+                if (!((rays.active >> i) & 1)) continue;
+                traverse<false>(rays.get(i), rays.tmax[i], [&](std::span<const uint32_t> leaf, float& t) {
+                    float before = rays.tmax[i];
+                    intersectLeaf(leaf, rays, 1u << i);
+                    t = rays.tmax[i];
+                    return t < before;
+                });
+            }
+            return;
+        }
+
+        alignas(32) float inv[3][packet_width];
+        for (int i = 0; i < packet_width; i++) {
+            inv[0][i] = safe_inverse(rays.dx[i]);
+            inv[1][i] = safe_inverse(rays.dy[i]);
+            inv[2][i] = safe_inverse(rays.dz[i]);
+        }
+        vfloatn ox = vfloatn::load(rays.ox), oy = vfloatn::load(rays.oy), oz = vfloatn::load(rays.oz);
+        vfloatn invX = vfloatn::load(inv[0]), invY = vfloatn::load(inv[1]), invZ = vfloatn::load(inv[2]);
+        int first = std::countr_zero(rays.active);
+        int dirIsNeg[3] = {rays.dx[first] < 0, rays.dy[first] < 0, rays.dz[first] < 0};
+        traversal_tally tally;
+        vfloatn farScale(1 + 2 * error_gamma(3));
+        vfloatn zero(0.f);
+
+        uint32_t stack[max_depth];
+        int stackSize = 0;
+        uint32_t current = 0;
+        while (true) {
+            tally.node();
+            const bvh_node& node = nodes[current];
+            const bounds3f& b = node.bounds;
+            vfloatn tx0 = (vfloatn(b.pmin.x) - ox) * invX, tx1 = (vfloatn(b.pmax.x) - ox) * invX;
+            vfloatn ty0 = (vfloatn(b.pmin.y) - oy) * invY, ty1 = (vfloatn(b.pmax.y) - oy) * invY;
+            vfloatn tz0 = (vfloatn(b.pmin.z) - oz) * invZ, tz1 = (vfloatn(b.pmax.z) - oz) * invZ;
+            vfloatn tNear = max(max(min(tx0, tx1), min(ty0, ty1)), min(tz0, tz1));
+            vfloatn tFar = min(min(max(tx0, tx1), max(ty0, ty1)), max(tz0, tz1)) * farScale;
+            uint32_t lanes = ((tNear <= tFar) & (tFar >= zero) & (tNear < vfloatn::load(rays.tmax))).movemask() & rays.active;
+
+            if (lanes) {
+                if (node.is_leaf()) {
+                    tally.primitives(node.primitive_count);
+                    intersectLeaf(leaf_primitives(node), rays, lanes);
+                    if (stackSize == 0) break;
+                    current = stack[--stackSize];
+                } else if (dirIsNeg[node.axis]) {
+                    stack[stackSize++] = current + 1;
+                    current = node.second_child_offset;
+                } else {
+                    stack[stackSize++] = node.second_child_offset;
+                    current = current + 1;
+                }
+            } else {
+                if (stackSize == 0) break;
+                current = stack[--stackSize];
+            }
+        }
+    }
+
+private:
+    struct build_state;
+
+    std::shared_ptr<const void> storage;
+    // Set for trees built in memory, which are the ones that can change.
+    std::shared_ptr<build_state> owned;
+    std::span<const bvh_node> nodes;
+    std::span<const uint32_t> primitives;
+
+    // Axis-parallel rays get a huge finite reciprocal instead of infinity, so
+    // an origin lying exactly on a slab plane cannot produce 0 * inf = NaN.
+    static float safe_inverse(float d) {
+        return 1 / (std::abs(d) < 1e-20f ? std::copysign(1e-20f, d) : d);
+    }
+
+    std::span<const uint32_t> leaf_primitives(const bvh_node& node) const {
+        return {primitives.data() + node.primitives_offset, node.primitive_count};
+    }
+
+    template <bool anyHit, typename F>
+    bool traverse(const ray& r, float& tMax, F&& intersectLeaf) const {
+        if (nodes.empty()) return false;
+
+        vec3f o = r.origin();
+        vec3f invDir(safe_inverse(r.direction().x), safe_inverse(r.direction().y), safe_inverse(r.direction().z));
+        int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+
+        bool hit = false;
+        traversal_tally tally;
+        uint32_t stack[max_depth];
+        int stackSize = 0;
+        uint32_t current = 0;
+        while (true) {
+            tally.node();
+            const bvh_node& node = nodes[current];
+            if (node.bounds.intersect_p(o, invDir, dirIsNeg, tMax)) {
+                if (node.is_leaf()) {
+                    tally.primitives(node.primitive_count);
+                    if (intersectLeaf(leaf_primitives(node), tMax)) {
+                        if constexpr (anyHit) return true;
+                        hit = true;
+                    }
+                    if (stackSize == 0) break;
+                    current = stack[--stackSize];
+                } else if (dirIsNeg[node.axis]) {
+                    stack[stackSize++] = current + 1;
+                    current = node.second_child_offset;
+                } else {
+                    stack[stackSize++] = node.second_child_offset;
+                    current = current + 1;
+                }
+            } else {
+                if (stackSize == 0) break;
+                current = stack[--stackSize];
+            }
+        }
+        return hit;
+    }
+};
+
+class bvh_aggregate final : public shape {
+public:
+    explicit bvh_aggregate(std::vector<std::shared_ptr<shape>> shapes, const bvh_build_options& options = {});
+
+    bounds3f bounds() const override;
+
+    std::optional<shape_isect> intersect(const ray& ray, float tMax = infinity) const override;
+    bool intersects(const ray& ray, float tMax = infinity) const override;
+    void intersect(ray_packet& rays, shape_isect_packet& isects) const override;
+
+    // Picks up changed shape bounds (e.g. moved instances) by refitting the
+    // tree instead of rebuilding it. Must not run concurrently with
+    // traversal.
+    void refit();
+
+    // Change tracking for interactive edits: mark the shapes that moved or
+    // changed, then update() refits only their part of the tree and
+    // rebuilds subtrees whose quality degraded too far. Same threading
+    // rules as refit().
+    void mark_dirty(uint32_t shape) { dirtyShapes.push_back(shape); }
+    bvh_update_stats update();
+
+    size_t size() const { return shapes.size(); }
+    const std::shared_ptr<shape>& get_shape(uint32_t i) const { return shapes[i]; }
+    const bvh& acceleration() const { return accel; }
+    size_t memory_bytes() const;
+
+private:
+    std::vector<std::shared_ptr<shape>> shapes;
+    std::vector<uint32_t> dirtyShapes;
+    bvh accel;
+};
\ No newline at end of file
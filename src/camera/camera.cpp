@@ -1,2 +1,9 @@
 #include "camera.h"
 
+void camera::generate_rays(std::span<const camera_sample_ctx, packet_width> ctx, ray_packet& rays) const {
+    rays.active = 0;
+    for (int i = 0; i < packet_width; i++) {
+        std::optional<ray> r = generate_ray(ctx[i]);
+        if (r) rays.set(i, *r);
+    }
+}
\ No newline at end of file
@@ -2,16 +2,48 @@
 
 #include <math/vec.h>
 #include <math/ray.h>
+#include <math/ray_packet.h>
 
+#include <cstdint>
 #include <optional>
+#include <span>
 
 struct camera_sample_ctx {
     vec2f pixel;
+    // Point on the lens in [0, 1)^2 for cameras with an aperture.
+    vec2f lens = vec2f(0.5f);
+    // Point in the shutter interval, carried on the generated ray.
+    float time = 0;
+};
+
+// The cameras that come with the renderer, for dispatch_camera(); any
+// other camera is other.
+enum class camera_kind : uint8_t {
+    other,
+    perspective
 };
 
 class camera {
 public:
+    explicit camera(camera_kind kind = camera_kind::other) : cameraKind(kind) {}
     virtual ~camera() = default;
 
+    camera_kind kind() const { return cameraKind; }
+
     virtual std::optional<ray> generate_ray(camera_sample_ctx ctx) const = 0;
+
+    // Fills one lane per sample and leaves lanes without a ray inactive.
+    virtual void generate_rays(std::span<const camera_sample_ctx, packet_width> ctx, ray_packet& rays) const;
+
+    // How far a one-pixel step on the image moves a point p with normal n,
+    // as if it were seen directly by the camera; this stands in for ray
+    // differentials at any depth. More samples per pixel shrink the step.
+    // Zero unless the camera knows its pixel footprint.
+    virtual void approximate_dp_dxy([[maybe_unused]] vec3f p, [[maybe_unused]] vec3f n,
+                                    [[maybe_unused]] int samplesPerPixel, vec3f& dpdx, vec3f& dpdy) const {
+        dpdx = dpdy = vec3f(0.f);
+    }
+
+private:
+    camera_kind cameraKind;
 };
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <camera/perspective.h>
+
+// Calls f with c as its concrete type; see dispatch_shape().
+template <typename F>
+decltype(auto) dispatch_camera(const camera& c, F&& f) {
+    switch (c.kind()) {
+        case camera_kind::perspective: return f(static_cast<const perspective_camera&>(c));
+        default: return f(c);
+    }
+}
\ No newline at end of file
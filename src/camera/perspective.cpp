@@ -1,5 +1,18 @@
 #include "perspective.h"
 
+#include <algorithm>
+#include <cmath>
+
+perspective_camera::perspective_camera(vec2i resolution, float fov, transform camera_transform)
+    : camera(camera_kind::perspective), resolution(resolution), projection(perspective(fov, 0.05f, 1024.0f)),
+      camera_transform(camera_transform) {
+    vec2f center(float(resolution.x) / 2, float(resolution.y) / 2);
+    ray r = *generate_ray({center});
+    origin = r.origin();
+    dirDx = generate_ray({center + vec2f(1, 0)})->direction() - r.direction();
+    dirDy = generate_ray({center + vec2f(0, 1)})->direction() - r.direction();
+}
+
 std::optional<ray> perspective_camera::generate_ray(camera_sample_ctx ctx) const  {
     vec3f screenSpace = vec3f(float(ctx.pixel.x) / float(resolution.x), float(ctx.pixel.y) / float(resolution.y), 1.f);
 
@@ -9,5 +22,66 @@ std::optional<ray> perspective_camera::generate_ray(camera_sample_ctx ctx) const
     auto origin = vec3f(0.f);
     vec3f direction = normalize(pointOnFarPlane - origin);
 
-    return camera_transform(ray{origin, direction});
+    return camera_transform(ray{origin, direction, ctx.time});
+}
+
+void perspective_camera::generate_rays(std::span<const camera_sample_ctx, packet_width> ctx, ray_packet& rays) const {
+    alignas(32) float px[packet_width], py[packet_width];
+    for (int i = 0; i < packet_width; i++) {
+        px[i] = ctx[i].pixel.x;
+        py[i] = ctx[i].pixel.y;
+        rays.time[i] = ctx[i].time;
+    }
+
+    // Same steps as generate_ray, one lane per sample.
+    vfloatn ndcX = vfloatn(2.f) * (vfloatn::load(px) / vfloatn(float(resolution.x))) - vfloatn(1.f);
+    vfloatn ndcY = vfloatn(2.f) * (vfloatn::load(py) / vfloatn(float(resolution.y))) - vfloatn(1.f);
+    vfloatn ndcZ(1.f);
+
+    matrix<4> p = projection.get_matrix();
+    vfloatn x = vfloatn(p[0][0]) * ndcX + vfloatn(p[0][1]) * ndcY + vfloatn(p[0][2]) * ndcZ + vfloatn(p[0][3]);
+    vfloatn y = vfloatn(p[1][0]) * ndcX + vfloatn(p[1][1]) * ndcY + vfloatn(p[1][2]) * ndcZ + vfloatn(p[1][3]);
+    vfloatn z = vfloatn(p[2][0]) * ndcX + vfloatn(p[2][1]) * ndcY + vfloatn(p[2][2]) * ndcZ + vfloatn(p[2][3]);
+    vfloatn w = vfloatn(p[3][0]) * ndcX + vfloatn(p[3][1]) * ndcY + vfloatn(p[3][2]) * ndcZ + vfloatn(p[3][3]);
+    vfloatn invW = vfloatn(1.f) / w;
+    x = x * invW;
+    y = y * invW;
+    z = z * invW;
+
+    vfloatn invLength = vfloatn(1.f) / sqrt(x * x + y * y + z * z);
+    x = x * invLength;
+    y = y * invLength;
+    z = z * invLength;
+
+    matrix<4> c = camera_transform.get_matrix();
+    vfloatn dx = vfloatn(c[0][0]) * x + vfloatn(c[0][1]) * y + vfloatn(c[0][2]) * z;
+    vfloatn dy = vfloatn(c[1][0]) * x + vfloatn(c[1][1]) * y + vfloatn(c[1][2]) * z;
+    vfloatn dz = vfloatn(c[2][0]) * x + vfloatn(c[2][1]) * y + vfloatn(c[2][2]) * z;
+    dx.store(rays.dx);
+    dy.store(rays.dy);
+    dz.store(rays.dz);
+
+    vec3f origin = camera_transform(vec3f(0.f));
+    vfloatn(origin.x).store(rays.ox);
+    vfloatn(origin.y).store(rays.oy);
+    vfloatn(origin.z).store(rays.oz);
+    vfloatn(infinity).store(rays.tmax);
+    rays.active = (1u << packet_width) - 1;
+}
+
+void perspective_camera::approximate_dp_dxy(vec3f p, vec3f n, int samplesPerPixel, vec3f& dpdx, vec3f& dpdy) const {
+    // Offset rays through the neighboring pixels, turned to pass through p
+    // by keeping only the parts of the center differentials across w, and
+    // met with the tangent plane at p.
+    vec3f w = normalize(p - origin);
+    float scale = std::max(0.125f, 1 / std::sqrt(float(samplesPerPixel)));
+    auto step = [&](vec3f differential) {
+        vec3f d = w + (differential - w * dot(w, differential));
+        float denominator = dot(n, d);
+        if (denominator == 0) return vec3f(0.f);
+        float t = dot(n, p - origin) / denominator;
+        return (origin + d * t - p) * scale;
+    };
+    dpdx = step(dirDx);
+    dpdy = step(dirDy);
 }
\ No newline at end of file
@@ -3,16 +3,22 @@
 #include <camera/camera.h>
 #include <math/transform.h>
 
-class perspective_camera : public camera {
+class perspective_camera final : public camera {
 public:
-    perspective_camera(vec2i resolution, float fov, transform camera_transform)
-        : resolution(resolution), projection(perspective(fov, 0.05f, 1024.0f)),
-          camera_transform(camera_transform) {}
+    perspective_camera(vec2i resolution, float fov, transform camera_transform);
 
     std::optional<ray> generate_ray(camera_sample_ctx ctx) const override;
+    void generate_rays(std::span<const camera_sample_ctx, packet_width> ctx, ray_packet& rays) const override;
+
+    void approximate_dp_dxy(vec3f p, vec3f n, int samplesPerPixel, vec3f& dpdx, vec3f& dpdy) const override;
 
 private:
     vec2i resolution;
     transform projection;
     transform camera_transform;
+
+    // Camera position and the change of the ray direction per pixel step
+    // at the image center, in render space.
+    vec3f origin;
+    vec3f dirDx, dirDy;
 };
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <math/vec.h>
+
 #include <cmath>
 
 inline float linear_to_srgb(float linear) {
@@ -8,4 +10,8 @@ inline float linear_to_srgb(float linear) {
 
 inline float srgb_to_linear(float srgb) {
     return std::pow(srgb, 2.2f);
+}
+
+inline float luminance(vec3f rgb) {
+    return 0.2126f * rgb.x + 0.7152f * rgb.y + 0.0722f * rgb.z;
 }
\ No newline at end of file
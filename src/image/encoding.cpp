@@ -0,0 +1,130 @@
+#include "encoding.h"
+
+#include <render/thread_pool.h>
+
+#include <bit>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+uint8_t encode_one(const color_encoding& encoding, int32_t bits) {
+    float f = std::bit_cast<float>(bits);
+    uint8_t out;
+    encoding.from_linear_scalar({&f, 1}, {&out, 1});
+    return out;
+}
+
+}
+
+encoding_table::encoding_table(const color_encoding& encoding) {
+    int buckets = (max_bits - min_bits) >> bucket_shift;
+    base.resize(buckets);
+    threshold.resize(buckets);
+
+    low = encode_one(encoding, 0);
+    high = encode_one(encoding, max_bits);
+    negativeInfinity = encode_one(encoding, negative_infinity_bits);
+    if (encode_one(encoding, min_bits - 1) != low) isExact = false;
+    if (encode_one(encoding, infinity_bits) != high) isExact = false;
+    if (encode_one(encoding, infinity_bits + 1) != low) isExact = false;
+    // Every other negative pattern, finite or NaN, encodes as low.
+    constexpr float negatives[] = {-0.f, -0x1p-149f, -1.f, -std::numeric_limits<float>::max(),
+                                   -std::numeric_limits<float>::quiet_NaN()};
+    for (float f : negatives)
+        if (encode_one(encoding, std::bit_cast<int32_t>(f)) != low) isExact = false;
+
+    for (int i = 0; i < buckets; i++) {
+        int32_t first = min_bits + (i << bucket_shift);
+        int32_t last = first + (1 << bucket_shift) - 1;
+        uint8_t b = encode_one(encoding, first);
+        uint8_t e = encode_one(encoding, last);
+        base[i] = b;
+        threshold[i] = std::numeric_limits<int32_t>::max();
+        if (e == b) continue;
+        if (e != b + 1) isExact = false;
+
+        // First bit pattern in the bucket that encodes above the base.
+        int32_t lo = first, hi = last;
+        while (lo < hi) {
+            int32_t mid = lo + (hi - lo) / 2;
+            if (encode_one(encoding, mid) > b) hi = mid;
+            else lo = mid + 1;
+        }
+        threshold[i] = lo;
+    }
+}
+
+void encoding_table::encode(std::span<const float> in, std::span<uint8_t> out) const {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i minBits = _mm256_set1_epi32(min_bits);
+    const __m256i maxBits = _mm256_set1_epi32(max_bits - 1);
+    const __m256i infinityBits = _mm256_set1_epi32(infinity_bits);
+    const __m256i lastBucket = _mm256_set1_epi32(int32_t(base.size()) - 1);
+    const __m256i lowValue = _mm256_set1_epi32(low), highValue = _mm256_set1_epi32(high);
+    const __m256i negativeInfinityBits = _mm256_set1_epi32(negative_infinity_bits);
+    const __m256i negativeInfinityValue = _mm256_set1_epi32(negativeInfinity);
+    const __m256i bytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                           0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    for (; i + 8 <= in.size(); i += 8) {
+        __m256i bits = _mm256_loadu_si256((const __m256i*) &in[i]);
+        __m256i isLow = _mm256_or_si256(_mm256_cmpgt_epi32(minBits, bits), _mm256_cmpgt_epi32(bits, infinityBits));
+        // NaNs lie above both bounds and must stay low.
+        __m256i isHigh = _mm256_andnot_si256(isLow, _mm256_cmpgt_epi32(bits, maxBits));
+        __m256i index = _mm256_srli_epi32(_mm256_sub_epi32(bits, minBits), bucket_shift);
+        index = _mm256_andnot_si256(isLow, _mm256_min_epu32(index, lastBucket));
+
+        __m256i b = _mm256_i32gather_epi32(base.data(), index, 4);
+        __m256i t = _mm256_i32gather_epi32(threshold.data(), index, 4);
+        // bits >= t adds one; the comparison mask is -1 where it does.
+        __m256i v = _mm256_sub_epi32(b, _mm256_xor_si256(_mm256_cmpgt_epi32(t, bits), _mm256_set1_epi32(-1)));
+        v = _mm256_blendv_epi8(v, lowValue, isLow);
+        v = _mm256_blendv_epi8(v, highValue, isHigh);
+        v = _mm256_blendv_epi8(v, negativeInfinityValue, _mm256_cmpeq_epi32(bits, negativeInfinityBits));
+
+        __m256i packed = _mm256_shuffle_epi8(v, bytes);
+        uint32_t lo = uint32_t(_mm_cvtsi128_si32(_mm256_castsi256_si128(packed)));
+        uint32_t hi = uint32_t(_mm_cvtsi128_si32(_mm256_extracti128_si256(packed, 1)));
+        std::memcpy(&out[i], &lo, 4);
+        std::memcpy(&out[i + 4], &hi, 4);
+    }
+#endif
+    int32_t buckets = int32_t(base.size());
+    for (; i < in.size(); i++) {
+        int32_t bits = std::bit_cast<int32_t>(in[i]);
+        if (bits == negative_infinity_bits) out[i] = negativeInfinity;
+        else if (bits < min_bits || bits > infinity_bits) out[i] = low;
+        else if (bits >= max_bits) out[i] = high;
+        else {
+            int32_t index = std::min((bits - min_bits) >> bucket_shift, buckets - 1);
+            out[i] = uint8_t(base[index] + (bits >= threshold[index]));
+        }
+    }
+}
+
+void color_encoding::from_linear(std::span<const float> in, std::span<uint8_t> out) const {
+    constexpr size_t table_threshold = 4096;
+    constexpr int64_t chunk = 1 << 16;
+    if (in.size() < table_threshold) {
+        from_linear_scalar(in, out);
+        return;
+    }
+
+    std::call_once(tableOnce, [this] { table = std::make_unique<encoding_table>(*this); });
+    if (!table->exact()) {
+        from_linear_scalar(in, out);
+        return;
+    }
+
+    int64_t chunks = (int64_t(in.size()) + chunk - 1) / chunk;
+    parallel_for(0, chunks, 1, [&](int64_t c) {
+        size_t begin = size_t(c * chunk);
+        size_t count = std::min(size_t(chunk), in.size() - begin);
+        table->encode(in.subspan(begin, count), out.subspan(begin, count));
+    });
+}
\ No newline at end of file
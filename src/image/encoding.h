@@ -5,28 +5,108 @@
 
 #include <span>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class color_encoding;
+
+// Byte encoder that reproduces color_encoding::from_linear_scalar exactly.
+// Positive floats below one are split into buckets by their top bits; each
+// bucket stores the byte at its start and the float (as bits) at which the
+// next byte begins, found by bisecting the scalar curve. NaN encodes like
+// zero; negative infinity keeps its own byte, since pow-based curves send
+// it to +inf. Curves that step by more than one byte within a bucket are
+// reported as inexact.
+class encoding_table {
+public:
+    explicit encoding_table(const color_encoding& encoding);
+
+    bool exact() const { return isExact; }
+
+    void encode(std::span<const float> in, std::span<uint8_t> out) const;
+
+private:
+    static constexpr int bucket_shift = 15;
+    static constexpr int32_t min_bits = 103 << 23; // 2^-24
+    static constexpr int32_t max_bits = 127 << 23; // 1.0
+    static constexpr int32_t infinity_bits = 255 << 23;
+    static constexpr int32_t negative_infinity_bits = int32_t(0xff800000u);
+
+    std::vector<int32_t> base, threshold;
+    uint8_t low = 0, high = 0, negativeInfinity = 0;
+    bool isExact = true;
+};
 
 class color_encoding {
 public:
+    color_encoding() = default;
+    // The table cache belongs to one encoding object and is never copied.
+    color_encoding(const color_encoding&) {}
+    color_encoding& operator=(const color_encoding&) { return *this; }
+    virtual ~color_encoding() = default;
+
     virtual void to_linear(std::span<const uint8_t> in, std::span<float> out) const {
-        for (int i = 0; i < in.size(); i++)
+        for (size_t i = 0; i < in.size(); i++)
             out[i] = to_linear(float(in[i]) / 255.0f);
     }
-    virtual void from_linear(std::span<const float> in, std::span<uint8_t> out) const {
-        for (int i = 0; i < in.size(); i++)
-            out[i] = (uint8_t) clamp(int(std::round(from_linear(in[i]) * 255.0f)), 0, 255);
+    // Large buffers go through a lazily built encoding_table and are split
+    // across the thread pool; the bytes always match from_linear_scalar.
+    virtual void from_linear(std::span<const float> in, std::span<uint8_t> out) const;
+
+    // Reference per-value path.
+    void from_linear_scalar(std::span<const float> in, std::span<uint8_t> out) const {
+        from_linear_values(in, out);
     }
 
     virtual float to_linear(float f) const { return f; }
     virtual float from_linear(float f) const { return f; }
+
+protected:
+    // The loop behind from_linear_scalar, calling the curve once per value.
+    virtual void from_linear_values(std::span<const float> in, std::span<uint8_t> out) const {
+        encode_values(in, out, [this](float f) { return from_linear(f); });
+    }
+
+    template <typename C>
+    static void encode_values(std::span<const float> in, std::span<uint8_t> out, C&& curve) {
+        for (size_t i = 0; i < in.size(); i++) {
+            // Written so that NaN maps to 0 and huge values to 255.
+            float v = std::round(curve(in[i]) * 255.0f);
+            out[i] = v >= 255.0f ? 255 : v > 0.0f ? uint8_t(v) : 0;
+        }
+    }
+
+private:
+    mutable std::once_flag tableOnce;
+    mutable std::unique_ptr<const encoding_table> table;
 };
 
-class srgb_color_encoding : public color_encoding {
+// Base for encodings with static curves, Curves::decode and Curves::encode:
+// the per-value loops call them directly, so a curve inlines into the loop
+// instead of costing a virtual call per channel.
+template <typename Curves>
+class static_color_encoding : public color_encoding {
 public:
-    float to_linear(float f) const override {
-        return srgb_to_linear(f);
+    using color_encoding::to_linear;
+    using color_encoding::from_linear;
+
+    void to_linear(std::span<const uint8_t> in, std::span<float> out) const override {
+        for (size_t i = 0; i < in.size(); i++)
+            out[i] = Curves::decode(float(in[i]) / 255.0f);
     }
-    float from_linear(float f) const override {
-        return linear_to_srgb(f);
+
+    float to_linear(float f) const override { return Curves::decode(f); }
+    float from_linear(float f) const override { return Curves::encode(f); }
+
+protected:
+    void from_linear_values(std::span<const float> in, std::span<uint8_t> out) const override {
+        encode_values(in, out, [](float f) { return Curves::encode(f); });
     }
+};
+
+class srgb_color_encoding final : public static_color_encoding<srgb_color_encoding> {
+public:
+    static float decode(float f) { return srgb_to_linear(f); }
+    static float encode(float f) { return linear_to_srgb(f); }
 };
\ No newline at end of file
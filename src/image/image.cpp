@@ -1,84 +1,241 @@
 #include "image.h"
 
 #include <stb_image_write.h>
+#include <util/profiler.h>
+#include <bit>
+#include <cstdio>
 #include <cstring>
+#include <vector>
 
 template <int channels, typename T>
 void image2d<channels, T>::set_channel_raw(vec2i p, int c, T t) {
-    if (p.x < 0 || p.y < 0 || p.x >= resolution.x || p.y >= resolution.y) return;
-    contents[(p.y * resolution.x + p.x) * channels + c] = t;
+    if (!inside(p)) return;
+    contents[offset(p) + c] = t;
 }
 
 template <int channels, typename T>
 void image2d<channels, T>::set_channel(vec2i p, int c, float t) {
-    if (p.x < 0 || p.y < 0 || p.x >= resolution.x || p.y >= resolution.y) return;
-    set_channel_raw(p, c, encode_channel<T>(t));
+    if (!inside(p)) return;
+    contents[offset(p) + c] = encode_channel<T>(t);
 }
 
 template <int channels, typename T>
 T image2d<channels, T>::get_channel_raw(vec2i p, int c) {
-    if (p.x < 0 || p.y < 0 || p.x >= resolution.x || p.y >= resolution.y) return zero;
-    return contents[(p.y * resolution.x + p.x) * channels + c];
+    if (!inside(p)) return zero;
+    return contents[offset(p) + c];
 }
 
 template <int channels, typename T>
 float image2d<channels, T>::get_channel(vec2i p, int c) {
-    if (p.x < 0 || p.y < 0 || p.x >= resolution.x || p.y >= resolution.y) return 0.f;
-    return decode_channel(get_channel_raw(p, c));
+    if (!inside(p)) return 0.f;
+    return decode_channel(contents[offset(p) + c]);
 }
 
 template <int channels, typename T>
 void image2d<channels, T>::set_pixel_raw(vec2i p, std::span<const T, channels> t) {
-    if (p.x < 0 || p.y < 0 || p.x >= resolution.x || p.y >= resolution.y) return;
-    for (int i = 0; i < channels; i++) {
-        set_channel_raw(p, i, t[i]);
-    }
+    if (!inside(p)) return;
+    std::copy_n(t.data(), channels, contents + offset(p));
 }
 
 template <int channels, typename T>
 void image2d<channels, T>::set_pixel(vec2i p, std::span<const float, channels> t) {
-    if (p.x < 0 || p.y < 0 || p.x >= resolution.x || p.y >= resolution.y) return;
+    if (!inside(p)) return;
+    T* out = contents + offset(p);
     for (int i = 0; i < channels; i++) {
-        set_channel(p, i, t[i]);
+        out[i] = encode_channel<T>(t[i]);
     }
 }
 
 template<int channels, typename T>
 std::array<T, channels> image2d<channels, T>::get_pixel_raw(vec2i p) {
-    if (p.x < 0 || p.y < 0 || p.x >= resolution.x || p.y >= resolution.y) return pixel_zero_internal;
-    std::array<T, channels> pixel = fill_pixel(zero);
-    for (int i = 0; i < channels; i++) {
-        pixel[i] = get_channel_raw(p, i);
-    }
+    if (!inside(p)) return pixel_zero_internal;
+    std::array<T, channels> pixel;
+    std::copy_n(contents + offset(p), channels, pixel.data());
     return pixel;
 }
 
 template<int channels, typename T>
 std::array<float, channels> image2d<channels, T>::get_pixel(vec2i p) {
-    if (p.x < 0 || p.y < 0 || p.x >= resolution.x || p.y >= resolution.y) return pixel_zero;
-    std::array<float, channels> pixel = fill_pixel(0.f);
+    if (!inside(p)) return pixel_zero;
+    const T* in = contents + offset(p);
+    std::array<float, channels> pixel;
     for (int i = 0; i < channels; i++) {
-        pixel[i] = get_channel(p, i);
+        pixel[i] = decode_channel(in[i]);
     }
     return pixel;
 }
 
 template <int channels, typename T>
-void image2d<channels, T>::write_png(const std::string& filename) {
-    auto* data = new uint8_t[resolution.x * resolution.y * channels];
-    for (int x = 0; x < resolution.x; x++) {
-        for (int y = 0; y < resolution.y; y++) {
-            std::array<float, channels> in = get_pixel({x, y});
-            std::array<uint8_t, channels> out{};
-            encoding->from_linear(in, out);
-            std::memcpy(&data[(y * resolution.x + x) * channels], out.data(), channels);
-        }
-    }
+image2d<channels, T> image2d<channels, T>::to_layout(image_layout target) const {
+    if (target == layout) return *this;
+
+    image2d result;
+    result.resolution = resolution;
+    result.layout = target;
+    result.tilesX = tilesX;
+    result.encoding = encoding;
+    result.contents = new T[result.storage_size()];
+    if (target != image_layout::linear) std::fill_n(result.contents, result.storage_size(), zero);
+    for (int y = 0; y < resolution.y; y++)
+        for (int x = 0; x < resolution.x; x++)
+            std::copy_n(contents + offset({x, y}), channels, result.contents + result.offset({x, y}));
+    return result;
+}
+
+template <int channels, typename T>
+bool image2d<channels, T>::write_png(const std::string& filename) {
+    if (layout != image_layout::linear) return to_layout(image_layout::linear).write_png(filename);
+
+    size_t values = size_t(resolution.x) * resolution.y * channels;
+    auto* data = new uint8_t[values];
+    // Pixels are stored row-major with interleaved channels, the layout
+    // stb expects, so the whole buffer is encoded in one batch.
+    encoding->from_linear(std::span<const float>(contents, values), std::span<uint8_t>(data, values));
 
     stbi_flip_vertically_on_write(true);
-    stbi_write_png(filename.c_str(), resolution.x, resolution.y, channels, data, 0);
+    int ok = stbi_write_png(filename.c_str(), resolution.x, resolution.y, channels, data, 0);
 
     delete[] data;
+    return ok != 0;
+}
+
+namespace {
+
+void put_u32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out.push_back(uint8_t(v >> (8 * i)));
+}
+
+void put_u64(std::vector<uint8_t>& out, uint64_t v) {
+    for (int i = 0; i < 8; i++) out.push_back(uint8_t(v >> (8 * i)));
+}
+
+void put_f32(std::vector<uint8_t>& out, float f) {
+    put_u32(out, std::bit_cast<uint32_t>(f));
+}
+
+void put_string(std::vector<uint8_t>& out, const char* s) {
+    out.insert(out.end(), s, s + std::strlen(s) + 1);
+}
+
+void put_attribute(std::vector<uint8_t>& out, const char* name, const char* type, uint32_t size) {
+    put_string(out, name);
+    put_string(out, type);
+    put_u32(out, size);
+}
+
+bool write_file(const std::string& filename, const std::vector<uint8_t>& header, const std::vector<uint8_t>& body) {
+    std::FILE* file = std::fopen(filename.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size() &&
+              std::fwrite(body.data(), 1, body.size(), file) == body.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+}
+
+template <int channels, typename T>
+bool image2d<channels, T>::write_pfm(const std::string& filename) {
+    if (layout != image_layout::linear) return to_layout(image_layout::linear).write_pfm(filename);
+
+    constexpr int outChannels = channels == 1 ? 1 : 3;
+    char header[64];
+    int headerSize = std::snprintf(header, sizeof(header), "%s\n%d %d\n-1.0\n", outChannels == 1 ? "Pf" : "PF",
+                                   resolution.x, resolution.y);
+
+    // Little-endian, rows from bottom to top, which is the storage order.
+    std::vector<uint8_t> body;
+    body.reserve(size_t(resolution.x) * resolution.y * outChannels * 4);
+    for (int y = 0; y < resolution.y; y++) {
+        for (int x = 0; x < resolution.x; x++) {
+            const T* pixel = &contents[(size_t(y) * resolution.x + x) * channels];
+            for (int c = 0; c < outChannels; c++)
+                put_f32(body, c < channels ? decode_channel(pixel[c]) : 0.f);
+        }
+    }
+
+    return write_file(filename, std::vector<uint8_t>(header, header + headerSize), body);
+}
+
+template <int channels, typename T>
+bool image2d<channels, T>::write_exr(const std::string& filename) {
+    if (layout != image_layout::linear) return to_layout(image_layout::linear).write_exr(filename);
+
+    // Channel names in the alphabetical order OpenEXR requires, with the
+    // index of the stored channel each one comes from.
+    static constexpr std::pair<const char*, int> layouts[4][4] = {
+        {{"Y", 0}},
+        {{"A", 1}, {"Y", 0}},
+        {{"B", 2}, {"G", 1}, {"R", 0}},
+        {{"A", 3}, {"B", 2}, {"G", 1}, {"R", 0}},
+    };
+    const auto& layout = layouts[channels - 1];
+
+    std::vector<uint8_t> header = {0x76, 0x2f, 0x31, 0x01, 2, 0, 0, 0};
+
+    uint32_t channelListSize = 1;
+    for (int c = 0; c < channels; c++) channelListSize += uint32_t(std::strlen(layout[c].first)) + 1 + 16;
+    put_attribute(header, "channels", "chlist", channelListSize);
+    for (int c = 0; c < channels; c++) {
+        put_string(header, layout[c].first);
+        put_u32(header, 2); // FLOAT
+        put_u32(header, 0); // pLinear and reserved bytes
+        put_u32(header, 1);
+        put_u32(header, 1);
+    }
+    header.push_back(0);
+
+    put_attribute(header, "compression", "compression", 1);
+    header.push_back(0); // NO_COMPRESSION
+    for (const char* window : {"dataWindow", "displayWindow"}) {
+        put_attribute(header, window, "box2i", 16);
+        put_u32(header, 0);
+        put_u32(header, 0);
+        put_u32(header, uint32_t(resolution.x - 1));
+        put_u32(header, uint32_t(resolution.y - 1));
+    }
+    put_attribute(header, "lineOrder", "lineOrder", 1);
+    header.push_back(0); // INCREASING_Y
+    put_attribute(header, "pixelAspectRatio", "float", 4);
+    put_f32(header, 1.f);
+    put_attribute(header, "screenWindowCenter", "v2f", 8);
+    put_f32(header, 0.f);
+    put_f32(header, 0.f);
+    put_attribute(header, "screenWindowWidth", "float", 4);
+    put_f32(header, 1.f);
+    header.push_back(0);
+
+    // One scanline per block: the offset table, then for every line its y,
+    // its size and each channel's values in turn. EXR lines run top to
+    // bottom, the reverse of the storage order.
+    uint32_t lineBytes = uint32_t(resolution.x) * channels * 4;
+    uint64_t offset = header.size() + uint64_t(resolution.y) * 8;
+    for (int y = 0; y < resolution.y; y++, offset += 8 + lineBytes)
+        put_u64(header, offset);
+
+    std::vector<uint8_t> body;
+    body.reserve(size_t(resolution.y) * (8 + lineBytes));
+    for (int y = 0; y < resolution.y; y++) {
+        put_u32(body, uint32_t(y));
+        put_u32(body, lineBytes);
+        const T* row = &contents[size_t(resolution.y - 1 - y) * resolution.x * channels];
+        for (int c = 0; c < channels; c++)
+            for (int x = 0; x < resolution.x; x++)
+                put_f32(body, decode_channel(row[x * channels + layout[c].second]));
+    }
+
+    return write_file(filename, header, body);
+}
+
+template <int channels, typename T>
+bool image2d<channels, T>::write(const std::string& filename) {
+    profile_scope scope(profile_stage::image_write);
+    auto endsWith = [&](const char* suffix) {
+        size_t n = std::strlen(suffix);
+        return filename.size() >= n && filename.compare(filename.size() - n, n, suffix) == 0;
+    };
+    if (endsWith(".pfm")) return write_pfm(filename);
+    if (endsWith(".exr")) return write_exr(filename);
+    return write_png(filename);
 }
 
 template class image2d<1, float>;
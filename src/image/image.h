@@ -3,6 +3,11 @@
 #include <math/vec.h>
 #include <image/encoding.h>
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <span>
 #include <utility>
 #include <string>
 #include <memory>
@@ -17,14 +22,55 @@ inline constexpr float encode_channel(float v) { return v; }
 template <>
 inline constexpr float decode_channel(float t) { return t; }
 
+// Pixel storage order. Tiled layouts store image_tile_size^2 blocks
+// contiguously, in row-major block order, so the pixels of a render tile
+// or a filter footprint share cache lines; inside a block pixels are
+// row-major (tiled) or in Z order (morton). Rows and columns are padded
+// to whole blocks.
+enum class image_layout {
+    linear,
+    tiled,
+    morton
+};
+
+inline constexpr int image_tile_shift = 4;
+inline constexpr int image_tile_size = 1 << image_tile_shift;
+
+// Interleaves the low four bits of x and y.
+constexpr uint32_t morton_4bit(uint32_t x, uint32_t y) {
+    x = (x | (x << 2)) & 0x33u;
+    x = (x | (x << 1)) & 0x55u;
+    y = (y | (y << 2)) & 0x33u;
+    y = (y | (y << 1)) & 0x55u;
+    return x | (y << 1);
+}
+
 template <int channels = 3, typename T = float>
 class image2d {
 public:
     image2d() = default;
     template <typename E = color_encoding>
-    image2d(vec2i res, E encoding = {})
-        : resolution(res), encoding(std::make_unique<E>(encoding)) {
-        contents = new T[res.x * res.y * channels];
+    image2d(vec2i res, E encoding = {}, image_layout layout = image_layout::linear)
+        : resolution(res), layout(layout), encoding(std::make_shared<E>(encoding)) {
+        tilesX = (res.x + image_tile_size - 1) >> image_tile_shift;
+        contents = new T[storage_size()];
+    }
+    // Copies share the (immutable) encoding and duplicate the pixels.
+    image2d(const image2d& other)
+        : resolution(other.resolution), layout(other.layout), tilesX(other.tilesX), encoding(other.encoding) {
+        contents = new T[storage_size()];
+        std::copy_n(other.contents, storage_size(), contents);
+    }
+    image2d(image2d&& other) noexcept
+        : resolution(other.resolution), layout(other.layout), tilesX(other.tilesX),
+          contents(std::exchange(other.contents, nullptr)), encoding(std::move(other.encoding)) {}
+    image2d& operator=(image2d other) noexcept {
+        std::swap(resolution, other.resolution);
+        std::swap(layout, other.layout);
+        std::swap(tilesX, other.tilesX);
+        std::swap(contents, other.contents);
+        std::swap(encoding, other.encoding);
+        return *this;
     }
     ~image2d() {
         delete[] contents;
@@ -42,20 +88,76 @@ public:
     std::array<T, channels> get_pixel_raw(vec2i p);
     std::array<float, channels> get_pixel(vec2i p);
 
-    void write_png(const std::string& filename);
+    // Unchecked access for hot loops; p must lie inside the image.
+    std::span<T, channels> pixel(vec2i p) {
+        return std::span<T, channels>(contents + offset(p), channels);
+    }
+    std::span<const T, channels> pixel(vec2i p) const {
+        return std::span<const T, channels>(contents + offset(p), channels);
+    }
+
+    // Contiguous row of a linear image.
+    std::span<T> row(int y) {
+        assert(layout == image_layout::linear);
+        return {contents + size_t(y) * resolution.x * channels, size_t(resolution.x) * channels};
+    }
+    // Contiguous image_tile_size^2 block at block coordinates (tx, ty) of a
+    // tiled or morton image, in the layout's order within the block.
+    std::span<T> tile(int tx, int ty) {
+        assert(layout != image_layout::linear);
+        size_t values = size_t(image_tile_size) * image_tile_size * channels;
+        return {contents + (size_t(ty) * tilesX + tx) * values, values};
+    }
+    // The whole storage, including any padding of tiled layouts.
+    std::span<T> data() { return {contents, storage_size()}; }
+    std::span<const T> data() const { return {contents, storage_size()}; }
+
+    image_layout storage_layout() const { return layout; }
+    // Copy of the image in another layout; writers convert to linear first.
+    image2d to_layout(image_layout target) const;
+
+    bool write_png(const std::string& filename);
+    // Uncompressed float outputs. PFM holds one or three channels, so other
+    // channel counts are written as three.
+    bool write_pfm(const std::string& filename);
+    bool write_exr(const std::string& filename);
+    // Picks the format from the file extension, defaulting to PNG.
+    bool write(const std::string& filename);
 
-    int width() { return resolution.x; }
-    int height() { return resolution.y; }
+    size_t memory_bytes() const { return storage_size() * sizeof(T); }
 
-    vec2i dimensions() {
+    int width() const { return resolution.x; }
+    int height() const { return resolution.y; }
+
+    vec2i dimensions() const {
         return resolution;
     }
 
+    bool inside(vec2i p) const {
+        return p.x >= 0 && p.y >= 0 && p.x < resolution.x && p.y < resolution.y;
+    }
+
 private:
-    vec2i resolution;
-    T* contents;
-    std::unique_ptr<color_encoding> encoding;
+    vec2i resolution{0, 0};
+    image_layout layout = image_layout::linear;
+    int tilesX = 0;
+    T* contents = nullptr;
+    std::shared_ptr<const color_encoding> encoding;
+
+    size_t storage_size() const {
+        if (layout == image_layout::linear) return size_t(resolution.x) * resolution.y * channels;
+        size_t tilesY = (resolution.y + image_tile_size - 1) >> image_tile_shift;
+        return size_t(tilesX) * tilesY * image_tile_size * image_tile_size * channels;
+    }
 
+    size_t offset(vec2i p) const {
+        if (layout == image_layout::linear) return (size_t(p.y) * resolution.x + p.x) * channels;
+        constexpr uint32_t mask = image_tile_size - 1;
+        size_t block = size_t(p.y >> image_tile_shift) * tilesX + (p.x >> image_tile_shift);
+        uint32_t x = uint32_t(p.x) & mask, y = uint32_t(p.y) & mask;
+        uint32_t inner = layout == image_layout::tiled ? (y << image_tile_shift | x) : morton_4bit(x, y);
+        return ((block << (2 * image_tile_shift)) + inner) * channels;
+    }
     template <typename U, std::size_t... Is>
     static constexpr std::array<U, channels> fill_pixel(std::index_sequence<Is...>, const U& value) {
         return std::array<U, channels>({((void) Is, value)...});
@@ -0,0 +1,55 @@
+#include "image_writer.h"
+
+image_writer::image_writer(size_t memoryBudget)
+    : memoryBudget(memoryBudget), thread(&image_writer::run, this) {}
+
+image_writer::~image_writer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    thread.join();
+}
+
+void image_writer::reserve(size_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex);
+    // A frame larger than the whole budget is still accepted once nothing
+    // else is pending.
+    changed.wait(lock, [&] { return pendingBytes == 0 || pendingBytes + bytes <= memoryBudget; });
+    pendingBytes += bytes;
+}
+
+void image_writer::push(job j) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(j));
+    }
+    changed.notify_all();
+}
+
+int image_writer::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&] { return jobs.empty() && !busy; });
+    return std::exchange(failures, 0);
+}
+
+void image_writer::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [&] { return stopping || !jobs.empty(); });
+        if (jobs.empty()) return;
+
+        job next = std::move(jobs.front());
+        jobs.pop_front();
+        busy = true;
+        lock.unlock();
+        bool ok = next.write();
+        next.write = nullptr;
+        lock.lock();
+        busy = false;
+        if (!ok) failures++;
+        pendingBytes -= next.bytes;
+        changed.notify_all();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <image/image.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Background image output. write() snapshots the image on the calling
+// thread and returns; a dedicated thread encodes and writes the snapshots
+// in submission order. Snapshots waiting in the queue are limited to
+// memoryBudget bytes; a write that would exceed it blocks until earlier
+// frames are on disk, so rendering is throttled rather than frames dropped.
+class image_writer {
+public:
+    explicit image_writer(size_t memoryBudget = size_t(512) << 20);
+    ~image_writer();
+
+    image_writer(const image_writer&) = delete;
+    image_writer& operator=(const image_writer&) = delete;
+
+    template <int channels>
+    void write(const image2d<channels, float>& image, std::string filename) {
+        size_t bytes = image.memory_bytes();
+        reserve(bytes);
+        push({bytes, [snapshot = image, filename = std::move(filename)]() mutable {
+            return snapshot.write(filename);
+        }});
+    }
+
+    // Blocks until every queued image has been written. Returns the number
+    // of writes that failed since the last call.
+    int flush();
+
+private:
+    struct job {
+        size_t bytes;
+        std::function<bool()> write;
+    };
+
+    size_t memoryBudget;
+    size_t pendingBytes = 0;
+    int failures = 0;
+    bool busy = false;
+    bool stopping = false;
+    std::deque<job> jobs;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread thread;
+
+    // Waits until bytes fit in the budget and claims them, so the snapshot
+    // is only taken once there is room for it.
+    void reserve(size_t bytes);
+    void push(job j);
+    void run();
+};
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "path.h"
+
+#include <material/bsdf.h>
+#include <math/sampling.h>
+#include <util/profiler.h>
+
+camera_sample_ctx camera_sample(const sampler& sampler, vec2i pixel, uint32_t index, const render_options& options) {
+    if (options.spp == 1) return {vec2f(pixel.x, pixel.y)};
+    // Film, lens and time dimensions are adjacent, so one call draws them.
+    static_assert(lens_dimension == film_dimension + 2 && time_dimension == lens_dimension + 2);
+    float u[5];
+    sampler.get_dimensions(pixel, index, film_dimension, u);
+    return {vec2f(pixel.x + u[0] - 0.5f, pixel.y + u[1] - 0.5f), vec2f(u[2], u[3]), u[4]};
+}
+
+float path::pick_light(const scene& scene, vec3f p, vec3f n, float u, uint32_t& light) {
+    if (scene.light_sampling) {
+        std::optional<sampled_light> picked = scene.light_sampling->sample(p, n, u);
+        if (!picked) return 0;
+        light = picked->light;
+        return picked->pmf;
+    }
+    uint32_t count = scene.light_count();
+    if (count == 0) return 0;
+    light = std::min(uint32_t(u * float(count)), count - 1);
+    return 1.f / float(count);
+}
+
+float path::light_pmf(const scene& scene, vec3f p, vec3f n, uint32_t light) {
+    if (scene.light_sampling) return scene.light_sampling->pmf(p, n, light);
+    uint32_t count = scene.light_count();
+    return count == 0 ? 0 : 1.f / float(count);
+}
+
+bool path::direct_lighting(const scene& scene, const shape_isect& isect, const material& m, vec3f wo, vec3f beta,
+                           float time, float uLight, vec2f uSurface, shadow_query& query) {
+    if (m.type != material_type::diffuse) return false;
+    uint32_t light = 0;
+    float pmf = pick_light(scene, isect.p, isect.n, uLight, light);
+    if (pmf == 0) return false;
+    std::optional<light_sample> ls = scene.sample_light(light, isect.p, uSurface);
+    if (!ls) return false;
+
+    vec3f f = eval_bsdf(m, isect.n, wo, ls->wi) * std::abs(dot(isect.n, ls->wi));
+    if (max_of(f) == 0 || max_of(ls->L) == 0) return false;
+    float lightPdf = pmf * ls->pdf;
+    float weight = ls->delta ? 1 : power_heuristic(lightPdf, bsdf_pdf(m, isect.n, wo, ls->wi));
+
+    // Stop short of the light so that its own surface does not occlude it.
+    query = {spawn_ray(isect, ls->wi, time), ls->distance * (1 - 1e-3f),
+             mul(mul(beta, f), ls->L) * (weight / lightPdf)};
+    return true;
+}
+
+vec3f path::emitted(const scene& scene, const shape_isect& isect, const material& m, vec3f wo,
+                    const path_vertex& prev) {
+    if (!m.is_emissive()) return vec3f(0.f);
+    if (prev.specular || isect.light == no_light) return m.emission;
+    float lightPdf = light_pmf(scene, prev.p, prev.n, scene.area_light_index(isect.light)) *
+                     scene.area_lights[isect.light].pdf(wo, isect.t);
+    return m.emission * power_heuristic(prev.pdf, lightPdf);
+}
+
+bool path::scatter(const shape_isect& isect, const material& m, vec3f wo, vec2f u, vec3f& beta, ray& r,
+                   path_vertex& prev) {
+    std::optional<bsdf_sample> bs = sample_bsdf(m, isect.n, wo, u);
+    if (!bs || bs->pdf == 0) return false;
+    beta = mul(beta, bs->f * (std::abs(dot(bs->wi, isect.n)) / bs->pdf));
+    r = spawn_ray(isect, bs->wi, r.time());
+    prev = {isect.p, isect.n, bs->pdf, bs->specular};
+    return true;
+}
+
+bool path::survives(int depth, float u, vec3f& beta) {
+    if (depth + 1 < roulette_depth) return true;
+    float p = std::min(1.f, max_of(beta));
+    if (u >= p) return false;
+    beta = beta / p;
+    return true;
+}
+
+material path::shading_material(const scene& scene, const camera& camera, int samplesPerPixel,
+                                const shape_isect& isect) {
+    material m = scene.material_of(isect);
+    if (m.albedo_texture == no_texture) return m;
+    // Ray differentials are not tracked along paths; every hit is filtered
+    // as if the camera saw it directly.
+    vec3f dpdx, dpdy;
+    camera.approximate_dp_dxy(isect.p, isect.n, samplesPerPixel, dpdx, dpdy);
+    float width = uv_filter_width(isect.dpdu, isect.dpdv, dpdx, dpdy) * m.texture_scale;
+    m.albedo = scene.textures[m.albedo_texture]->lookup(isect.uv * m.texture_scale, width);
+    return m;
+}
+
+vec3f path_integrator::li(ray r, const sampler& sampler, vec2i pixel, uint32_t index, integrator_stats& stats) const {
+    vec3f L(0.f), beta(1.f);
+    path_vertex prev;
+    for (int depth = 0;; depth++) {
+        stats.rays++;
+        profile_count(profile_counter::rays);
+        std::optional<shape_isect> hit = world.geometry ? world.geometry->intersect(r) : std::nullopt;
+        if (!hit) {
+            L += mul(beta, world.sky);
+            break;
+        }
+        vec3f wo = -r.direction();
+        shape_isect isect = path::face_forward(*hit, wo);
+        material m = path::shading_material(world, cam, samplesPerPixel, isect);
+        L += mul(beta, path::emitted(world, isect, m, wo, prev));
+        if (depth == maxDepth) break;
+
+        shadow_query query;
+        if (path::direct_lighting(world, isect, m, wo, beta, r.time(),
+                                  sampler.get_1d(pixel, index, light_dimension(depth)),
+                                  sampler.get_2d(pixel, index, light_dimension(depth) + 1), query)) {
+            stats.shadow_rays++;
+            profile_count(profile_counter::shadow_rays);
+            if (!world.geometry->intersects(query.r, query.t_max)) L += query.contribution;
+        }
+
+        if (!path::scatter(isect, m, wo, sampler.get_2d(pixel, index, bsdf_dimension(depth)), beta, r, prev)) break;
+        if (!path::survives(depth, sampler.get_1d(pixel, index, roulette_dimension(depth)), beta)) break;
+    }
+    return L;
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <scene/scene.h>
+#include <camera/camera.h>
+#include <sampler/sampler.h>
+#include <render/renderer.h>
+
+#include <cstdint>
+
+struct integrator_stats {
+    uint64_t rays = 0;
+    uint64_t shadow_rays = 0;
+};
+
+// Camera sample for a pixel. A single sample per pixel stays at the pixel
+// origin so that one-sample renders are unchanged.
+camera_sample_ctx camera_sample(const sampler& sampler, vec2i pixel, uint32_t index, const render_options& options);
+
+// Sampler dimensions of each bounce: two for the BSDF, three to pick and
+// sample a light and one for Russian roulette. Both integrators draw them
+// the same way, so for the same sampler they trace the same paths.
+inline constexpr uint32_t bounce_dimensions = 6;
+
+inline uint32_t bsdf_dimension(int depth) {
+    return integrator_dimension + bounce_dimensions * uint32_t(depth);
+}
+inline uint32_t light_dimension(int depth) {
+    return bsdf_dimension(depth) + 2;
+}
+inline uint32_t roulette_dimension(int depth) {
+    return bsdf_dimension(depth) + 5;
+}
+
+// A shadow ray and what it adds to the path's radiance if nothing blocks
+// it.
+struct shadow_query {
+    ray r;
+    float t_max;
+    vec3f contribution;
+};
+
+// Where a path last scattered and with what density, to weight emission it
+// finds by BSDF sampling against sampling the light from there.
+struct path_vertex {
+    vec3f p = vec3f(0.f);
+    vec3f n = vec3f(0.f);
+    float pdf = 0;
+    // Camera rays and specular bounces cannot be matched by light sampling,
+    // so what they find counts fully.
+    bool specular = true;
+};
+
+// Shading steps shared by the integrators. The hit's normal must face the
+// side the path arrived from (see face_forward).
+namespace path {
+    // Paths are first offered to Russian roulette after this many bounces.
+    inline constexpr int roulette_depth = 3;
+
+    // Chooses the light to sample from a hit at p, returning its
+    // probability, or 0 when the scene has no lights.
+    float pick_light(const scene& scene, vec3f p, vec3f n, float u, uint32_t& light);
+    float light_pmf(const scene& scene, vec3f p, vec3f n, uint32_t light);
+
+    // Next-event estimation: samples one light and writes the shadow query
+    // that adds its contribution, weighted by MIS against BSDF sampling and
+    // with the path throughput beta folded in. False when there is nothing
+    // to trace.
+    bool direct_lighting(const scene& scene, const shape_isect& isect, const material& m, vec3f wo, vec3f beta,
+                         float time, float uLight, vec2f uSurface, shadow_query& query);
+
+    // Emission of a hit reached from prev, weighted by MIS against light
+    // sampling at prev.
+    vec3f emitted(const scene& scene, const shape_isect& isect, const material& m, vec3f wo,
+                  const path_vertex& prev);
+
+    // Samples the continuation of the path, updating beta, r and prev;
+    // false ends it.
+    bool scatter(const shape_isect& isect, const material& m, vec3f wo, vec2f u, vec3f& beta, ray& r,
+                 path_vertex& prev);
+
+    // Russian roulette after the first bounces: ends paths with probability
+    // falling with their throughput and scales up the survivors, so the
+    // estimate stays unbiased. False ends the path.
+    bool survives(int depth, float u, vec3f& beta);
+
+    // The hit's material with its textures looked up, filtered over the
+    // footprint of a pixel around the hit.
+    material shading_material(const scene& scene, const camera& camera, int samplesPerPixel,
+                              const shape_isect& isect);
+
+    inline shape_isect face_forward(shape_isect isect, vec3f wo) {
+        if (dot(isect.n, wo) < 0) isect.n = -isect.n;
+        return isect;
+    }
+}
+
+// Unidirectional path tracer that follows one path at a time, bounce by
+// bounce. Every non-specular hit samples one light, weighted by MIS against
+// BSDF sampling, and Russian roulette ends paths that carry little.
+class path_integrator {
+public:
+    path_integrator(const scene& scene, const camera& camera, int samplesPerPixel = 1, int maxDepth = 16)
+        : world(scene), cam(camera), samplesPerPixel(samplesPerPixel), maxDepth(maxDepth) {}
+
+    vec3f li(ray r, const sampler& sampler, vec2i pixel, uint32_t index, integrator_stats& stats) const;
+
+private:
+    const scene& world;
+    const camera& cam;
+    int samplesPerPixel;
+    int maxDepth;
+};
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "wavefront.h"
+
+#include <render/thread_pool.h>
+#include <util/arena.h>
+#include <util/profiler.h>
+
+namespace {
+
+constexpr int64_t kernel_grain = 1 << 12;
+
+// Stable counting sort of items by a small integer key, in parallel
+// chunks. starts receives the first position of every key, plus the end,
+// and must hold keys + 1 entries.
+template <typename K>
+void sort_by_key(std::span<const uint32_t> items, int keys, K&& key, std::span<uint32_t> sorted,
+                 std::span<size_t> starts) {
+    constexpr size_t chunk = 1 << 14;
+    int64_t chunks = int64_t((items.size() + chunk - 1) / chunk);
+    memory_arena::scope scratch(thread_arena());
+    std::span<size_t> offsets = thread_arena().alloc<size_t>(size_t(chunks) * keys);
+    parallel_for(0, chunks, 1, [&](int64_t c) {
+        size_t end = std::min(items.size(), size_t(c + 1) * chunk);
+        for (size_t i = size_t(c) * chunk; i < end; i++)
+            offsets[size_t(c) * keys + key(items[i])]++;
+    });
+
+    size_t total = 0;
+    for (int k = 0; k < keys; k++) {
+        starts[k] = total;
+        for (int64_t c = 0; c < chunks; c++) {
+            size_t count = offsets[size_t(c) * keys + k];
+            offsets[size_t(c) * keys + k] = total;
+            total += count;
+        }
+    }
+    starts[keys] = total;
+
+    parallel_for(0, chunks, 1, [&](int64_t c) {
+        size_t end = std::min(items.size(), size_t(c + 1) * chunk);
+        for (size_t i = size_t(c) * chunk; i < end; i++)
+            sorted[offsets[size_t(c) * keys + key(items[i])]++] = items[i];
+    });
+}
+
+}
+
+void wavefront_integrator::trace(std::span<const path_sample> samples, const render_options& options,
+                                 std::span<vec3f> radiance, std::span<render_cost> costs,
+                                 integrator_stats& stats) const {
+    size_t n = samples.size();
+
+    // Path state, one slot per sample, in the arena so that later waves
+    // reuse the memory of the first.
+    memory_arena& arena = thread_arena();
+    memory_arena::scope scratch(arena);
+    std::span<float> ox = arena.alloc<float>(n), oy = arena.alloc<float>(n), oz = arena.alloc<float>(n);
+    std::span<float> dx = arena.alloc<float>(n), dy = arena.alloc<float>(n), dz = arena.alloc<float>(n);
+    std::span<float> time = arena.alloc<float>(n);
+    std::span<vec3f> beta = arena.alloc<vec3f>(n);
+    std::span<path_vertex> prev = arena.alloc<path_vertex>(n);
+    std::span<shape_isect> hits = arena.alloc<shape_isect>(n);
+    std::span<uint8_t> hit = arena.alloc<uint8_t>(n), alive = arena.alloc<uint8_t>(n);
+    std::span<shadow_query> queries = arena.alloc<shadow_query>(n);
+    std::span<uint8_t> queued = arena.alloc<uint8_t>(n);
+
+    auto load_ray = [&](uint32_t i) { return ray{vec3f(ox[i], oy[i], oz[i]), vec3f(dx[i], dy[i], dz[i]), time[i]}; };
+    auto store_ray = [&](uint32_t i, const ray& r) {
+        vec3f o = r.origin(), d = r.direction();
+        ox[i] = o.x, oy[i] = o.y, oz[i] = o.z;
+        dx[i] = d.x, dy[i] = d.y, dz[i] = d.z;
+        time[i] = r.time();
+    };
+
+    // Charges a sample with the work done on this thread since start; a
+    // packet's work is split over its lanes so that the totals add up.
+    bool measuring = !costs.empty();
+    auto charge = [&](uint32_t i, const render_cost& start, int lane = 0, int lanes = 1) {
+        render_cost cost = render_cost::now() - start;
+        auto share = [&](auto total) { return total / lanes + (lane < int(total % lanes)); };
+        costs[i].bvh_nodes += share(cost.bvh_nodes);
+        costs[i].primitive_tests += share(cost.primitive_tests);
+        costs[i].ns += share(cost.ns);
+    };
+
+    // Generate.
+    {
+        profile_scope scope(profile_stage::wave_generate);
+        parallel_for(0, int64_t(n), kernel_grain, [&](int64_t i) {
+            render_cost start = measuring ? render_cost::now() : render_cost{};
+            if (measuring) costs[i] = {};
+            radiance[i] = vec3f(0.f);
+            beta[i] = vec3f(1.f);
+            std::optional<ray> r = cam.generate_ray(camera_sample(samp, samples[i].pixel, samples[i].index, options));
+            alive[i] = r.has_value();
+            if (r) store_ray(uint32_t(i), *r);
+            if (measuring) charge(uint32_t(i), start);
+        });
+    }
+    std::span<uint32_t> active = arena.alloc<uint32_t>(n), sorted = arena.alloc<uint32_t>(n);
+    size_t activeCount = 0;
+    for (uint32_t i = 0; i < n; i++)
+        if (alive[i]) active[activeCount++] = i;
+
+    std::span<size_t> starts = arena.alloc<size_t>(1 + std::max(8, 1 + material_type_count));
+    for (int depth = 0; activeCount > 0; depth++) {
+        active = active.first(activeCount);
+        sorted = sorted.first(activeCount);
+        stats.rays += active.size();
+        profile_count(profile_counter::rays, active.size());
+
+        // Intersect, in packets of rays from the same direction octant.
+        std::optional<profile_scope> stage(std::in_place, profile_stage::wave_intersect);
+        sort_by_key(active, 8, [&](uint32_t i) { return (dx[i] < 0) | (dy[i] < 0) << 1 | (dz[i] < 0) << 2; },
+                    sorted, starts);
+        int64_t packets = int64_t((sorted.size() + packet_width - 1) / packet_width);
+        parallel_for(0, packets, kernel_grain / packet_width, [&](int64_t p) {
+            render_cost start = measuring ? render_cost::now() : render_cost{};
+            size_t first = size_t(p) * packet_width;
+            int count = int(std::min(size_t(packet_width), sorted.size() - first));
+            ray_packet rays;
+            rays.active = 0;
+            for (int j = 0; j < count; j++)
+                rays.set(j, load_ray(sorted[first + j]));
+            shape_isect_packet isects;
+            if (world.geometry) world.geometry->intersect(rays, isects);
+            for (int j = 0; j < count; j++) {
+                uint32_t i = sorted[first + j];
+                hit[i] = (isects.mask >> j) & 1;
+                if (hit[i]) hits[i] = isects.hits[j];
+            }
+            if (measuring) {
+                for (int j = 0; j < count; j++)
+                    charge(sorted[first + j], start, j, count);
+            }
+        });
+
+        // Shade: escaped paths first, then one pass per material type.
+        stage.emplace(profile_stage::wave_shade);
+        sort_by_key(sorted, 1 + material_type_count, [&](uint32_t i) {
+            return hit[i] ? 1 + int(world.material_of(hits[i]).type) : 0;
+        }, active, starts);
+
+        parallel_for(int64_t(starts[0]), int64_t(starts[1]), kernel_grain, [&](int64_t k) {
+            uint32_t i = active[k];
+            render_cost start = measuring ? render_cost::now() : render_cost{};
+            radiance[i] += mul(beta[i], world.sky);
+            alive[i] = false;
+            queued[i] = false;
+            if (measuring) charge(i, start);
+        });
+        for (int type = 0; type < material_type_count; type++) {
+            parallel_for(int64_t(starts[1 + type]), int64_t(starts[2 + type]), kernel_grain, [&](int64_t k) {
+                uint32_t i = active[k];
+                render_cost start = measuring ? render_cost::now() : render_cost{};
+                ray r = load_ray(i);
+                vec3f wo = -r.direction();
+                shape_isect isect = path::face_forward(hits[i], wo);
+                material m = path::shading_material(world, cam, options.spp, isect);
+                radiance[i] += mul(beta[i], path::emitted(world, isect, m, wo, prev[i]));
+                queued[i] = false;
+                if (depth == maxDepth) {
+                    alive[i] = false;
+                    if (measuring) charge(i, start);
+                    return;
+                }
+                vec2i pixel = samples[i].pixel;
+                uint32_t index = samples[i].index;
+                queued[i] = path::direct_lighting(world, isect, m, wo, beta[i], r.time(),
+                                                  samp.get_1d(pixel, index, light_dimension(depth)),
+                                                  samp.get_2d(pixel, index, light_dimension(depth) + 1), queries[i]);
+                alive[i] = path::scatter(isect, m, wo, samp.get_2d(pixel, index, bsdf_dimension(depth)), beta[i], r,
+                                         prev[i]) &&
+                           path::survives(depth, samp.get_1d(pixel, index, roulette_dimension(depth)), beta[i]);
+                if (alive[i]) store_ray(i, r);
+                if (measuring) charge(i, start);
+            });
+        }
+
+        // Shadow rays, added after the hit's emission as in the per-path
+        // integrator so that both sum in the same order.
+        stage.emplace(profile_stage::wave_shadow);
+        if (world.light_count() > 0) {
+            parallel_for(int64_t(starts[1]), int64_t(active.size()), kernel_grain, [&](int64_t k) {
+                uint32_t i = active[k];
+                render_cost start = measuring ? render_cost::now() : render_cost{};
+                if (queued[i] && !world.geometry->intersects(queries[i].r, queries[i].t_max))
+                    radiance[i] += queries[i].contribution;
+                if (measuring) charge(i, start);
+            });
+        }
+
+        stage.emplace(profile_stage::wave_compact);
+        size_t next = 0, shadowRays = 0;
+        for (size_t k = starts[1]; k < active.size(); k++) {
+            shadowRays += queued[active[k]];
+            if (alive[active[k]]) active[next++] = active[k];
+        }
+        stats.shadow_rays += shadowRays;
+        profile_count(profile_counter::shadow_rays, shadowRays);
+        activeCount = next;
+    }
+}
+
+void wavefront_integrator::render(film& film, const render_options& options, integrator_stats& stats,
+                                  cost_aovs* aovs) const {
+    vec2i resolution = film.dimensions();
+    std::vector<path_sample> samples;
+    std::vector<vec3f> radiance;
+    std::vector<render_cost> costs;
+
+    int taken = 0;
+    while (taken < options.spp) {
+        int passSamples = taken == 0 ? (options.adaptive() ? std::min(options.min_spp, options.spp) : options.spp)
+                                     : std::min(options.pass_spp, options.spp - taken);
+
+        samples.clear();
+        for (int y = 0; y < resolution.y; y++) {
+            for (int x = 0; x < resolution.x; x++) {
+                if (!needs_samples(film, {x, y}, options)) continue;
+                uint32_t first = film.samples({x, y});
+                uint32_t count = std::min(uint32_t(passSamples), uint32_t(options.spp) - first);
+                for (uint32_t s = 0; s < count; s++)
+                    samples.push_back({{x, y}, first + s});
+            }
+        }
+
+        for (size_t begin = 0; begin < samples.size(); begin += waveSize) {
+            std::span<const path_sample> wave(samples.data() + begin, std::min(waveSize, samples.size() - begin));
+            radiance.resize(wave.size());
+            if (aovs) costs.resize(wave.size());
+            trace(wave, options, radiance, costs, stats);
+
+            // Samples of a pixel are adjacent; chunks start on a pixel
+            // boundary so that no two threads update the same pixel.
+            auto boundary = [&](size_t k) {
+                while (k > 0 && k < wave.size() && wave[k].pixel == wave[k - 1].pixel) k++;
+                return std::min(k, wave.size());
+            };
+            profile_scope scope(profile_stage::film_add);
+            int64_t chunks = int64_t((wave.size() + kernel_grain - 1) / kernel_grain);
+            parallel_for(0, chunks, 1, [&](int64_t c) {
+                size_t end = boundary(size_t(c + 1) * kernel_grain);
+                for (size_t k = boundary(size_t(c) * kernel_grain); k < end; k++) {
+                    film.add_sample(wave[k].pixel, radiance[k]);
+                    if (aovs) aovs->add(wave[k].pixel, costs[k]);
+                }
+            });
+        }
+        taken += passSamples;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <integrator/path.h>
+#include <render/cost_aovs.h>
+#include <render/film.h>
+
+#include <cstddef>
+
+// Path tracer that advances a whole wave of paths one stage at a time
+// instead of one path to its end: generate camera rays, find hits, shade
+// each material type in its own pass, trace the shadow rays, and repeat
+// with the paths still alive. Paths live in structure-of-arrays queues;
+// rays are sorted by direction octant before intersection so that packets
+// stay coherent, and hits by material before shading so that each pass
+// runs one material's code over a contiguous batch. Every stage is a
+// parallel loop over the pool.
+//
+// It shades exactly like path_integrator, so for the same sampler the two
+// produce the same image.
+class wavefront_integrator {
+public:
+    wavefront_integrator(const scene& scene, const camera& camera, const sampler& sampler, int maxDepth = 16,
+                         size_t waveSize = size_t(1) << 20)
+        : world(scene), cam(camera), samp(sampler), maxDepth(maxDepth), waveSize(waveSize) {}
+
+    // Same passes and convergence test as render_progressive; samples are
+    // added to every pixel in index order. With aovs, the cost of each
+    // stage is charged to the samples it worked on.
+    void render(film& film, const render_options& options, integrator_stats& stats,
+                cost_aovs* aovs = nullptr) const;
+
+private:
+    const scene& world;
+    const camera& cam;
+    const sampler& samp;
+    int maxDepth;
+    size_t waveSize;
+
+    struct path_sample {
+        vec2i pixel;
+        uint32_t index;
+    };
+
+    // costs is empty unless measuring.
+    void trace(std::span<const path_sample> samples, const render_options& options, std::span<vec3f> radiance,
+               std::span<render_cost> costs, integrator_stats& stats) const;
+};
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <math/vec.h>
+#include <common.h>
+
+#include <cmath>
+#include <optional>
+
+// Incident light at a point from one light: radiance L arriving along the
+// unit direction wi, from a source distance away. pdf is per unit solid
+// angle, or 1 for delta lights that only shadow rays can find.
+struct light_sample {
+    vec3f L;
+    vec3f wi;
+    float distance;
+    float pdf;
+    bool delta;
+};
+
+// Light arriving from a single direction, like the sun. It is a delta
+// distribution, so only shadow rays towards it can find it.
+struct distant_light {
+    // Unit vector from the scene towards the light.
+    vec3f direction;
+    // Irradiance on a surface facing the light.
+    vec3f radiance;
+
+    light_sample sample() const { return {radiance, direction, infinity, 1, true}; }
+};
+
+// Light emitted equally in all directions from a point.
+struct point_light {
+    vec3f position;
+    vec3f intensity;
+
+    std::optional<light_sample> sample(vec3f p) const {
+        vec3f d = position - p;
+        float distance2 = length_sqr(d);
+        if (distance2 == 0) return {};
+        float distance = std::sqrt(distance2);
+        return light_sample{intensity / distance2, d / distance, distance, 1, true};
+    }
+};
+
+// Emissive triangle in render space, emitting radiance from both sides.
+// It is the light behind the hits of emissive geometry, so it is sampled
+// by area and can also be found by BSDF sampling.
+struct triangle_light {
+    vec3f p0, p1, p2;
+    vec3f radiance;
+
+    vec3f normal() const { return normalize(cross(p1 - p0, p2 - p0)); }
+    float area() const { return 0.5f * length(cross(p1 - p0, p2 - p0)); }
+
+    // Uniform by area, as a density over directions from p.
+    std::optional<light_sample> sample(vec3f p, vec2f u) const {
+        float su = std::sqrt(u.x);
+        float b1 = 1 - su, b2 = u.y * su;
+        vec3f d = p0 + (p1 - p0) * b1 + (p2 - p0) * b2 - p;
+        float distance2 = length_sqr(d);
+        if (distance2 == 0) return {};
+        float distance = std::sqrt(distance2);
+        vec3f wi = d / distance;
+        float density = pdf(wi, distance);
+        if (density == 0 || std::isinf(density)) return {};
+        return light_sample{radiance, wi, distance, density, false};
+    }
+
+    // Solid angle density of sample() for the point distance along wi.
+    float pdf(vec3f wi, float distance) const {
+        vec3f n = cross(p1 - p0, p2 - p0);
+        float cosTheta = std::abs(dot(n, wi));
+        if (cosTheta == 0) return 0;
+        // |n| is twice the area, which cancels in cos / area.
+        return 2 * distance * distance / cosTheta;
+    }
+};
\ No newline at end of file
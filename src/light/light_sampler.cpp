@@ -0,0 +1,50 @@
+#include "light_sampler.h"
+
+#include <color/color.h>
+#include <math/util.h>
+
+#include <algorithm>
+
+std::vector<float> light_power(const light_lists& lights, const bounds3f& sceneBounds) {
+    std::vector<float> power;
+    power.reserve(lights.size());
+    float radius = sceneBounds.is_empty() ? 0 : 0.5f * length(sceneBounds.diagonal());
+    for (const distant_light& light : lights.distant)
+        power.push_back(luminance(light.radiance) * pi * radius * radius);
+    for (const point_light& light : lights.point)
+        power.push_back(4 * pi * luminance(light.intensity));
+    // Both sides emit into a hemisphere each.
+    for (const triangle_light& light : lights.area)
+        power.push_back(2 * pi * luminance(light.radiance) * light.area());
+    return power;
+}
+
+power_light_sampler::power_light_sampler(const light_lists& lights, const bounds3f& sceneBounds)
+    : probability(light_power(lights, sceneBounds)) {
+    double total = 0;
+    for (float power : probability)
+        total += power;
+    // Without any power to go by, every light is as likely.
+    for (float& p : probability)
+        p = total > 0 ? float(p / total) : 1.f / float(probability.size());
+
+    cdf.resize(probability.size());
+    float sum = 0;
+    for (size_t i = 0; i < probability.size(); i++)
+        cdf[i] = sum += probability[i];
+}
+
+std::optional<sampled_light> power_light_sampler::sample(vec3f, vec3f, float u) const {
+    if (cdf.empty()) return {};
+    auto it = std::upper_bound(cdf.begin(), cdf.end(), u);
+    // Rounding can leave the sum below u; fall back to the last light that
+    // can be picked.
+    uint32_t light = uint32_t(std::min(it - cdf.begin(), std::ptrdiff_t(cdf.size() - 1)));
+    while (probability[light] == 0 && light > 0) light--;
+    if (probability[light] == 0) return {};
+    return sampled_light{light, probability[light]};
+}
+
+float power_light_sampler::pmf(vec3f, vec3f, uint32_t light) const {
+    return probability[light];
+}
\ No newline at end of file
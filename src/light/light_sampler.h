@@ -0,0 +1,51 @@
+#pragma once
+
+#include <light/light.h>
+#include <math/bounds.h>
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+// Lights are numbered like in the scene: distant, point, then area lights.
+struct light_lists {
+    std::span<const distant_light> distant;
+    std::span<const point_light> point;
+    std::span<const triangle_light> area;
+
+    uint32_t size() const { return uint32_t(distant.size() + point.size() + area.size()); }
+};
+
+struct sampled_light {
+    uint32_t light;
+    float pmf;
+};
+
+// Chooses which light next-event estimation samples from a hit at p with
+// normal n. pmf() must return the probability sample() picks light with.
+class light_sampler {
+public:
+    virtual ~light_sampler() = default;
+
+    virtual std::optional<sampled_light> sample(vec3f p, vec3f n, float u) const = 0;
+    virtual float pmf(vec3f p, vec3f n, uint32_t light) const = 0;
+};
+
+// Emitted power of each light. Distant lights cover the scene, whose
+// bounds give them a finite power.
+std::vector<float> light_power(const light_lists& lights, const bounds3f& sceneBounds);
+
+// Picks lights in proportion to their power, ignoring where the hit is.
+class power_light_sampler : public light_sampler {
+public:
+    power_light_sampler(const light_lists& lights, const bounds3f& sceneBounds);
+
+    std::optional<sampled_light> sample(vec3f p, vec3f n, float u) const override;
+    float pmf(vec3f p, vec3f n, uint32_t light) const override;
+
+private:
+    std::vector<float> probability;
+    // Running sum of probability, ending below 1.
+    std::vector<float> cdf;
+};
\ No newline at end of file
@@ -0,0 +1,328 @@
+#include "light_tree.h"
+
+#include <color/color.h>
+#include <math/util.h>
+#include <render/thread_pool.h>
+
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+constexpr float one_minus_epsilon = 0x1.fffffep-1f;
+
+float safe_sqrt(float x) {
+    return std::sqrt(std::max(0.f, x));
+}
+
+float safe_acos(float x) {
+    return std::acos(clamp(x, -1.f, 1.f));
+}
+
+// cos and sin of max(0, a - b) from those of a and b.
+float cos_sub_clamped(float sinA, float cosA, float sinB, float cosB) {
+    if (cosA > cosB) return 1;
+    return cosA * cosB + sinA * sinB;
+}
+
+float sin_sub_clamped(float sinA, float cosA, float sinB, float cosB) {
+    if (cosA > cosB) return 0;
+    return sinA * cosB - cosA * sinB;
+}
+
+// Angle between unit vectors, accurate for nearly equal ones too.
+float angle_between(vec3f a, vec3f b) {
+    if (dot(a, b) < 0) return pi - 2 * std::asin(std::min(1.f, length(a + b) / 2));
+    return 2 * std::asin(std::min(1.f, length(b - a) / 2));
+}
+
+// Surface area orientation heuristic of a candidate child, with the
+// splitting axis favored where the parent is long (Conty and Kulla 2018).
+float orientation_cost(const light_bounds& b, const bounds3f& parent, int axis) {
+    float solidAngle;
+    // Flat emitters facing one way and point lights give the most common
+    // cones, which need no trigonometry.
+    if (b.cos_theta_e == 0 && b.cos_theta_o == 1) {
+        solidAngle = pi;
+    } else if (b.cos_theta_e == 0 && b.cos_theta_o == -1) {
+        solidAngle = 4 * pi;
+    } else {
+        float thetaO = safe_acos(b.cos_theta_o), thetaE = safe_acos(b.cos_theta_e);
+        float thetaW = std::min(thetaO + thetaE, pi);
+        float sinThetaO = safe_sqrt(1 - b.cos_theta_o * b.cos_theta_o);
+        solidAngle = 2 * pi * (1 - b.cos_theta_o) +
+                     pi / 2 * (2 * thetaW * sinThetaO - std::cos(thetaO - 2 * thetaW) - 2 * thetaO * sinThetaO +
+                               b.cos_theta_o);
+    }
+    vec3f d = parent.diagonal();
+    float kr = d[axis] > 0 ? max_of(d) / d[axis] : 1;
+    return b.phi * solidAngle * kr * b.bounds.surface_area();
+}
+
+}
+
+float light_bounds::importance(vec3f p, vec3f n) const {
+    vec3f pc = bounds.centroid();
+    float d2 = std::max(length_sqr(p - pc), length(bounds.diagonal()) / 2);
+    if (d2 == 0) return 0;
+
+    vec3f wi = p - pc;
+    float cosThetaW = length_sqr(wi) > 0 ? dot(w, normalize(wi)) : 1;
+    if (two_sided) cosThetaW = std::abs(cosThetaW);
+    float sinThetaW = safe_sqrt(1 - cosThetaW * cosThetaW);
+
+    // Directions from p to the bounds lie in a cone of half angle theta_b.
+    float radius2 = length_sqr(bounds.pmax - pc);
+    float cosThetaB = -1;
+    if (length_sqr(p - pc) >= radius2) cosThetaB = safe_sqrt(1 - radius2 / length_sqr(p - pc));
+    float sinThetaB = safe_sqrt(1 - cosThetaB * cosThetaB);
+
+    // Smallest angle between any emission normal and a direction to p.
+    float sinThetaO = safe_sqrt(1 - cos_theta_o * cos_theta_o);
+    float cosThetaX = cos_sub_clamped(sinThetaW, cosThetaW, sinThetaO, cos_theta_o);
+    float sinThetaX = sin_sub_clamped(sinThetaW, cosThetaW, sinThetaO, cos_theta_o);
+    float cosThetaP = cos_sub_clamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+    if (cosThetaP <= cos_theta_e) return 0;
+
+    float result = phi * cosThetaP / d2;
+    if (n.x != 0 || n.y != 0 || n.z != 0) {
+        float cosThetaI = length_sqr(wi) > 0 ? std::abs(dot(normalize(wi), n)) : 1;
+        float sinThetaI = safe_sqrt(1 - cosThetaI * cosThetaI);
+        result *= cos_sub_clamped(sinThetaI, cosThetaI, sinThetaB, cosThetaB);
+    }
+    return std::max(result, 0.f);
+}
+
+light_bounds union_of(const light_bounds& a, const light_bounds& b) {
+    if (a.phi == 0) return b;
+    if (b.phi == 0) return a;
+
+    light_bounds result;
+    result.bounds = union_of(a.bounds, b.bounds);
+    result.phi = a.phi + b.phi;
+    result.cos_theta_e = std::min(a.cos_theta_e, b.cos_theta_e);
+    result.two_sided = a.two_sided || b.two_sided;
+
+    // Smallest cone around both normal cones. Emitters often share an
+    // orientation, where the wider cone is the answer, and a cone of all
+    // directions absorbs any other.
+    if (a.w == b.w || a.cos_theta_o == -1 || b.cos_theta_o == -1) {
+        result.w = a.cos_theta_o == -1 ? a.w : b.w;
+        result.cos_theta_o = std::min(a.cos_theta_o, b.cos_theta_o);
+        return result;
+    }
+    float thetaA = safe_acos(a.cos_theta_o), thetaB = safe_acos(b.cos_theta_o);
+    float thetaD = angle_between(a.w, b.w);
+    if (std::min(thetaD + thetaB, pi) <= thetaA) {
+        result.w = a.w, result.cos_theta_o = a.cos_theta_o;
+        return result;
+    }
+    if (std::min(thetaD + thetaA, pi) <= thetaB) {
+        result.w = b.w, result.cos_theta_o = b.cos_theta_o;
+        return result;
+    }
+    float thetaO = (thetaA + thetaD + thetaB) / 2;
+    vec3f axis = cross(a.w, b.w);
+    if (thetaO >= pi || length_sqr(axis) == 0) {
+        result.w = a.w, result.cos_theta_o = -1;
+        return result;
+    }
+    // Turn a's axis towards b's by thetaO - thetaA.
+    float thetaR = thetaO - thetaA;
+    result.w = normalize(a.w * std::cos(thetaR) + cross(normalize(axis), a.w) * std::sin(thetaR));
+    result.cos_theta_o = std::cos(thetaO);
+    return result;
+}
+
+struct light_tree::builder {
+    struct entry {
+        uint32_t light;
+        light_bounds bounds;
+    };
+
+    struct build_node {
+        light_bounds bounds;
+        uint32_t light = 0;
+        std::unique_ptr<build_node> children[2];
+    };
+
+    static constexpr uint32_t parallel_threshold = 4096;
+    // Trails hold a bit per level; below this depth splits are by count,
+    // which keeps trails within 64 bits for up to 2^23 lights.
+    static constexpr int balanced_depth = 40;
+
+    std::vector<entry> entries;
+    std::vector<uint64_t>& trails;
+    uint32_t distantCount;
+
+    std::unique_ptr<build_node> build(uint32_t first, uint32_t count, uint64_t trail, int depth) {
+        auto node = std::make_unique<build_node>();
+        std::span<entry> range(entries.data() + first, count);
+        if (count == 1) {
+            node->bounds = range[0].bounds;
+            node->light = range[0].light;
+            trails[range[0].light - distantCount] = trail;
+            return node;
+        }
+
+        bounds3f centroids;
+        for (const entry& e : range) {
+            node->bounds = union_of(node->bounds, e.bounds);
+            centroids = union_of(centroids, e.bounds.bounds.centroid());
+        }
+
+        constexpr int buckets = 12;
+        float minCost = infinity;
+        int splitAxis = -1, splitBucket = 0;
+        auto bucket_of = [&](const entry& e, int axis) {
+            float offset = centroids.offset(e.bounds.bounds.centroid())[axis];
+            return std::min(int(offset * buckets), buckets - 1);
+        };
+        if (depth < balanced_depth) {
+            for (int axis = 0; axis < 3; axis++) {
+                if (centroids.pmax[axis] == centroids.pmin[axis]) continue;
+                light_bounds bucketBounds[buckets];
+                for (const entry& e : range) {
+                    int b = bucket_of(e, axis);
+                    bucketBounds[b] = union_of(bucketBounds[b], e.bounds);
+                }
+                // Costs of everything right of each split, swept from the end.
+                float above[buckets];
+                light_bounds sum;
+                for (int b = buckets - 1; b > 0; b--) {
+                    sum = union_of(sum, bucketBounds[b]);
+                    above[b] = orientation_cost(sum, node->bounds.bounds, axis);
+                }
+                sum = {};
+                for (int b = 0; b < buckets - 1; b++) {
+                    sum = union_of(sum, bucketBounds[b]);
+                    float cost = orientation_cost(sum, node->bounds.bounds, axis) + above[b + 1];
+                    if (cost < minCost) minCost = cost, splitAxis = axis, splitBucket = b;
+                }
+            }
+        }
+
+        uint32_t mid = 0;
+        if (splitAxis >= 0) {
+            auto split = std::partition(range.begin(), range.end(),
+                                        [&](const entry& e) { return bucket_of(e, splitAxis) <= splitBucket; });
+            mid = uint32_t(split - range.begin());
+        }
+        if (mid == 0 || mid == count) {
+            int axis = centroids.max_extent();
+            mid = count / 2;
+            std::nth_element(range.begin(), range.begin() + mid, range.end(), [axis](const entry& a, const entry& b) {
+                return a.bounds.bounds.centroid()[axis] < b.bounds.bounds.centroid()[axis];
+            });
+        }
+
+        uint64_t secondTrail = trail | uint64_t(1) << depth;
+        if (count > parallel_threshold) {
+            task_group group;
+            group.run([&] { node->children[0] = build(first, mid, trail, depth + 1); });
+            node->children[1] = build(first + mid, count - mid, secondTrail, depth + 1);
+            group.wait();
+        } else {
+            node->children[0] = build(first, mid, trail, depth + 1);
+            node->children[1] = build(first + mid, count - mid, secondTrail, depth + 1);
+        }
+        return node;
+    }
+
+    static void flatten(const build_node& node, std::vector<light_tree::node>& nodes) {
+        uint32_t index = uint32_t(nodes.size());
+        nodes.push_back({node.bounds, node.light, !node.children[0]});
+        if (!node.children[0]) return;
+        flatten(*node.children[0], nodes);
+        nodes[index].index = uint32_t(nodes.size());
+        flatten(*node.children[1], nodes);
+    }
+};
+
+light_tree::light_tree(const light_lists& lights) : distantCount(uint32_t(lights.distant.size())) {
+    builder b{{}, trails, distantCount};
+    uint32_t light = distantCount;
+    for (const point_light& l : lights.point) {
+        light_bounds lb;
+        lb.bounds = bounds3f(l.position);
+        lb.phi = 4 * pi * luminance(l.intensity);
+        lb.cos_theta_o = -1;
+        lb.cos_theta_e = 0;
+        if (lb.phi > 0) b.entries.push_back({light, lb});
+        light++;
+    }
+    for (const triangle_light& l : lights.area) {
+        light_bounds lb;
+        lb.bounds = union_of(bounds3f(l.p0, l.p1), l.p2);
+        lb.w = l.normal();
+        lb.phi = 2 * pi * luminance(l.radiance) * l.area();
+        lb.cos_theta_o = 1;
+        lb.cos_theta_e = 0;
+        lb.two_sided = true;
+        if (lb.phi > 0 && length_sqr(lb.w) > 0) b.entries.push_back({light, lb});
+        light++;
+    }
+
+    // Lights that cannot contribute stay out of the tree and are never
+    // picked.
+    trails.assign(light - distantCount, no_trail);
+    if (b.entries.empty()) return;
+    std::unique_ptr<builder::build_node> root = b.build(0, uint32_t(b.entries.size()), 0, 0);
+    nodes.reserve(2 * b.entries.size() - 1);
+    builder::flatten(*root, nodes);
+}
+
+float light_tree::distant_probability() const {
+    uint32_t choices = distantCount + (nodes.empty() ? 0 : 1);
+    return choices == 0 ? 0 : float(distantCount) / float(choices);
+}
+
+std::optional<sampled_light> light_tree::sample(vec3f p, vec3f n, float u) const {
+    float distantProbability = distant_probability();
+    if (u < distantProbability) {
+        uint32_t light = std::min(uint32_t(u / distantProbability * float(distantCount)), distantCount - 1);
+        return sampled_light{light, distantProbability / float(distantCount)};
+    }
+    if (nodes.empty()) return {};
+
+    u = std::min((u - distantProbability) / (1 - distantProbability), one_minus_epsilon);
+    float pmf = 1 - distantProbability;
+    uint32_t index = 0;
+    while (!nodes[index].leaf) {
+        float importance0 = nodes[index + 1].bounds.importance(p, n);
+        float importance1 = nodes[nodes[index].index].bounds.importance(p, n);
+        if (importance0 == 0 && importance1 == 0) return {};
+        float p0 = importance0 / (importance0 + importance1);
+        if (u < p0) {
+            u = std::min(u / p0, one_minus_epsilon);
+            pmf *= p0;
+            index = index + 1;
+        } else {
+            u = std::min((u - p0) / (1 - p0), one_minus_epsilon);
+            pmf *= 1 - p0;
+            index = nodes[index].index;
+        }
+    }
+    if (index == 0 && nodes[0].bounds.importance(p, n) == 0) return {};
+    return sampled_light{nodes[index].index, pmf};
+}
+
+float light_tree::pmf(vec3f p, vec3f n, uint32_t light) const {
+    if (light < distantCount) return distant_probability() / float(distantCount);
+    uint64_t trail = trails[light - distantCount];
+    if (trail == no_trail) return 0;
+
+    float pmf = 1 - distant_probability();
+    uint32_t index = 0;
+    while (!nodes[index].leaf) {
+        float importance0 = nodes[index + 1].bounds.importance(p, n);
+        float importance1 = nodes[nodes[index].index].bounds.importance(p, n);
+        if (importance0 == 0 && importance1 == 0) return 0;
+        bool second = trail & 1;
+        pmf *= (second ? importance1 : importance0) / (importance0 + importance1);
+        index = second ? nodes[index].index : index + 1;
+        trail >>= 1;
+    }
+    if (index == 0 && nodes[0].bounds.importance(p, n) == 0) return 0;
+    return pmf;
+}
\ No newline at end of file
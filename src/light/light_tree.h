@@ -0,0 +1,62 @@
+#pragma once
+
+#include <light/light_sampler.h>
+
+#include <cstdint>
+#include <vector>
+
+// What a group of lights can send where: spatial bounds, total power, and
+// a cone of emission normals (axis w, half angle theta_o) around which
+// each emits up to theta_e further out.
+struct light_bounds {
+    bounds3f bounds;
+    vec3f w = vec3f(0, 0, 1);
+    float phi = 0;
+    float cos_theta_o = 1;
+    float cos_theta_e = 1;
+    bool two_sided = false;
+
+    // Upper bound on the contribution to a point p with normal n (n may be
+    // zero), up to a common factor (Conty and Kulla 2018).
+    float importance(vec3f p, vec3f n) const;
+};
+
+light_bounds union_of(const light_bounds& a, const light_bounds& b);
+
+// Bounding volume hierarchy over the point and area lights, for picking
+// a light in proportion to how much it can contribute to a hit: traversal
+// weighs the two children of every node by importance, so a sample costs
+// one root-to-leaf path. Splits minimize the surface area orientation
+// heuristic of the children. Distant lights reach everywhere equally; they
+// are picked before the tree with one share among them and the tree.
+class light_tree : public light_sampler {
+public:
+    explicit light_tree(const light_lists& lights);
+
+    std::optional<sampled_light> sample(vec3f p, vec3f n, float u) const override;
+    float pmf(vec3f p, vec3f n, uint32_t light) const override;
+
+    size_t node_count() const { return nodes.size(); }
+
+private:
+    struct node {
+        light_bounds bounds;
+        // Light of a leaf, or the second child of an interior node, whose
+        // first child follows it.
+        uint32_t index;
+        bool leaf;
+    };
+
+    static constexpr uint64_t no_trail = ~uint64_t(0);
+
+    uint32_t distantCount;
+    std::vector<node> nodes;
+    // Path from the root to the leaf of each tree light, one bit per level
+    // from the lowest: 0 for the first child, 1 for the second. no_trail
+    // marks lights without power, which are left out.
+    std::vector<uint64_t> trails;
+
+    float distant_probability() const;
+
+    struct builder;
+};
\ No newline at end of file
@@ -1,25 +1,432 @@
 #include <image/image.h>
-#include <camera/perspective.h>
+#include <image/image_writer.h>
+#include <camera/dispatch.h>
+#include <render/cost_aovs.h>
+#include <render/renderer.h>
+#include <integrator/path.h>
+#include <integrator/wavefront.h>
+#include <light/light_tree.h>
+#include <scene/mesh_cache.h>
+#include <scene/scenes.h>
+#include <shape/dispatch.h>
+#include <sampler/blue_noise.h>
+#include <sampler/sobol.h>
+#include <sampler/stratified.h>
+#include <util/allocation_counter.h>
+#include <util/arena.h>
+#include <util/profiler.h>
 
-vec3f compute_pixel_color(std::shared_ptr<camera> camera, vec2i pixel) {
-    std::optional<ray> cameraRay = camera->generate_ray({vec2f(pixel.x, pixel.y)});
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+// Primary-ray kernels, compiled once per camera and shape type when called
+// through dispatch_camera and dispatch_shape.
+template <typename C, typename S>
+vec3f compute_pixel_color(const C& camera, const S* scene, camera_sample_ctx sample) {
+    std::optional<ray> cameraRay = camera.generate_ray(sample);
     if (!cameraRay) return {};
 
+    if (scene) {
+        std::optional<shape_isect> isect = scene->intersect(*cameraRay);
+        if (isect) return isect->n * 0.5f + vec3f(0.5f);
+    }
+
     return cameraRay->direction() * 0.5f + vec3f(0.5f);
 }
 
-int main() {
+template <typename C, typename S>
+void compute_packet_colors(const C& camera, const S* scene, const camera_sample_ctx* samples, int count, vec3f* colors) {
+    std::array<camera_sample_ctx, packet_width> ctx;
+    for (int i = 0; i < packet_width; i++)
+        ctx[i] = samples[std::min(i, count - 1)];
+
+    ray_packet rays;
+    camera.generate_rays(ctx, rays);
+    shape_isect_packet isects;
+    if (scene) scene->intersect(rays, isects);
+    for (int i = 0; i < count; i++) {
+        if (!((rays.active >> i) & 1)) colors[i] = {};
+        else if ((isects.mask >> i) & 1) colors[i] = isects.hits[i].n * 0.5f + vec3f(0.5f);
+        else colors[i] = vec3f(rays.dx[i], rays.dy[i], rays.dz[i]) * 0.5f + vec3f(0.5f);
+    }
+}
+
+int main(int argc, char** argv) {
+    render_options options;
+    bool packets = false;
+    const char* meshPath = nullptr;
+    const char* samplerName = "sobol";
+    const char* integratorName = "normals";
+    const char* lightSamplerName = "tree";
+    std::string output = "output.png";
+    bool checkpoints = false;
+    int instances = 0;
+    int lightCount = 0;
+    float motion = 0;
+    const char* texturePath = nullptr;
+    float textureCacheMB = 64;
+    int edits = 0;
+    const char* dispatchName = "static";
+    bool printStats = false;
+    bool writeAovs = false;
+    const char* tracePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) options.threads = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--tile-size") && i + 1 < argc) options.tile_size = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--deterministic")) options.deterministic = true;
+        else if (!std::strcmp(argv[i], "--packets")) packets = true;
+        else if (!std::strcmp(argv[i], "--mesh") && i + 1 < argc) meshPath = argv[++i];
+        else if (!std::strcmp(argv[i], "--instances") && i + 1 < argc) instances = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--motion-blur") && i + 1 < argc) motion = float(std::atof(argv[++i]));
+        else if (!std::strcmp(argv[i], "--edits") && i + 1 < argc) edits = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--texture") && i + 1 < argc) texturePath = argv[++i];
+        else if (!std::strcmp(argv[i], "--texture-cache") && i + 1 < argc) textureCacheMB = float(std::atof(argv[++i]));
+        else if (!std::strcmp(argv[i], "--output") && i + 1 < argc) output = argv[++i];
+        else if (!std::strcmp(argv[i], "--checkpoints")) checkpoints = true;
+        else if (!std::strcmp(argv[i], "--stats")) printStats = true;
+        else if (!std::strcmp(argv[i], "--aovs")) writeAovs = true;
+        else if (!std::strcmp(argv[i], "--trace") && i + 1 < argc) tracePath = argv[++i];
+        else if (!std::strcmp(argv[i], "--sampler") && i + 1 < argc) samplerName = argv[++i];
+        else if (!std::strcmp(argv[i], "--dispatch") && i + 1 < argc) dispatchName = argv[++i];
+        else if (!std::strcmp(argv[i], "--integrator") && i + 1 < argc) integratorName = argv[++i];
+        else if (!std::strcmp(argv[i], "--lights") && i + 1 < argc) lightCount = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--light-sampler") && i + 1 < argc) lightSamplerName = argv[++i];
+        else if (!std::strcmp(argv[i], "--spp") && i + 1 < argc) options.spp = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--min-spp") && i + 1 < argc) options.min_spp = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--pass-spp") && i + 1 < argc) options.pass_spp = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--noise-threshold") && i + 1 < argc) options.noise_threshold = float(std::atof(argv[++i]));
+    }
+    init_thread_pool(options.threads);
+    bool pathTracing = !std::strcmp(integratorName, "path");
+    bool wavefront = !std::strcmp(integratorName, "wavefront");
+    bool shading = pathTracing || wavefront;
+
     image2d image({800, 600}, srgb_color_encoding{});
 
-    std::shared_ptr<camera> camera = std::make_shared<perspective_camera>(image.dimensions(), 45.f, transform{});
+    scene world;
+    world.materials = {material{material_type::diffuse, vec3f(0.8f)}, material{material_type::mirror, vec3f(0.9f)},
+                       material{material_type::diffuse, vec3f(0.f), vec3f(20.f)}};
 
-    for (int x = 0; x < image.width(); x++) {
-        for (int y = 0; y < image.height(); y++) {
-            vec3f color = compute_pixel_color(camera, {x, y});
-            image.set_pixel({x, y}, std::span<const float, 3>({color.x, color.y, color.z}));
+    std::shared_ptr<shape> geometry;
+    std::shared_ptr<bvh_aggregate> grid;
+    transform cameraTransform;
+    if (lightCount > 0) {
+        auto buildStart = std::chrono::steady_clock::now();
+        geometry = light_field(world, lightCount);
+        std::printf("%d lights (%zu area, %zu point) built in %.1f ms\n", lightCount, world.area_lights.size(),
+                    world.point_lights.size(),
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count());
+        float size = geometry->bounds().diagonal().x;
+        cameraTransform = look_at(vec3f(0, 0.25f * size, -0.55f * size), vec3f(0.f), vec3f(0, 1, 0));
+    } else if (meshPath) {
+        auto loadStart = std::chrono::steady_clock::now();
+        mesh_load_stats stats;
+        std::shared_ptr<triangle_mesh> mesh = load_mesh(meshPath, &stats);
+        if (!mesh) {
+            std::fprintf(stderr, "failed to load %s\n", meshPath);
+            return 1;
+        }
+        geometry = mesh;
+        std::printf("loaded %s in %.1f ms\n", meshPath,
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count());
+        if (stats.bytes) {
+            std::printf("imported %.1f MB at %.1f MB/s\n", double(stats.bytes) * 1e-6,
+                        stats.bytes_per_second() * 1e-6);
+        }
+        if (stats.seam_vertices)
+            std::printf("split %llu vertices along attribute seams\n", (unsigned long long) stats.seam_vertices);
+        if (stats.dropped_attributes)
+            std::fprintf(stderr, "warning: %s has normals or UVs on only some corners; dropped them\n", meshPath);
+
+        if (instances > 0) {
+            // Shaded renders alternate diffuse and mirror instances.
+            uint32_t materials = shading ? 2 : 1;
+            grid = motion > 0 ? moving_instance_grid(mesh, instances, motion, 0, materials)
+                              : instance_grid(mesh, instances, 0, materials);
+            if (motion == 0) {
+                std::printf("%d instances: %.1f MB unique geometry, %.1f MB placements\n", instances,
+                            double(mesh->memory_bytes()) * 1e-6,
+                            double(grid->memory_bytes() + grid->size() * sizeof(instance)) * 1e-6);
+            }
+            geometry = grid;
+        }
+
+        bounds3f b = geometry->bounds();
+        vec3f center = b.centroid();
+        cameraTransform = look_at(center - vec3f(0, 0, 1.5f * length(b.diagonal())), center, vec3f(0, 1, 0));
+    }
+
+    std::shared_ptr<camera> camera = std::make_shared<perspective_camera>(image.dimensions(), 45.f, cameraTransform);
+
+    std::unique_ptr<sampler> sampler;
+    if (!std::strcmp(samplerName, "stratified")) sampler = std::make_unique<stratified_sampler>(options.spp);
+    else if (!std::strcmp(samplerName, "blue-noise")) sampler = std::make_unique<blue_noise_sampler>();
+    else sampler = std::make_unique<sobol_sampler>();
+
+    world.geometry = geometry;
+    // Shaded renders of meshes are lit by the sun, the sky and a panel light
+    // above the camera, tilted towards the side of the geometry it sees.
+    std::shared_ptr<bvh_aggregate> root;
+    if (shading && meshPath) {
+        world.distant_lights = {{normalize(vec3f(0.4f, 1.f, -0.6f)), vec3f(3.f)}};
+        world.sky = vec3f(0.3f, 0.4f, 0.55f);
+        bounds3f b = geometry->bounds();
+        float size = length(b.diagonal());
+        auto panel = std::make_shared<instance>(quad_mesh(), translate(b.centroid() + vec3f(0, 0.5f * size, -0.5f * size)) *
+                                                                 rotate_x(45.f) * scale(vec3f(0.3f * size)), 2);
+        add_area_lights(world, *panel);
+        root = std::make_shared<bvh_aggregate>(std::vector<std::shared_ptr<shape>>{geometry, panel});
+        world.geometry = root;
+    }
+    if (!std::strcmp(lightSamplerName, "power")) {
+        world.light_sampling = std::make_shared<power_light_sampler>(
+            world.lights(), world.geometry ? world.geometry->bounds() : bounds3f());
+    } else if (!std::strcmp(lightSamplerName, "tree")) {
+        auto buildStart = std::chrono::steady_clock::now();
+        auto tree = std::make_shared<light_tree>(world.lights());
+        if (shading) {
+            std::printf("light tree: %zu nodes in %.1f ms\n", tree->node_count(),
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count());
+        }
+        world.light_sampling = tree;
+    }
+    // The texture covers the diffuse material, repeating four times across
+    // its uv range.
+    std::shared_ptr<tile_cache> textureTiles;
+    if (texturePath && shading) {
+        textureTiles = std::make_shared<tile_cache>(size_t(double(textureCacheMB) * (1 << 20)));
+        std::shared_ptr<const image_texture> texture = load_texture(texturePath, textureTiles);
+        if (!texture) {
+            std::fprintf(stderr, "failed to load %s\n", texturePath);
+            return 1;
         }
+        world.textures.push_back(texture);
+        world.materials[0].albedo_texture = 0;
+        world.materials[0].texture_scale = 4;
     }
+    path_integrator pathIntegrator(world, *camera, options.spp);
+    wavefront_integrator wavefrontIntegrator(world, *camera, *sampler);
+    std::atomic<uint64_t> rays = 0, shadowRays = 0;
+    // Heap allocations made while rendering tiles once the first pass has
+    // grown the arenas; anything here is a per-sample allocation to hunt.
+    std::atomic<bool> warm = false;
+    std::atomic<uint64_t> steadyAllocations = 0;
+    // Normal renders call kernels instantiated for the concrete camera and
+    // shape types unless asked to go through the virtual interfaces.
+    bool staticDispatch = std::strcmp(dispatchName, "virtual") != 0;
 
-    image.write_png("output.png");
+    film film(image.dimensions());
+    image_writer writer;
+    // Per-pixel cost images, written next to the output.
+    std::unique_ptr<cost_aovs> aovs = writeAovs ? std::make_unique<cost_aovs>(image.dimensions()) : nullptr;
+
+    // Renders into film; returns the time at which the first tile finished,
+    // which is when an interactive session would show its first pixels.
+    auto render = [&]() {
+        std::once_flag firstTile;
+        std::chrono::steady_clock::time_point firstPixel;
+        if (wavefront) {
+            // Waves span the whole image, so nothing is shown before the
+            // end of the first pass.
+            integrator_stats stats;
+            wavefrontIntegrator.render(film, options, stats, aovs.get());
+            rays += stats.rays;
+            shadowRays += stats.shadow_rays;
+            return std::chrono::steady_clock::now();
+        }
+        render_progressive(film, options, [&](const tile& tile, int samples) {
+            profile_scope tileScope(profile_stage::tile, tile.index);
+            uint64_t allocationsBefore = thread_allocation_count();
+            memory_arena& arena = thread_arena();
+            memory_arena::scope scratch(arena);
+            size_t capacity = size_t(tile.max.x - tile.min.x) * size_t(tile.max.y - tile.min.y) * size_t(samples);
+            std::span<camera_sample_ctx> cameraSamples = arena.alloc<camera_sample_ctx>(capacity);
+            std::span<vec2i> targets = arena.alloc<vec2i>(capacity);
+            std::span<uint32_t> indices = arena.alloc<uint32_t>(capacity);
+            size_t sampleCount = 0;
+            std::optional<profile_scope> stage(std::in_place, profile_stage::camera_samples);
+            for (int y = tile.min.y; y < tile.max.y; y++) {
+                for (int x = tile.min.x; x < tile.max.x; x++) {
+                    if (!needs_samples(film, {x, y}, options)) continue;
+                    uint32_t taken = film.samples({x, y});
+                    uint32_t count = std::min(uint32_t(samples), uint32_t(options.spp) - taken);
+                    for (uint32_t s = 0; s < count; s++, sampleCount++) {
+                        cameraSamples[sampleCount] = camera_sample(*sampler, {x, y}, taken + s, options);
+                        targets[sampleCount] = {x, y};
+                        indices[sampleCount] = taken + s;
+                    }
+                }
+            }
+
+            stage.emplace(profile_stage::trace);
+            // Each sample's cost runs from the end of the previous one.
+            render_cost last = aovs ? render_cost::now() : render_cost{};
+            auto charge = [&](size_t i) {
+                render_cost now = render_cost::now();
+                aovs->add(targets[i], now - last);
+                last = now;
+            };
+            if (pathTracing) {
+                integrator_stats stats;
+                for (size_t i = 0; i < sampleCount; i++) {
+                    std::optional<ray> r = camera->generate_ray(cameraSamples[i]);
+                    film.add_sample(targets[i], r ? pathIntegrator.li(*r, *sampler, targets[i], indices[i], stats)
+                                                  : vec3f(0.f));
+                    if (aovs) charge(i);
+                }
+                rays += stats.rays;
+                shadowRays += stats.shadow_rays;
+            } else {
+                profile_count(profile_counter::rays, sampleCount);
+                auto shade = [&](const auto& camera, const auto* geometry) {
+                    if (packets) {
+                        for (size_t i = 0; i < sampleCount; i += packet_width) {
+                            vec3f colors[packet_width];
+                            int count = int(std::min(size_t(packet_width), sampleCount - i));
+                            compute_packet_colors(camera, geometry, &cameraSamples[i], count, colors);
+                            for (int j = 0; j < count; j++)
+                                film.add_sample(targets[i + j], colors[j]);
+                            if (aovs) {
+                                // One charge for the packet, spread evenly.
+                                render_cost now = render_cost::now();
+                                for (int j = 0; j < count; j++)
+                                    aovs->add(targets[i + j], now - last, 1.f / float(count));
+                                last = now;
+                            }
+                        }
+                    } else {
+                        for (size_t i = 0; i < sampleCount; i++) {
+                            film.add_sample(targets[i], compute_pixel_color(camera, geometry, cameraSamples[i]));
+                            if (aovs) charge(i);
+                        }
+                    }
+                };
+                if (!staticDispatch) shade(*camera, geometry.get());
+                else if (!geometry) dispatch_camera(*camera, [&](const auto& c) { shade(c, (const shape*) nullptr); });
+                else {
+                    dispatch_camera(*camera, [&](const auto& c) {
+                        dispatch_shape(*geometry, [&](const auto& s) { shade(c, &s); });
+                    });
+                }
+            }
+            std::call_once(firstTile, [&] { firstPixel = std::chrono::steady_clock::now(); });
+            if (warm) steadyAllocations += thread_allocation_count() - allocationsBefore;
+        }, [&](int samples) {
+            warm = true;
+            if (!checkpoints || samples >= options.spp) return;
+            film.resolve(image);
+            writer.write(image, output);
+        });
+        return firstPixel;
+    };
+
+    // Primary-ray throughput of the virtual interfaces against the kernels
+    // instantiated per concrete camera and shape.
+    if (!std::strcmp(dispatchName, "compare") && !shading) {
+        // Best of alternating runs, after one to warm up caches and pages.
+        double ms[2] = {infinity, infinity};
+        for (int run = -1; run < 10; run++) {
+            staticDispatch = run % 2 != 0;
+            film = ::film(image.dimensions());
+            if (aovs) aovs->clear();
+            auto runStart = std::chrono::steady_clock::now();
+            render();
+            double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - runStart).count();
+            if (run >= 0) ms[staticDispatch] = std::min(ms[staticDispatch], elapsed);
+        }
+        std::printf("dispatch: virtual %.1f ms, static %.1f ms (%.2fx)\n", ms[0], ms[1], ms[0] / ms[1]);
+        film = ::film(image.dimensions());
+        if (aovs) aovs->clear();
+    }
+
+    // Counts and timings cover the render below and any edits after it.
+    reset_profile();
+    set_profile_tracing(tracePath != nullptr);
+    auto start = std::chrono::steady_clock::now();
+    render();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t totalSamples = film.total_samples();
+    uint64_t budget = uint64_t(image.width()) * image.height() * options.spp;
+    if (shading) {
+        // Bounce and shadow rays are incoherent, so this is the figure to
+        // compare the two integrators by.
+        std::printf("%s: %.2f Mrays/s (%llu path rays, %llu shadow rays)\n", integratorName,
+                    double(rays + shadowRays) / seconds * 1e-6, (unsigned long long) rays.load(),
+                    (unsigned long long) shadowRays.load());
+    } else {
+        std::printf("%s rays: %.2f Mrays/s\n", packets ? "packet" : "scalar", double(totalSamples) / seconds * 1e-6);
+    }
+    if (textureTiles) {
+        tile_cache_stats stats = textureTiles->stats();
+        std::printf("texture tiles: %llu hits, %llu misses, %llu evictions, %.1f of %.1f MB resident\n",
+                    (unsigned long long) stats.hits, (unsigned long long) stats.misses,
+                    (unsigned long long) stats.evictions, double(stats.resident_bytes) / (1 << 20),
+                    double(textureTiles->capacity()) / (1 << 20));
+    }
+    if (options.spp > 1) {
+        std::printf("%llu samples (%.1f%% of %d spp budget)\n", (unsigned long long) totalSamples,
+                    100.0 * double(totalSamples) / double(budget), options.spp);
+    }
+
+    if (warm) {
+        std::printf("%llu heap allocations in tiles after the first pass\n",
+                    (unsigned long long) steadyAllocations.load());
+    }
+
+    // Interactive edit loop: move about 1% of the instances, update the
+    // tree incrementally and re-render, timing edit to first pixel.
+    if (grid && motion == 0) {
+        int moved = std::max(1, int(grid->size() / 100));
+        vec3f extent = grid->bounds().diagonal();
+        for (int edit = 0; edit < edits; edit++) {
+            auto editStart = std::chrono::steady_clock::now();
+            for (int i = 0; i < moved; i++) {
+                uint64_t h = mix_bits(uint64_t(edit) << 32 | uint32_t(i));
+                uint32_t index = uint32_t(h % grid->size());
+                auto placement = std::static_pointer_cast<instance>(grid->get_shape(index));
+                vec3f offset(extent.x * (float(h >> 40) * 0x1p-24f - 0.5f) * 0.1f,
+                             extent.y * (float((h >> 16) & 0xffffff) * 0x1p-24f - 0.5f) * 0.1f, 0);
+                placement->set_transform(translate(offset) * placement->get_transform());
+                grid->mark_dirty(index);
+            }
+            bvh_update_stats stats = grid->update();
+            if (root) {
+                root->mark_dirty(0);
+                root->update();
+            }
+            auto updated = std::chrono::steady_clock::now();
+            film = ::film(image.dimensions());
+            if (aovs) aovs->clear();
+            auto firstPixel = render();
+            auto done = std::chrono::steady_clock::now();
+            auto ms = [&](auto t) { return std::chrono::duration<double, std::milli>(t - editStart).count(); };
+            std::printf("edit %d: %d objects, update %.2f ms (%u nodes refit, %u subtrees / %u objects rebuilt), "
+                        "first pixel %.2f ms, frame %.1f ms\n", edit, moved, ms(updated), stats.refit_nodes,
+                        stats.rebuilt_subtrees, stats.rebuilt_primitives, ms(firstPixel), ms(done));
+        }
+    }
+
+    film.resolve(image);
+    writer.write(image, output);
+    if (writer.flush()) {
+        std::fprintf(stderr, "failed to write %s\n", output.c_str());
+        return 1;
+    }
+    if (aovs && !aovs->write(output, film)) {
+        std::fprintf(stderr, "failed to write the cost images next to %s\n", output.c_str());
+        return 1;
+    }
+
+    set_profile_tracing(false);
+    if (printStats)
+        print_profile_summary(stdout, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    if (tracePath && !write_chrome_trace(tracePath)) {
+        std::fprintf(stderr, "failed to write %s\n", tracePath);
+        return 1;
+    }
     return 0;
 }
\ No newline at end of file
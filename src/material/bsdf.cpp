@@ -0,0 +1,39 @@
+#include "bsdf.h"
+
+#include <math/sampling.h>
+
+std::optional<bsdf_sample> sample_bsdf(const material& m, vec3f n, vec3f wo, vec2f u) {
+    if (dot(n, wo) < 0) n = -n;
+    switch (m.type) {
+        case material_type::diffuse: {
+            vec3f t, b;
+            coordinate_system(n, t, b);
+            vec3f local = sample_cosine_hemisphere(u);
+            if (local.z <= 0) return {};
+            return bsdf_sample{m.albedo * inv_pi, to_world(local, t, b, n), cosine_hemisphere_pdf(local.z), false};
+        }
+        case material_type::mirror: {
+            vec3f wi = 2 * dot(n, wo) * n - wo;
+            float cosTheta = dot(n, wi);
+            if (cosTheta <= 0) return {};
+            // The delta pdf cancels against the cosine, so f carries
+            // albedo / cos and pdf stands at 1.
+            return bsdf_sample{m.albedo / cosTheta, wi, 1, true};
+        }
+    }
+    return {};
+}
+
+vec3f eval_bsdf(const material& m, vec3f n, vec3f wo, vec3f wi) {
+    if (m.type != material_type::diffuse) return vec3f(0.f);
+    // Reflection only: both directions on the same side.
+    if (dot(n, wo) * dot(n, wi) <= 0) return vec3f(0.f);
+    return m.albedo * inv_pi;
+}
+
+float bsdf_pdf(const material& m, vec3f n, vec3f wo, vec3f wi) {
+    if (m.type != material_type::diffuse) return 0;
+    if (dot(n, wo) < 0) n = -n;
+    float cosTheta = dot(n, wi);
+    return cosTheta > 0 ? cosine_hemisphere_pdf(cosTheta) : 0;
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <material/material.h>
+
+#include <optional>
+
+// Directions are in render space and point away from the surface; n is
+// the shading normal, on either side.
+struct bsdf_sample {
+    vec3f f;
+    vec3f wi;
+    float pdf;
+    bool specular;
+};
+
+std::optional<bsdf_sample> sample_bsdf(const material& m, vec3f n, vec3f wo, vec2f u);
+
+// Zero for specular materials, which only scatter through sample_bsdf.
+vec3f eval_bsdf(const material& m, vec3f n, vec3f wo, vec3f wi);
+float bsdf_pdf(const material& m, vec3f n, vec3f wo, vec3f wi);
\ No newline at end of file
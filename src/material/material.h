@@ -0,0 +1,28 @@
+#pragma once
+
+#include <math/vec.h>
+
+#include <cstdint>
+
+enum class material_type : uint8_t {
+    diffuse,
+    mirror
+};
+
+inline constexpr int material_type_count = 2;
+
+inline constexpr uint32_t no_texture = ~0u;
+
+// Surface appearance, referenced from shape_isect::material by index into
+// the scene's material list. Any type can also emit.
+struct material {
+    material_type type = material_type::diffuse;
+    vec3f albedo = vec3f(0.8f);
+    vec3f emission = vec3f(0.f);
+    // Index into the scene's textures replacing albedo, looked up at the
+    // hit's uv times texture_scale.
+    uint32_t albedo_texture = no_texture;
+    float texture_scale = 1;
+
+    bool is_emissive() const { return emission.x > 0 || emission.y > 0 || emission.z > 0; }
+};
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "animated_transform.h"
+
+#include <algorithm>
+
+namespace {
+
+// Splits the linear part of m into rotation and scale by polar
+// decomposition: averaging a matrix with its inverse transpose converges
+// to the nearest rotation, and what is left over is the scale.
+void decompose(const matrix<4>& m, vec3f& translation, quaternion& rotation, matrix<3>& scale) {
+    translation = {m[0][3], m[1][3], m[2][3]};
+    matrix<3> linear(m[0][0], m[0][1], m[0][2],
+                     m[1][0], m[1][1], m[1][2],
+                     m[2][0], m[2][1], m[2][2]);
+
+    matrix<3> r = linear;
+    for (int iteration = 0; iteration < 100; iteration++) {
+        std::optional<matrix<3>> inv = inverse(r);
+        if (!inv) {
+            r = matrix<3>();
+            break;
+        }
+        matrix<3> next = (r + transpose(*inv)) * 0.5f;
+        float change = 0;
+        for (int i = 0; i < 3; i++)
+            change = std::max(change, std::abs(next[i][0] - r[i][0]) + std::abs(next[i][1] - r[i][1]) +
+                                      std::abs(next[i][2] - r[i][2]));
+        r = next;
+        if (change < 1e-4f) break;
+    }
+    // A mirroring transform converges to a reflection; keep the rotation
+    // proper and let the scale carry the sign.
+    if (determinant(r) < 0) r = r * -1.f;
+
+    rotation = normalize(quaternion(r));
+    scale = transpose(rotation.to_matrix()) * linear;
+}
+
+// The inverse is built from the parts, (T R S)^-1 = S^-1 R^T T^-1, which
+// only needs a 3x3 inverse.
+transform compose(vec3f translation, const quaternion& rotation, const matrix<3>& scale) {
+    matrix<3> r = rotation.to_matrix();
+    matrix<3> linear = r * scale;
+    std::optional<matrix<3>> scaleInv = inverse(scale);
+    if (!scaleInv) {
+        matrix<4> m(linear[0][0], linear[0][1], linear[0][2], translation.x,
+                    linear[1][0], linear[1][1], linear[1][2], translation.y,
+                    linear[2][0], linear[2][1], linear[2][2], translation.z,
+                    0, 0, 0, 1);
+        return transform(m);
+    }
+    matrix<3> linearInv = *scaleInv * transpose(r);
+    vec3f t = translation;
+    vec3f tInv(-(linearInv[0][0] * t.x + linearInv[0][1] * t.y + linearInv[0][2] * t.z),
+               -(linearInv[1][0] * t.x + linearInv[1][1] * t.y + linearInv[1][2] * t.z),
+               -(linearInv[2][0] * t.x + linearInv[2][1] * t.y + linearInv[2][2] * t.z));
+
+    matrix<4> m(linear[0][0], linear[0][1], linear[0][2], t.x,
+                linear[1][0], linear[1][1], linear[1][2], t.y,
+                linear[2][0], linear[2][1], linear[2][2], t.z,
+                0, 0, 0, 1);
+    matrix<4> mInv(linearInv[0][0], linearInv[0][1], linearInv[0][2], tInv.x,
+                   linearInv[1][0], linearInv[1][1], linearInv[1][2], tInv.y,
+                   linearInv[2][0], linearInv[2][1], linearInv[2][2], tInv.z,
+                   0, 0, 0, 1);
+    return {m, mInv, transform_kind::affine};
+}
+
+}
+
+animated_transform::animated_transform(const transform& t) {
+    float time = 0;
+    *this = animated_transform(std::span<const transform>(&t, 1), std::span<const float>(&time, 1));
+}
+
+animated_transform::animated_transform(const transform& t0, float time0, const transform& t1, float time1) {
+    transform keyframes[] = {t0, t1};
+    float times[] = {time0, time1};
+    *this = animated_transform(keyframes, times);
+}
+
+animated_transform::animated_transform(std::span<const transform> keyframes, std::span<const float> times) {
+    keys.resize(keyframes.size());
+    for (size_t i = 0; i < keyframes.size(); i++) {
+        keyframe& k = keys[i];
+        k.time = times[i];
+        k.t = keyframes[i];
+        decompose(k.t.get_matrix(), k.translation, k.rotation, k.scale);
+    }
+
+    for (size_t i = 0; i + 1 < keys.size(); i++) {
+        keyframe& k0 = keys[i];
+        keyframe& k1 = keys[i + 1];
+        // q and -q are the same rotation; pick the one on the short arc.
+        if (dot(k0.rotation, k1.rotation) < 0) k1.rotation = -k1.rotation;
+        float cosTheta = dot(k0.rotation, k1.rotation);
+        if (cosTheta <= 0.9995f) {
+            k0.theta = std::acos(clamp(cosTheta, -1.f, 1.f));
+            k0.rotationPerp = normalize(k1.rotation - k0.rotation * cosTheta);
+        }
+    }
+}
+
+transform animated_transform::interpolate(const keyframe& k0, const keyframe& k1, float u) {
+    vec3f translation = mix(k0.translation, k1.translation, u);
+    quaternion rotation = k0.theta == 0
+                              ? normalize(k0.rotation * (1 - u) + k1.rotation * u)
+                              : k0.rotation * std::cos(k0.theta * u) + k0.rotationPerp * std::sin(k0.theta * u);
+    matrix<3> scale = k0.scale * (1 - u) + k1.scale * u;
+    return compose(translation, rotation, scale);
+}
+
+transform animated_transform::interpolate(float time) const {
+    if (keys.empty()) return {};
+    if (keys.size() == 1 || time <= keys.front().time) return keys.front().t;
+    if (time >= keys.back().time) return keys.back().t;
+
+    auto next = std::upper_bound(keys.begin(), keys.end(), time,
+                                 [](float t, const keyframe& k) { return t < k.time; });
+    const keyframe& k0 = *(next - 1);
+    const keyframe& k1 = *next;
+    if (time == k0.time) return k0.t;
+    return interpolate(k0, k1, (time - k0.time) / (k1.time - k0.time));
+}
+
+bounds3f animated_transform::motion_bounds(const bounds3f& b) const {
+    if (keys.empty() || b.is_empty()) return b;
+
+    bounds3f result;
+    for (const keyframe& k : keys)
+        result = union_of(result, k.t.apply(b));
+
+    // Without a change of rotation every point moves along a straight line,
+    // so the keyframes already bound it. Otherwise the corners are followed
+    // in steps. A corner between two samples is within half the path
+    // length of one of them, and with steps this short the path is barely
+    // longer than the straight step, so the result is padded by a little
+    // more than half the longest step.
+    constexpr int steps = 32;
+    float pad = 0;
+    for (size_t i = 0; i + 1 < keys.size(); i++) {
+        const keyframe& k0 = keys[i];
+        const keyframe& k1 = keys[i + 1];
+        if (k0.rotation.v == k1.rotation.v && k0.rotation.w == k1.rotation.w) continue;
+
+        vec3f previous[8];
+        for (int step = 0; step <= steps; step++) {
+            transform t = step == 0 ? k0.t : step == steps ? k1.t : interpolate(k0, k1, float(step) / steps);
+            for (int corner = 0; corner < 8; corner++) {
+                vec3f p = t.apply(vec3f(b[corner & 1].x, b[(corner >> 1) & 1].y, b[corner >> 2].z));
+                if (step > 0) pad = std::max(pad, length(p - previous[corner]));
+                previous[corner] = p;
+                result = union_of(result, p);
+            }
+        }
+    }
+    result.pmin -= vec3f(0.55f * pad);
+    result.pmax += vec3f(0.55f * pad);
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <math/transform.h>
+#include <math/quaternion.h>
+
+#include <span>
+#include <vector>
+
+// A transform keyframed over the shutter interval. Each keyframe is split
+// into translation, rotation and scale (M = T R S), which are interpolated
+// separately: lerping the matrices instead would shear and shrink anything
+// that rotates. Times outside the keyframes clamp to the first or last.
+class animated_transform {
+public:
+    animated_transform() = default;
+    animated_transform(const transform& t);
+    animated_transform(const transform& t0, float time0, const transform& t1, float time1);
+    // Times must be increasing and the same length as keyframes.
+    animated_transform(std::span<const transform> keyframes, std::span<const float> times);
+
+    bool is_animated() const { return keys.size() > 1; }
+    float start_time() const { return keys.empty() ? 0 : keys.front().time; }
+    float end_time() const { return keys.empty() ? 0 : keys.back().time; }
+
+    transform interpolate(float time) const;
+
+    ray apply(const ray& r) const { return interpolate(r.time()).apply(r); }
+    ray apply_inverse(const ray& r) const { return interpolate(r.time()).apply_inverse(r); }
+
+    // Bounds of b over the whole keyframe range.
+    bounds3f motion_bounds(const bounds3f& b) const;
+
+private:
+    struct keyframe {
+        float time;
+        transform t;
+        vec3f translation;
+        quaternion rotation;
+        matrix<3> scale;
+
+        // Slerp terms towards the next keyframe, so that interpolating
+        // needs no acos per ray.
+        float theta = 0;
+        quaternion rotationPerp;
+    };
+
+    std::vector<keyframe> keys;
+
+    static transform interpolate(const keyframe& k0, const keyframe& k1, float u);
+};
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <math/vec.h>
+#include <math/ray.h>
+#include <math/util.h>
+#include <common.h>
+
+#include <algorithm>
+
+template <typename T>
+class bounds3 {
+public:
+    bounds3()
+        : pmin(std::numeric_limits<T>::max()), pmax(std::numeric_limits<T>::lowest()) {}
+    explicit bounds3(vec3<T> p)
+        : pmin(p), pmax(p) {}
+    bounds3(vec3<T> p0, vec3<T> p1)
+        : pmin(min(p0, p1)), pmax(max(p0, p1)) {}
+
+    vec3<T> operator[](int i) const {
+        return i == 0 ? pmin : pmax;
+    }
+
+    bool operator==(const bounds3<T>& b) const {
+        return pmin == b.pmin && pmax == b.pmax;
+    }
+    bool operator!=(const bounds3<T>& b) const {
+        return pmin != b.pmin || pmax != b.pmax;
+    }
+
+    bool is_empty() const {
+        return pmin.x > pmax.x || pmin.y > pmax.y || pmin.z > pmax.z;
+    }
+
+    vec3<T> diagonal() const {
+        return pmax - pmin;
+    }
+    vec3<T> centroid() const {
+        return (pmin + pmax) * T(0.5);
+    }
+
+    T surface_area() const {
+        if (is_empty()) return 0;
+        vec3<T> d = diagonal();
+        return 2 * (d.x * d.y + d.x * d.z + d.y * d.z);
+    }
+
+    int max_extent() const {
+        vec3<T> d = diagonal();
+        if (d.x > d.y && d.x > d.z) return 0;
+        if (d.y > d.z) return 1;
+        return 2;
+    }
+
+    vec3<T> offset(vec3<T> p) const {
+        vec3<T> o = p - pmin;
+        if (pmax.x > pmin.x) o.x /= pmax.x - pmin.x;
+        if (pmax.y > pmin.y) o.y /= pmax.y - pmin.y;
+        if (pmax.z > pmin.z) o.z /= pmax.z - pmin.z;
+        return o;
+    }
+
+    bool inside(vec3<T> p) const {
+        return p.x >= pmin.x && p.x <= pmax.x &&
+               p.y >= pmin.y && p.y <= pmax.y &&
+               p.z >= pmin.z && p.z <= pmax.z;
+    }
+
+    bool intersect_p(vec3<T> o, vec3<T> invDir, const int dirIsNeg[3], T tMax) const {
+        const bounds3<T>& b = *this;
+        T tMin = (b[dirIsNeg[0]].x - o.x) * invDir.x;
+        T tFar = (b[1 - dirIsNeg[0]].x - o.x) * invDir.x;
+        T tyMin = (b[dirIsNeg[1]].y - o.y) * invDir.y;
+        T tyMax = (b[1 - dirIsNeg[1]].y - o.y) * invDir.y;
+
+        tFar *= 1 + 2 * error_gamma(3);
+        tyMax *= 1 + 2 * error_gamma(3);
+        if (tMin > tyMax || tyMin > tFar) return false;
+        if (tyMin > tMin) tMin = tyMin;
+        if (tyMax < tFar) tFar = tyMax;
+
+        T tzMin = (b[dirIsNeg[2]].z - o.z) * invDir.z;
+        T tzMax = (b[1 - dirIsNeg[2]].z - o.z) * invDir.z;
+        tzMax *= 1 + 2 * error_gamma(3);
+        if (tMin > tzMax || tzMin > tFar) return false;
+        if (tzMin > tMin) tMin = tzMin;
+        if (tzMax < tFar) tFar = tzMax;
+
+        return tMin < tMax && tFar >= 0;
+    }
+
+public:
+    vec3<T> pmin, pmax;
+};
+
+template <typename T>
+inline bounds3<T> union_of(const bounds3<T>& b, vec3<T> p) {
+    bounds3<T> r;
+    r.pmin = min(b.pmin, p);
+    r.pmax = max(b.pmax, p);
+    return r;
+}
+template <typename T>
+inline bounds3<T> union_of(const bounds3<T>& b0, const bounds3<T>& b1) {
+    bounds3<T> r;
+    r.pmin = min(b0.pmin, b1.pmin);
+    r.pmax = max(b0.pmax, b1.pmax);
+    return r;
+}
+
+using bounds3f = bounds3<float>;
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <math/vec.h>
 #include <math/util.h>
+#include <math/simd.h>
 
 #include <optional>
 #include <span>
@@ -260,15 +261,6 @@ inline matrix<3> operator*(const matrix<3>& m1, const matrix<3>& m2) {
             r[i][j] = inner_prod(m1[i][0], m2[0][j], m1[i][1], m2[1][j], m1[i][2], m2[2][j]);
     return r;
 }
-template <>
-inline matrix<4> operator*(const matrix<4>& m1, const matrix<4>& m2) {
-    matrix<4> r;
-    for (int i = 0; i < 4; ++i)
-        for (int j = 0; j < 4; ++j)
-            r[i][j] = inner_prod(m1[i][0], m2[0][j], m1[i][1], m2[1][j], m1[i][2],
-                                 m2[2][j], m1[i][3], m2[3][j]);
-    return r;
-}
 template <int N>
 inline matrix<N> operator*(const matrix<N>& m1, const matrix<N>& m2) {
     matrix<N> r;
@@ -281,6 +273,26 @@ inline matrix<N> operator*(const matrix<N>& m1, const matrix<N>& m2) {
     return r;
 }
 
+// A plain overload, so it is preferred over the template above. Each row
+// of the product is the same fma chain as the generic loop, evaluated for
+// all four columns at once.
+inline matrix<4> operator*(const matrix<4>& m1, const matrix<4>& m2) {
+#if defined(RENDERER_SIMD_SSE) && defined(__FMA__)
+    using v4 = vfloat<4>;
+    v4 rows[4] = {v4::load(m2[0].data()), v4::load(m2[1].data()), v4::load(m2[2].data()), v4::load(m2[3].data())};
+    matrix<4> r;
+    for (int i = 0; i < 4; ++i) {
+        v4 sum(0.f);
+        for (int k = 0; k < 4; ++k)
+            sum = fma(v4(m1[i][k]), rows[k], sum);
+        sum.store(r[i].data());
+    }
+    return r;
+#else
+    return operator*<4>(m1, m2);
+#endif
+}
+
 extern template class matrix<2>;
 extern template class matrix<3>;
 extern template class matrix<4>;
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <math/vec.h>
+#include <math/mat.h>
+#include <math/util.h>
+
+// Unit quaternions for interpolating rotations.
+class quaternion {
+public:
+    quaternion() = default;
+    quaternion(vec3f v, float w) : v(v), w(w) {}
+
+    // From the rotation part of a matrix, which must be orthonormal.
+    explicit quaternion(const matrix<3>& m) {
+        float trace = m[0][0] + m[1][1] + m[2][2];
+        if (trace > 0) {
+            float s = std::sqrt(trace + 1);
+            w = s / 2;
+            s = 0.5f / s;
+            v = {(m[2][1] - m[1][2]) * s, (m[0][2] - m[2][0]) * s, (m[1][0] - m[0][1]) * s};
+            return;
+        }
+
+        int i = 0;
+        if (m[1][1] > m[0][0]) i = 1;
+        if (m[2][2] > m[i][i]) i = 2;
+        int j = (i + 1) % 3, k = (j + 1) % 3;
+        float s = std::sqrt((m[i][i] - (m[j][j] + m[k][k])) + 1);
+        v[i] = s * 0.5f;
+        if (s != 0) s = 0.5f / s;
+        w = (m[k][j] - m[j][k]) * s;
+        v[j] = (m[j][i] + m[i][j]) * s;
+        v[k] = (m[k][i] + m[i][k]) * s;
+    }
+
+    quaternion operator+(const quaternion& q) const { return {v + q.v, w + q.w}; }
+    quaternion operator-(const quaternion& q) const { return {v - q.v, w - q.w}; }
+    quaternion operator-() const { return {-v, -w}; }
+    quaternion operator*(float f) const { return {v * f, w * f}; }
+    quaternion operator/(float f) const { return {v / f, w / f}; }
+
+    matrix<3> to_matrix() const {
+        float xx = v.x * v.x, yy = v.y * v.y, zz = v.z * v.z;
+        float xy = v.x * v.y, xz = v.x * v.z, yz = v.y * v.z;
+        float wx = v.x * w, wy = v.y * w, wz = v.z * w;
+        return {1 - 2 * (yy + zz), 2 * (xy - wz), 2 * (xz + wy),
+                2 * (xy + wz), 1 - 2 * (xx + zz), 2 * (yz - wx),
+                2 * (xz - wy), 2 * (yz + wx), 1 - 2 * (xx + yy)};
+    }
+
+public:
+    vec3f v = vec3f(0.f);
+    float w = 1;
+};
+
+inline float dot(const quaternion& q0, const quaternion& q1) {
+    return dot(q0.v, q1.v) + q0.w * q1.w;
+}
+
+inline quaternion normalize(const quaternion& q) {
+    return q / std::sqrt(dot(q, q));
+}
+
+// Constant angular velocity from q0 at t = 0 to q1 at t = 1. Nearly equal
+// rotations fall back to a normalized lerp, where the angle is too small
+// for the sine ratio to be accurate.
+inline quaternion slerp(float t, const quaternion& q0, const quaternion& q1) {
+    float cosTheta = dot(q0, q1);
+    if (cosTheta > 0.9995f) return normalize(q0 * (1 - t) + q1 * t);
+    float theta = std::acos(clamp(cosTheta, -1.f, 1.f));
+    float thetap = theta * t;
+    quaternion qperp = normalize(q1 - q0 * cosTheta);
+    return q0 * std::cos(thetap) + qperp * std::sin(thetap);
+}
\ No newline at end of file
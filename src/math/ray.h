@@ -5,8 +5,8 @@
 class ray {
 public:
     ray() = default;
-    ray(vec3f p, vec3f d)
-        : ro(p), rd(d) {}
+    ray(vec3f p, vec3f d, float time = 0)
+        : ro(p), rd(d), rt(time) {}
 
     vec3f operator()(float t) const {
         return ro + t * rd;
@@ -14,8 +14,11 @@ public:
 
     vec3f origin() const { return ro; }
     vec3f direction() const { return rd; }
+    // Point in the shutter interval, for shapes that move.
+    float time() const { return rt; }
 
 private:
     vec3f ro;
     vec3f rd;
+    float rt = 0;
 };
\ No newline at end of file
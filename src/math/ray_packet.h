@@ -0,0 +1,41 @@
+#pragma once
+
+#include <math/ray.h>
+#include <math/simd.h>
+#include <common.h>
+
+#include <cstdint>
+
+constexpr int packet_width = simd_width;
+
+// Structure-of-arrays bundle of rays traced together. Lanes whose bit is
+// clear in active carry no ray; tmax shrinks as hits are found.
+struct ray_packet {
+    alignas(32) float ox[packet_width], oy[packet_width], oz[packet_width];
+    alignas(32) float dx[packet_width], dy[packet_width], dz[packet_width];
+    alignas(32) float tmax[packet_width];
+    alignas(32) float time[packet_width];
+    uint32_t active = 0;
+
+    ray get(int i) const {
+        return ray{vec3f(ox[i], oy[i], oz[i]), vec3f(dx[i], dy[i], dz[i]), time[i]};
+    }
+    void set(int i, const ray& r, float tMax = infinity) {
+        vec3f o = r.origin(), d = r.direction();
+        ox[i] = o.x, oy[i] = o.y, oz[i] = o.z;
+        dx[i] = d.x, dy[i] = d.y, dz[i] = d.z;
+        tmax[i] = tMax;
+        time[i] = r.time();
+        active |= 1u << i;
+    }
+
+    // True when every active ray points into the same octant, so a single
+    // near-child-first order is valid for the whole packet.
+    bool coherent() const {
+        vfloatn zero(0.f);
+        uint32_t x = (vfloatn::load(dx) < zero).movemask() & active;
+        uint32_t y = (vfloatn::load(dy) < zero).movemask() & active;
+        uint32_t z = (vfloatn::load(dz) < zero).movemask() & active;
+        return (x == 0 || x == active) && (y == 0 || y == active) && (z == 0 || z == active);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <math/vec.h>
+#include <math/util.h>
+
+// Orthonormal basis around a unit vector (Duff et al. 2017), without the
+// branch on the major axis of the older constructions.
+inline void coordinate_system(vec3f n, vec3f& t, vec3f& b) {
+    float sign = std::copysign(1.f, n.z);
+    float a = -1 / (sign + n.z);
+    float c = n.x * n.y * a;
+    t = vec3f(1 + sign * n.x * n.x * a, sign * c, -sign * n.x);
+    b = vec3f(c, sign + n.y * n.y * a, -n.y);
+}
+
+inline vec3f to_world(vec3f v, vec3f t, vec3f b, vec3f n) {
+    return t * v.x + b * v.y + n * v.z;
+}
+
+// Concentric mapping of [0, 1)^2 onto the unit disk, which keeps strata
+// compact.
+inline vec2f sample_uniform_disk_concentric(vec2f u) {
+    vec2f offset = 2.f * u - vec2f(1.f);
+    if (offset.x == 0 && offset.y == 0) return vec2f(0.f);
+    float r, theta;
+    if (std::abs(offset.x) > std::abs(offset.y)) {
+        r = offset.x;
+        theta = pi_4 * (offset.y / offset.x);
+    } else {
+        r = offset.y;
+        theta = pi_2 - pi_4 * (offset.x / offset.y);
+    }
+    return r * vec2f(std::cos(theta), std::sin(theta));
+}
+
+// Directions around +z with density cos(theta) / pi.
+inline vec3f sample_cosine_hemisphere(vec2f u) {
+    vec2f d = sample_uniform_disk_concentric(u);
+    float z = std::sqrt(std::max(0.f, 1 - d.x * d.x - d.y * d.y));
+    return vec3f(d.x, d.y, z);
+}
+
+inline float cosine_hemisphere_pdf(float cosTheta) {
+    return cosTheta * inv_pi;
+}
+
+// Multiple importance sampling weight of a sample drawn with density
+// pdfF against another strategy with density pdfG (Veach's power
+// heuristic with beta = 2).
+inline float power_heuristic(float pdfF, float pdfG) {
+    float f = pdfF * pdfF, g = pdfG * pdfG;
+    if (std::isinf(f)) return 1;
+    return f + g == 0 ? 0 : f / (f + g);
+}
\ No newline at end of file
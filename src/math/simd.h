@@ -0,0 +1,278 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define RENDERER_SIMD_AVX
+#define RENDERER_SIMD_SSE
+#elif defined(__SSE4_1__) || defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define RENDERER_SIMD_SSE
+#endif
+
+// Lane-parallel float and mask types. The generic versions are plain loops
+// over fixed-size arrays that compilers vectorize on any target (including
+// NEON); 4- and 8-wide specializations map straight onto SSE and AVX.
+#if defined(RENDERER_SIMD_AVX)
+constexpr int simd_width = 8;
+#else
+constexpr int simd_width = 4;
+#endif
+
+template <int N>
+struct vmask {
+    uint32_t bits;
+
+    vmask() = default;
+    explicit vmask(uint32_t bits) : bits(bits) {}
+
+    bool operator[](int i) const { return (bits >> i) & 1; }
+
+    vmask operator&(vmask m) const { return vmask(bits & m.bits); }
+    vmask operator|(vmask m) const { return vmask(bits | m.bits); }
+    vmask operator~() const { return vmask(~bits & ((1u << N) - 1)); }
+    uint32_t movemask() const { return bits; }
+};
+
+template <int N>
+struct vfloat {
+    float v[N];
+
+    vfloat() = default;
+    vfloat(float f) {
+        for (int i = 0; i < N; i++) v[i] = f;
+    }
+
+    static vfloat load(const float* p) {
+        vfloat r;
+        for (int i = 0; i < N; i++) r.v[i] = p[i];
+        return r;
+    }
+    void store(float* p) const {
+        for (int i = 0; i < N; i++) p[i] = v[i];
+    }
+
+    float operator[](int i) const { return v[i]; }
+
+#define RENDERER_VFLOAT_BINARY(op)                                  \
+    vfloat operator op(vfloat b) const {                            \
+        vfloat r;                                                   \
+        for (int i = 0; i < N; i++) r.v[i] = v[i] op b.v[i];        \
+        return r;                                                   \
+    }
+    RENDERER_VFLOAT_BINARY(+)
+    RENDERER_VFLOAT_BINARY(-)
+    RENDERER_VFLOAT_BINARY(*)
+    RENDERER_VFLOAT_BINARY(/)
+#undef RENDERER_VFLOAT_BINARY
+
+#define RENDERER_VFLOAT_COMPARE(op)                                 \
+    vmask<N> operator op(vfloat b) const {                          \
+        uint32_t bits = 0;                                          \
+        for (int i = 0; i < N; i++) bits |= uint32_t(v[i] op b.v[i]) << i; \
+        return vmask<N>(bits);                                      \
+    }
+    RENDERER_VFLOAT_COMPARE(<)
+    RENDERER_VFLOAT_COMPARE(<=)
+    RENDERER_VFLOAT_COMPARE(>)
+    RENDERER_VFLOAT_COMPARE(>=)
+    RENDERER_VFLOAT_COMPARE(==)
+#undef RENDERER_VFLOAT_COMPARE
+
+    vfloat operator-() const {
+        vfloat r;
+        for (int i = 0; i < N; i++) r.v[i] = -v[i];
+        return r;
+    }
+};
+
+template <int N>
+inline vfloat<N> min(vfloat<N> a, vfloat<N> b) {
+    vfloat<N> r;
+    for (int i = 0; i < N; i++) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+    return r;
+}
+template <int N>
+inline vfloat<N> max(vfloat<N> a, vfloat<N> b) {
+    vfloat<N> r;
+    for (int i = 0; i < N; i++) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+    return r;
+}
+template <int N>
+inline vfloat<N> abs(vfloat<N> a) {
+    vfloat<N> r;
+    for (int i = 0; i < N; i++) r.v[i] = std::abs(a.v[i]);
+    return r;
+}
+template <int N>
+inline vfloat<N> sqrt(vfloat<N> a) {
+    vfloat<N> r;
+    for (int i = 0; i < N; i++) r.v[i] = std::sqrt(a.v[i]);
+    return r;
+}
+template <int N>
+inline vfloat<N> fmadd(vfloat<N> a, vfloat<N> b, vfloat<N> c) {
+    vfloat<N> r;
+    for (int i = 0; i < N; i++) r.v[i] = std::fma(a.v[i], b.v[i], c.v[i]);
+    return r;
+}
+template <int N>
+inline vfloat<N> select(vmask<N> m, vfloat<N> a, vfloat<N> b) {
+    vfloat<N> r;
+    for (int i = 0; i < N; i++) r.v[i] = m[i] ? a.v[i] : b.v[i];
+    return r;
+}
+
+#if defined(RENDERER_SIMD_SSE)
+template <>
+struct vmask<4> {
+    __m128 m;
+
+    vmask() = default;
+    vmask(__m128 m) : m(m) {}
+    explicit vmask(uint32_t bits)
+        : m(_mm_castsi128_ps(_mm_cmpeq_epi32(
+              _mm_and_si128(_mm_set1_epi32(int(bits)), _mm_setr_epi32(1, 2, 4, 8)),
+              _mm_setr_epi32(1, 2, 4, 8)))) {}
+
+    bool operator[](int i) const { return (movemask() >> i) & 1; }
+
+    vmask operator&(vmask b) const { return _mm_and_ps(m, b.m); }
+    vmask operator|(vmask b) const { return _mm_or_ps(m, b.m); }
+    vmask operator~() const { return _mm_xor_ps(m, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+    uint32_t movemask() const { return uint32_t(_mm_movemask_ps(m)); }
+};
+
+template <>
+struct vfloat<4> {
+    __m128 m;
+
+    vfloat() = default;
+    vfloat(__m128 m) : m(m) {}
+    vfloat(float f) : m(_mm_set1_ps(f)) {}
+
+    static vfloat load(const float* p) { return _mm_loadu_ps(p); }
+    void store(float* p) const { _mm_storeu_ps(p, m); }
+
+    float operator[](int i) const {
+        alignas(16) float v[4];
+        _mm_store_ps(v, m);
+        return v[i];
+    }
+
+    vfloat operator+(vfloat b) const { return _mm_add_ps(m, b.m); }
+    vfloat operator-(vfloat b) const { return _mm_sub_ps(m, b.m); }
+    vfloat operator*(vfloat b) const { return _mm_mul_ps(m, b.m); }
+    vfloat operator/(vfloat b) const { return _mm_div_ps(m, b.m); }
+    vfloat operator-() const { return _mm_xor_ps(m, _mm_set1_ps(-0.f)); }
+
+    vmask<4> operator<(vfloat b) const { return _mm_cmplt_ps(m, b.m); }
+    vmask<4> operator<=(vfloat b) const { return _mm_cmple_ps(m, b.m); }
+    vmask<4> operator>(vfloat b) const { return _mm_cmpgt_ps(m, b.m); }
+    vmask<4> operator>=(vfloat b) const { return _mm_cmpge_ps(m, b.m); }
+    vmask<4> operator==(vfloat b) const { return _mm_cmpeq_ps(m, b.m); }
+};
+
+inline vfloat<4> min(vfloat<4> a, vfloat<4> b) { return _mm_min_ps(a.m, b.m); }
+inline vfloat<4> max(vfloat<4> a, vfloat<4> b) { return _mm_max_ps(a.m, b.m); }
+inline vfloat<4> abs(vfloat<4> a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a.m); }
+inline vfloat<4> sqrt(vfloat<4> a) { return _mm_sqrt_ps(a.m); }
+inline vfloat<4> fmadd(vfloat<4> a, vfloat<4> b, vfloat<4> c) {
+#if defined(__FMA__)
+    return _mm_fmadd_ps(a.m, b.m, c.m);
+#else
+    return _mm_add_ps(_mm_mul_ps(a.m, b.m), c.m);
+#endif
+}
+inline vfloat<4> select(vmask<4> m, vfloat<4> a, vfloat<4> b) {
+#if defined(__SSE4_1__)
+    return _mm_blendv_ps(b.m, a.m, m.m);
+#else
+    return _mm_or_ps(_mm_and_ps(m.m, a.m), _mm_andnot_ps(m.m, b.m));
+#endif
+}
+#endif
+
+#if defined(RENDERER_SIMD_AVX)
+template <>
+struct vmask<8> {
+    __m256 m;
+
+    vmask() = default;
+    vmask(__m256 m) : m(m) {}
+    explicit vmask(uint32_t bits)
+        : m(_mm256_castsi256_ps(_mm256_setr_epi32(
+              -int((bits >> 0) & 1), -int((bits >> 1) & 1), -int((bits >> 2) & 1), -int((bits >> 3) & 1),
+              -int((bits >> 4) & 1), -int((bits >> 5) & 1), -int((bits >> 6) & 1), -int((bits >> 7) & 1)))) {}
+
+    bool operator[](int i) const { return (movemask() >> i) & 1; }
+
+    vmask operator&(vmask b) const { return _mm256_and_ps(m, b.m); }
+    vmask operator|(vmask b) const { return _mm256_or_ps(m, b.m); }
+    vmask operator~() const { return _mm256_xor_ps(m, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+    uint32_t movemask() const { return uint32_t(_mm256_movemask_ps(m)); }
+};
+
+template <>
+struct vfloat<8> {
+    __m256 m;
+
+    vfloat() = default;
+    vfloat(__m256 m) : m(m) {}
+    vfloat(float f) : m(_mm256_set1_ps(f)) {}
+
+    static vfloat load(const float* p) { return _mm256_loadu_ps(p); }
+    void store(float* p) const { _mm256_storeu_ps(p, m); }
+
+    float operator[](int i) const {
+        alignas(32) float v[8];
+        _mm256_store_ps(v, m);
+        return v[i];
+    }
+
+    vfloat operator+(vfloat b) const { return _mm256_add_ps(m, b.m); }
+    vfloat operator-(vfloat b) const { return _mm256_sub_ps(m, b.m); }
+    vfloat operator*(vfloat b) const { return _mm256_mul_ps(m, b.m); }
+    vfloat operator/(vfloat b) const { return _mm256_div_ps(m, b.m); }
+    vfloat operator-() const { return _mm256_xor_ps(m, _mm256_set1_ps(-0.f)); }
+
+    vmask<8> operator<(vfloat b) const { return _mm256_cmp_ps(m, b.m, _CMP_LT_OQ); }
+    vmask<8> operator<=(vfloat b) const { return _mm256_cmp_ps(m, b.m, _CMP_LE_OQ); }
+    vmask<8> operator>(vfloat b) const { return _mm256_cmp_ps(m, b.m, _CMP_GT_OQ); }
+    vmask<8> operator>=(vfloat b) const { return _mm256_cmp_ps(m, b.m, _CMP_GE_OQ); }
+    vmask<8> operator==(vfloat b) const { return _mm256_cmp_ps(m, b.m, _CMP_EQ_OQ); }
+};
+
+inline vfloat<8> min(vfloat<8> a, vfloat<8> b) { return _mm256_min_ps(a.m, b.m); }
+inline vfloat<8> max(vfloat<8> a, vfloat<8> b) { return _mm256_max_ps(a.m, b.m); }
+inline vfloat<8> abs(vfloat<8> a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a.m); }
+inline vfloat<8> sqrt(vfloat<8> a) { return _mm256_sqrt_ps(a.m); }
+inline vfloat<8> fmadd(vfloat<8> a, vfloat<8> b, vfloat<8> c) {
+#if defined(__FMA__)
+    return _mm256_fmadd_ps(a.m, b.m, c.m);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a.m, b.m), c.m);
+#endif
+}
+inline vfloat<8> select(vmask<8> m, vfloat<8> a, vfloat<8> b) {
+    return _mm256_blendv_ps(b.m, a.m, m.m);
+}
+#endif
+
+template <int N>
+inline vfloat<N> fma(vfloat<N> a, vfloat<N> b, vfloat<N> c) {
+    return fmadd(a, b, c);
+}
+
+template <int N>
+inline bool any(vmask<N> m) { return m.movemask() != 0; }
+template <int N>
+inline bool all(vmask<N> m) { return m.movemask() == (1u << N) - 1; }
+template <int N>
+inline bool none(vmask<N> m) { return m.movemask() == 0; }
+
+using vfloatn = vfloat<simd_width>;
+using vmaskn = vmask<simd_width>;
\ No newline at end of file
@@ -1,5 +1,176 @@
 #include "transform.h"
 
+#include <cstring>
+
+namespace {
+
+// Transforms simd_width points (w = 1) or vectors (w = 0) held in lanes,
+// with the operation order of transform::apply so results match it
+// exactly.
+template <transform_kind K>
+void transform_lanes(const matrix<4>& m, vfloatn& x, vfloatn& y, vfloatn& z, float w) {
+    if constexpr (K == transform_kind::identity) {
+        return;
+    } else if constexpr (K == transform_kind::translation) {
+        if (w == 0) return;
+        vfloatn vw(w);
+        x = x + vfloatn(m[0][3]) * vw;
+        y = y + vfloatn(m[1][3]) * vw;
+        z = z + vfloatn(m[2][3]) * vw;
+    } else {
+        vfloatn xp = vfloatn(m[0][0]) * x + vfloatn(m[0][1]) * y + vfloatn(m[0][2]) * z;
+        vfloatn yp = vfloatn(m[1][0]) * x + vfloatn(m[1][1]) * y + vfloatn(m[1][2]) * z;
+        vfloatn zp = vfloatn(m[2][0]) * x + vfloatn(m[2][1]) * y + vfloatn(m[2][2]) * z;
+        if (w == 0) {
+            x = xp, y = yp, z = zp;
+            return;
+        }
+
+        vfloatn vw(w);
+        xp = xp + vfloatn(m[0][3]) * vw;
+        yp = yp + vfloatn(m[1][3]) * vw;
+        zp = zp + vfloatn(m[2][3]) * vw;
+        if constexpr (K == transform_kind::projective) {
+            vfloatn wp = vfloatn(m[3][0]) * x + vfloatn(m[3][1]) * y + vfloatn(m[3][2]) * z + vfloatn(m[3][3]) * vw;
+            vmaskn projective = ~(wp == vfloatn(1.f));
+            if (any(projective)) {
+                vfloatn invW = vfloatn(1.f) / wp;
+                xp = select(projective, xp * invW, xp);
+                yp = select(projective, yp * invW, yp);
+                zp = select(projective, zp * invW, zp);
+            }
+        }
+        x = xp, y = yp, z = zp;
+    }
+}
+
+// Calls f with the lane kernel for kind; rigid and affine share one.
+template <typename F>
+void with_kernel(transform_kind kind, F&& f) {
+    switch (kind) {
+        case transform_kind::identity: f(transform_lanes<transform_kind::identity>); break;
+        case transform_kind::translation: f(transform_lanes<transform_kind::translation>); break;
+        case transform_kind::rigid:
+        case transform_kind::affine: f(transform_lanes<transform_kind::affine>); break;
+        default: f(transform_lanes<transform_kind::projective>); break;
+    }
+}
+
+template <typename K>
+void transform_points(K kernel, const matrix<4>& m, std::span<const vec3f> in, std::span<vec3f> out, float w) {
+    if (kernel == transform_lanes<transform_kind::identity>) {
+        if (in.data() != out.data()) std::memmove(out.data(), in.data(), in.size_bytes());
+        return;
+    }
+    alignas(32) float x[simd_width], y[simd_width], z[simd_width];
+    for (size_t i = 0; i < in.size(); i += simd_width) {
+        int count = int(std::min(size_t(simd_width), in.size() - i));
+        for (int j = 0; j < simd_width; j++) {
+            vec3f p = in[i + std::min(j, count - 1)];
+            x[j] = p.x, y[j] = p.y, z[j] = p.z;
+        }
+        vfloatn vx = vfloatn::load(x), vy = vfloatn::load(y), vz = vfloatn::load(z);
+        kernel(m, vx, vy, vz, w);
+        vx.store(x), vy.store(y), vz.store(z);
+        for (int j = 0; j < count; j++)
+            out[i + j] = vec3f(x[j], y[j], z[j]);
+    }
+}
+
+template <typename K>
+void transform_rays(K kernel, const matrix<4>& m, std::span<const ray> in, std::span<ray> out) {
+    if (kernel == transform_lanes<transform_kind::identity>) {
+        if (in.data() != out.data()) std::memmove(out.data(), in.data(), in.size_bytes());
+        return;
+    }
+    ray_packet packet;
+    for (size_t i = 0; i < in.size(); i += packet_width) {
+        int count = int(std::min(size_t(packet_width), in.size() - i));
+        for (int j = 0; j < packet_width; j++)
+            packet.set(j, in[i + std::min(j, count - 1)]);
+        vfloatn ox = vfloatn::load(packet.ox), oy = vfloatn::load(packet.oy), oz = vfloatn::load(packet.oz);
+        vfloatn dx = vfloatn::load(packet.dx), dy = vfloatn::load(packet.dy), dz = vfloatn::load(packet.dz);
+        kernel(m, ox, oy, oz, 1.f);
+        kernel(m, dx, dy, dz, 0.f);
+        ox.store(packet.ox), oy.store(packet.oy), oz.store(packet.oz);
+        dx.store(packet.dx), dy.store(packet.dy), dz.store(packet.dz);
+        for (int j = 0; j < count; j++)
+            out[i + j] = packet.get(j);
+    }
+}
+
+template <typename K>
+void transform_packet(K kernel, const matrix<4>& m, ray_packet& rays) {
+    vfloatn ox = vfloatn::load(rays.ox), oy = vfloatn::load(rays.oy), oz = vfloatn::load(rays.oz);
+    vfloatn dx = vfloatn::load(rays.dx), dy = vfloatn::load(rays.dy), dz = vfloatn::load(rays.dz);
+    kernel(m, ox, oy, oz, 1.f);
+    kernel(m, dx, dy, dz, 0.f);
+    ox.store(rays.ox), oy.store(rays.oy), oz.store(rays.oz);
+    dx.store(rays.dx), dy.store(rays.dy), dz.store(rays.dz);
+}
+
+}
+
+transform_kind classify(const matrix<4>& m) {
+    if (m[3][0] != 0 || m[3][1] != 0 || m[3][2] != 0 || m[3][3] != 1) return transform_kind::projective;
+
+    bool linearIdentity = true;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            linearIdentity &= m[i][j] == (i == j ? 1.f : 0.f);
+    if (linearIdentity) {
+        if (m[0][3] == 0 && m[1][3] == 0 && m[2][3] == 0) return transform_kind::identity;
+        return transform_kind::translation;
+    }
+
+    // Orthonormal rows, allowing for rounding in the factory functions.
+    constexpr float tolerance = 1e-5f;
+    for (int i = 0; i < 3; i++) {
+        for (int j = i; j < 3; j++) {
+            float d = m[i][0] * m[j][0] + m[i][1] * m[j][1] + m[i][2] * m[j][2];
+            if (std::abs(d - (i == j ? 1.f : 0.f)) > tolerance) return transform_kind::affine;
+        }
+    }
+    return transform_kind::rigid;
+}
+
+bounds3f transform::apply(const bounds3f& b) const {
+    if (b.is_empty()) return b;
+    bounds3f result;
+    for (int corner = 0; corner < 8; corner++) {
+        vec3f p((corner & 1) ? b.pmax.x : b.pmin.x, (corner & 2) ? b.pmax.y : b.pmin.y,
+                (corner & 4) ? b.pmax.z : b.pmin.z);
+        result = union_of(result, apply(p));
+    }
+    return result;
+}
+
+void transform::apply(std::span<const vec3f> in, std::span<vec3f> out, float w) const {
+    assert(type == transform_kind::projective || w == 0 || w == 1);
+    with_kernel(type, [&](auto kernel) { transform_points(kernel, m, in, out, w); });
+}
+
+void transform::apply(std::span<const ray> in, std::span<ray> out) const {
+    with_kernel(type, [&](auto kernel) { transform_rays(kernel, m, in, out); });
+}
+
+void transform::apply(ray_packet& rays) const {
+    with_kernel(type, [&](auto kernel) { transform_packet(kernel, m, rays); });
+}
+
+void transform::apply_inverse(std::span<const vec3f> in, std::span<vec3f> out, float w) const {
+    assert(type == transform_kind::projective || w == 0 || w == 1);
+    with_kernel(type, [&](auto kernel) { transform_points(kernel, mInv, in, out, w); });
+}
+
+void transform::apply_inverse(std::span<const ray> in, std::span<ray> out) const {
+    with_kernel(type, [&](auto kernel) { transform_rays(kernel, mInv, in, out); });
+}
+
+void transform::apply_inverse(ray_packet& rays) const {
+    with_kernel(type, [&](auto kernel) { transform_packet(kernel, mInv, rays); });
+}
+
 transform translate(vec3f delta) {
     matrix<4> m(1, 0, 0, delta.x,
                 0, 1, 0, delta.y,
@@ -9,7 +180,7 @@ transform translate(vec3f delta) {
                 0, 1, 0, -delta.y,
                 0, 0, 1, -delta.z,
                 0, 0, 0, 1);
-    return transform{m, i};
+    return transform{m, i, delta == vec3f(0.f) ? transform_kind::identity : transform_kind::translation};
 }
 
 transform scale(vec3f scale) {
@@ -21,7 +192,7 @@ transform scale(vec3f scale) {
                 0, 1 / scale.y, 0, 0,
                 0, 0, 1 / scale.z, 0,
                 0, 0, 0, 1);
-    return transform{m, i};
+    return transform{m, i, scale == vec3f(1.f) ? transform_kind::identity : transform_kind::affine};
 }
 
 transform rotate_x(float theta) {
@@ -32,7 +203,7 @@ transform rotate_x(float theta) {
                 0, cosTheta, -sinTheta, 0,
                 0, sinTheta, cosTheta, 0,
                 0, 0, 0, 1);
-    return transform{m, transpose(m)};
+    return transform{m, transpose(m), transform_kind::rigid};
 }
 
 transform rotate_y(float theta) {
@@ -43,7 +214,7 @@ transform rotate_y(float theta) {
                 0, 1, 0, 0,
                 -sinTheta, 0, cosTheta, 0,
                 0, 0, 0, 1);
-    return transform{m, transpose(m)};
+    return transform{m, transpose(m), transform_kind::rigid};
 }
 
 transform rotate_z(float theta) {
@@ -54,7 +225,7 @@ transform rotate_z(float theta) {
                 sinTheta, cosTheta, 0, 0,
                 0, 0, 1, 0,
                 0, 0, 0, 1);
-    return transform{m, transpose(m)};
+    return transform{m, transpose(m), transform_kind::rigid};
 }
 
 inline transform rotate(float sinTheta, float cosTheta, vec3f axis) {
@@ -73,7 +244,7 @@ inline transform rotate(float sinTheta, float cosTheta, vec3f axis) {
     m[2][2] = a.z * a.z + (1 - a.z * a.z) * cosTheta;
     m[2][3] = 0;
 
-    return transform{m, transpose(m)};
+    return transform{m, transpose(m), transform_kind::rigid};
 }
 
 transform rotate(float theta, vec3f axis) {
@@ -97,7 +268,7 @@ transform rotate_from_to(vec3f from, vec3f to) {
                         2 / dot(v, v) * v[i] * v[j] +
                         4 * dot(u, v) / (dot(u, u) * dot(v, v)) * v[i] * u[j];
 
-    return transform{res, transpose(res)};
+    return transform{res, transpose(res), transform_kind::rigid};
 }
 
 transform look_at(vec3f pos, vec3f look, vec3f up) {
@@ -130,7 +301,7 @@ transform look_at(vec3f pos, vec3f look, vec3f up) {
     m[2][2] = dir.z;
     m[3][2] = 0;
 
-    return transform{m, *inverse(m)};
+    return transform{m, *inverse(m), transform_kind::rigid};
 }
 
 transform orthographic(float near, float far) {
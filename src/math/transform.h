@@ -1,15 +1,36 @@
 #pragma once
 
+#include <math/bounds.h>
 #include <math/mat.h>
 #include <math/ray.h>
+#include <math/ray_packet.h>
+
+#include <cassert>
+#include <span>
+
+// What a transform can do, from least to most general. Each class is a
+// superset of the ones before it, so the class of a product is the larger
+// of its factors' classes, and the class of an inverse is its own.
+enum class transform_kind : uint8_t {
+    identity,
+    translation,
+    rigid,
+    affine,
+    projective
+};
+
+transform_kind classify(const matrix<4>& m);
 
 class transform {
 public:
     transform() : m{}, mInv{} {}
     transform(matrix<4> t, matrix<4> tInv)
-        : m(t), mInv(tInv) {}
+        : m(t), mInv(tInv), type(classify(t)) {}
+    // For callers that know the class; it must not understate the matrix.
+    transform(matrix<4> t, matrix<4> tInv, transform_kind kind)
+        : m(t), mInv(tInv), type(kind) {}
     transform(matrix<4> t)
-        : m(t) {
+        : m(t), type(classify(t)) {
         std::optional<matrix<4>> inv = inverse(t);
         if (inv) mInv = *inv;
         else {
@@ -23,38 +44,51 @@ public:
 
     bool operator==(const transform& t) const { return m == t.m; }
     bool operator!=(const transform& t) const { return m != t.m; }
-    bool is_identity() const { return m.is_identity(); }
+    bool is_identity() const { return type == transform_kind::identity; }
+    transform_kind kind() const { return type; }
 
     matrix<4> get_matrix() const { return m; }
     matrix<4> get_inverse_matrix() const { return mInv; }
 
     template <typename T>
     auto apply(vec3<T> v, T w = 1) const -> vec3<decltype(T{} + float{})> {
-        float xp = m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z;
-        float yp = m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z;
-        float zp = m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z;
-        if (w != 0) {
-            xp += m[0][3] * w;
-            yp += m[1][3] * w;
-            zp += m[2][3] * w;
-        }
-        T wp = m[3][0] * v.x + m[3][1] * v.y + m[3][2] * v.z + m[3][3] * w;
-        vec3<decltype(T{} + float{})> vp{xp, yp, zp};
-        if (w != 0 && wp != 1) vp /= wp;
-        return vp;
+        return apply(m, type, v, w);
     }
     ray apply(const ray& r) const {
-        return ray{apply(r.origin(), 1.f), apply(r.direction(), 0.f)};
+        return ray{apply(r.origin(), 1.f), apply(r.direction(), 0.f), r.time()};
     }
 
     template <typename T>
-    vec3<T> apply_inverse(vec3<T> v, T w = 1) const {
-        return transform{mInv, m}.apply<T>(v, w);
+    auto apply_inverse(vec3<T> v, T w = 1) const -> vec3<decltype(T{} + float{})> {
+        return apply(mInv, type, v, w);
     }
     ray apply_inverse(const ray& r) const {
-        return transform{mInv, m}.apply(r);
+        return ray{apply_inverse(r.origin(), 1.f), apply_inverse(r.direction(), 0.f), r.time()};
     }
 
+    // Normals transform by the inverse transpose; rigid transforms and
+    // below can use the matrix itself. The result is not renormalized.
+    vec3f apply_normal(vec3f n) const {
+        if (type <= transform_kind::translation) return n;
+        if (type == transform_kind::rigid) return apply<transform_kind::affine>(m, n, 0.f);
+        return {mInv[0][0] * n.x + mInv[1][0] * n.y + mInv[2][0] * n.z,
+                mInv[0][1] * n.x + mInv[1][1] * n.y + mInv[2][1] * n.z,
+                mInv[0][2] * n.x + mInv[1][2] * n.y + mInv[2][2] * n.z};
+    }
+
+    // Bounds of the eight transformed corners.
+    bounds3f apply(const bounds3f& b) const;
+
+    // Batch versions, SIMD across elements and bit-identical to the single
+    // element overloads. w = 1 transforms points, w = 0 vectors; in and out
+    // may alias.
+    void apply(std::span<const vec3f> in, std::span<vec3f> out, float w = 1) const;
+    void apply(std::span<const ray> in, std::span<ray> out) const;
+    void apply(ray_packet& rays) const;
+    void apply_inverse(std::span<const vec3f> in, std::span<vec3f> out, float w = 1) const;
+    void apply_inverse(std::span<const ray> in, std::span<ray> out) const;
+    void apply_inverse(ray_packet& rays) const;
+
     vec3f operator()(vec3f v) const {
         return apply(v);
     }
@@ -63,15 +97,61 @@ public:
     }
 
     transform operator*(const transform& t) const {
-        return {m * t.m, t.mInv * mInv};
+        if (t.type == transform_kind::identity) return *this;
+        if (type == transform_kind::identity) return t;
+        return {m * t.m, t.mInv * mInv, std::max(type, t.type)};
     }
 
 private:
     matrix<4> m, mInv;
+
+    transform_kind type = transform_kind::identity;
+
+    // Kernels per class. Zero terms and the homogeneous divide are skipped
+    // where the class guarantees them; for finite inputs and w = 0 or 1 the
+    // results match the projective kernel up to the sign of zero. Other w
+    // would need the divide, so only the projective kernel accepts them.
+    template <transform_kind K, typename T>
+    static auto apply(const matrix<4>& m, vec3<T> v, T w) -> vec3<decltype(T{} + float{})> {
+        using R = decltype(T{} + float{});
+        if constexpr (K != transform_kind::projective) assert(w == 0 || w == 1);
+        if constexpr (K == transform_kind::identity) {
+            return vec3<R>(v.x, v.y, v.z);
+        } else if constexpr (K == transform_kind::translation) {
+            if (w == 0) return vec3<R>(v.x, v.y, v.z);
+            return vec3<R>(v.x + m[0][3] * w, v.y + m[1][3] * w, v.z + m[2][3] * w);
+        } else {
+            float xp = m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z;
+            float yp = m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z;
+            float zp = m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z;
+            if (w != 0) {
+                xp += m[0][3] * w;
+                yp += m[1][3] * w;
+                zp += m[2][3] * w;
+            }
+            vec3<R> vp{xp, yp, zp};
+            if constexpr (K == transform_kind::projective) {
+                T wp = m[3][0] * v.x + m[3][1] * v.y + m[3][2] * v.z + m[3][3] * w;
+                if (w != 0 && wp != 1) vp /= wp;
+            }
+            return vp;
+        }
+    }
+
+    template <typename T>
+    static auto apply(const matrix<4>& m, transform_kind kind, vec3<T> v, T w) -> vec3<decltype(T{} + float{})> {
+        switch (kind) {
+            case transform_kind::identity: return apply<transform_kind::identity>(m, v, w);
+            case transform_kind::translation: return apply<transform_kind::translation>(m, v, w);
+            case transform_kind::rigid:
+            case transform_kind::affine: return apply<transform_kind::affine>(m, v, w);
+            default: return apply<transform_kind::projective>(m, v, w);
+        }
+    }
 };
 
 inline transform inverse(const transform& t) {
-    return transform{t.get_inverse_matrix(), t.get_matrix()};
+    return transform{t.get_inverse_matrix(), t.get_matrix(), t.kind()};
 }
 
 transform translate(vec3f delta);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cmath>
+#include <limits>
 
 constexpr float pi = 3.14159265358979323846;
 constexpr float inv_pi = 0.31830988618379067154;
@@ -10,23 +11,33 @@ constexpr float pi_2 = 1.57079632679489661923;
 constexpr float pi_4 = 0.78539816339744830961;
 constexpr float sqrt2 = 1.41421356237309504880;
 
+constexpr float machine_epsilon = std::numeric_limits<float>::epsilon() * 0.5f;
+
+// Bound on the relative error of n successive float operations.
+constexpr float error_gamma(int n) {
+    return (n * machine_epsilon) / (1 - n * machine_epsilon);
+}
+
 template <typename T>
 inline T clamp(T t, T a, T b) {
     return std::min(std::max(t, a), b);
 }
 
+// Unqualified fma so that SIMD lane types pick up their own overloads.
 template <typename Ta, typename Tb, typename Tc, typename Td>
 inline auto diff_of_products(Ta a, Tb b, Tc c, Td d) {
+    using std::fma;
     auto cd = c * d;
-    auto dop = std::fma(a, b, -cd);
-    auto error = std::fma(-c, d, cd);
+    auto dop = fma(a, b, -cd);
+    auto error = fma(-c, d, cd);
     return dop + error;
 }
 template <typename Ta, typename Tb, typename Tc, typename Td>
 inline auto sum_of_products(Ta a, Tb b, Tc c, Td d) {
-    auto cd = c * c;
-    auto sop = std::fma(a, b, cd);
-    auto error = std::fma(c, d, -cd);
+    using std::fma;
+    auto cd = c * d;
+    auto sop = fma(a, b, cd);
+    auto error = fma(c, d, -cd);
     return sop + error;
 }
 
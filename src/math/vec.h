@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 
 template <typename T>
@@ -29,7 +30,7 @@ public:
 
     template <typename I>
     auto operator+(vec2<I> t) const -> vec2<decltype(T{} + I{})> {
-        return {x + t.x, y + t.x};
+        return {x + t.x, y + t.y};
     }
     template <typename I>
     vec2<T>& operator+=(vec2<I> t) {
@@ -148,7 +149,7 @@ public:
 
     template <typename I>
     auto operator+(vec3<I> t) const -> vec3<decltype(T{} + I{})> {
-        return {x + t.x, y + t.x, z + t.z};
+        return {x + t.x, y + t.y, z + t.z};
     }
     template <typename I>
     vec3<T>& operator+=(vec3<I> t) {
@@ -234,6 +235,11 @@ template <typename T>
 inline auto mix(vec3<T> t0, vec3<T> t1, float a) -> vec3<decltype(T{} * a)> {
     return (1 - a) * t0 + a * t1;
 }
+// Component-wise product, e.g. for scaling a color by a reflectance.
+template <typename T>
+inline vec3<T> mul(vec3<T> t0, vec3<T> t1) {
+    return {t0.x * t1.x, t0.y * t1.y, t0.z * t1.z};
+}
 template <typename T>
 inline vec3<T> cross(vec3<T> u, vec3<T> v) {
     return {u[1] * v[2] - u[2] * v[1],
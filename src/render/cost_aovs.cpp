@@ -0,0 +1,33 @@
+#include "cost_aovs.h"
+
+#include <render/film.h>
+
+#include <filesystem>
+
+cost_aovs::cost_aovs(vec2i resolution)
+    : nodes(resolution), primitives(resolution), nanoseconds(resolution) {
+    clear();
+}
+
+void cost_aovs::clear() {
+    for (image2d<1, float>* image : {&nodes, &primitives, &nanoseconds})
+        std::fill(image->data().begin(), image->data().end(), 0.f);
+}
+
+bool cost_aovs::write(const std::string& output, const film& film) {
+    std::filesystem::path base(output);
+    auto path_of = [&](const char* name) {
+        std::filesystem::path path = base;
+        return path.replace_extension(std::string(name) + ".exr").string();
+    };
+
+    image2d<1, float> samples(film.dimensions());
+    for (int y = 0; y < samples.height(); y++)
+        for (int x = 0; x < samples.width(); x++)
+            samples.pixel({x, y})[0] = float(film.samples({x, y}));
+
+    bool ok = nanoseconds.write(path_of("ns")) && samples.write(path_of("samples"));
+    if constexpr (profiling_enabled)
+        ok = ok && nodes.write(path_of("bvh_nodes")) && primitives.write(path_of("primitive_tests"));
+    return ok;
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <image/image.h>
+#include <math/vec.h>
+#include <util/profiler.h>
+
+#include <cstdint>
+#include <string>
+
+class film;
+
+// Work done on the calling thread: BVH nodes visited, primitives tested
+// and time. Readings are running totals; the difference of two is the
+// cost of what ran between them. Node and primitive counts are only kept
+// with RENDERER_INSTRUMENTATION.
+struct render_cost {
+    uint64_t bvh_nodes = 0;
+    uint64_t primitive_tests = 0;
+    int64_t ns = 0;
+
+    static render_cost now() {
+        return {profile_thread_count(profile_counter::bvh_nodes),
+                profile_thread_count(profile_counter::primitive_tests), profiling::now_ns()};
+    }
+
+    render_cost operator-(const render_cost& start) const {
+        return {bvh_nodes - start.bvh_nodes, primitive_tests - start.primitive_tests, ns - start.ns};
+    }
+};
+
+// Per-pixel cost images (AOVs): where in the frame traversal work and
+// render time go, summed over each pixel's samples. Like the film, tiles
+// own disjoint pixels, so threads add without synchronization.
+class cost_aovs {
+public:
+    explicit cost_aovs(vec2i resolution);
+
+    // share spreads the cost of work done for several pixels at once, such
+    // as a packet of rays, over each of them.
+    void add(vec2i p, const render_cost& cost, float share = 1.f) {
+        nodes.pixel(p)[0] += float(cost.bvh_nodes) * share;
+        primitives.pixel(p)[0] += float(cost.primitive_tests) * share;
+        nanoseconds.pixel(p)[0] += float(cost.ns) * share;
+    }
+
+    void clear();
+
+    // Single-channel float images next to output, named after it: for
+    // out.png, out.ns.exr, out.samples.exr (taken from the film) and, when
+    // counting, out.bvh_nodes.exr and out.primitive_tests.exr.
+    bool write(const std::string& output, const film& film);
+
+private:
+    image2d<1, float> nodes, primitives, nanoseconds;
+};
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "film.h"
+
+#include <color/color.h>
+#include <common.h>
+#include <util/profiler.h>
+
+film::film(vec2i resolution)
+    : resolution(resolution) {
+    size_t pixels = size_t(resolution.x) * resolution.y;
+    mean.assign(pixels, vec3f(0.f));
+    luminanceMean.assign(pixels, 0.f);
+    luminanceM2.assign(pixels, 0.f);
+    count.assign(pixels, 0);
+}
+
+void film::add_sample(vec2i p, vec3f L) {
+    profile_count(profile_counter::samples);
+    size_t i = index(p);
+    uint32_t n = ++count[i];
+    float invN = 1.f / float(n);
+
+    mean[i] += (L - mean[i]) * invN;
+
+    float y = luminance(L);
+    float delta = y - luminanceMean[i];
+    luminanceMean[i] += delta * invN;
+    luminanceM2[i] += delta * (y - luminanceMean[i]);
+}
+
+float film::variance(vec2i p) const {
+    size_t i = index(p);
+    if (count[i] < 2) return infinity;
+    return luminanceM2[i] / float(count[i] - 1);
+}
+
+float film::relative_error(vec2i p) const {
+    size_t i = index(p);
+    if (count[i] < 2) return infinity;
+    float standardError = std::sqrt(variance(p) / float(count[i]));
+    return standardError / std::max(luminanceMean[i], 1e-2f);
+}
+
+uint64_t film::total_samples() const {
+    uint64_t total = 0;
+    for (uint32_t n : count) total += n;
+    return total;
+}
+
+void film::resolve(image2d<3, float>& image) const {
+    profile_scope scope(profile_stage::resolve);
+    for (int y = 0; y < resolution.y; y++) {
+        for (int x = 0; x < resolution.x; x++) {
+            vec3f c = mean[index({x, y})];
+            std::span<float, 3> out = image.pixel({x, y});
+            out[0] = c.x;
+            out[1] = c.y;
+            out[2] = c.z;
+        }
+    }
+}
\ No newline at end of file
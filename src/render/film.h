@@ -0,0 +1,38 @@
+#pragma once
+
+#include <math/vec.h>
+#include <image/image.h>
+
+#include <cstdint>
+#include <vector>
+
+// Float accumulation buffer for progressive rendering. Every pixel keeps a
+// running mean and, for adaptive sampling, Welford's running variance of
+// its luminance. Tiles own disjoint pixels, so render threads update it
+// without synchronization.
+class film {
+public:
+    explicit film(vec2i resolution);
+
+    vec2i dimensions() const { return resolution; }
+
+    void add_sample(vec2i p, vec3f L);
+
+    uint32_t samples(vec2i p) const { return count[index(p)]; }
+    vec3f color(vec2i p) const { return mean[index(p)]; }
+    float variance(vec2i p) const;
+    // Standard error of the luminance estimate relative to its magnitude.
+    float relative_error(vec2i p) const;
+
+    uint64_t total_samples() const;
+
+    void resolve(image2d<3, float>& image) const;
+
+private:
+    vec2i resolution;
+    std::vector<vec3f> mean;
+    std::vector<float> luminanceMean, luminanceM2;
+    std::vector<uint32_t> count;
+
+    size_t index(vec2i p) const { return size_t(p.y) * resolution.x + p.x; }
+};
\ No newline at end of file
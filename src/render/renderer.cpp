@@ -0,0 +1,36 @@
+#include "renderer.h"
+
+std::vector<tile> make_tiles(vec2i resolution, int tileSize) {
+    tileSize = std::max(1, tileSize);
+    std::vector<tile> tiles;
+    int index = 0;
+    for (int y = 0; y < resolution.y; y += tileSize) {
+        for (int x = 0; x < resolution.x; x += tileSize) {
+            vec2i max(std::min(x + tileSize, resolution.x), std::min(y + tileSize, resolution.y));
+            tiles.push_back({{x, y}, max, index++});
+        }
+    }
+    return tiles;
+}
+
+int tile_size_for(vec2i resolution, const render_options& options) {
+    int tileSize = std::max(1, options.tile_size);
+    if (options.deterministic) return tileSize;
+
+    // Shrink tiles until every thread gets a handful of them to steal from.
+    int64_t minTiles = int64_t(global_thread_pool().size()) * 8;
+    while (tileSize > 8) {
+        int64_t tilesX = (resolution.x + tileSize - 1) / tileSize;
+        int64_t tilesY = (resolution.y + tileSize - 1) / tileSize;
+        if (tilesX * tilesY >= minTiles) break;
+        tileSize /= 2;
+    }
+    return tileSize;
+}
+
+bool needs_samples(const film& film, vec2i p, const render_options& options) {
+    uint32_t n = film.samples(p);
+    if (n >= uint32_t(options.spp)) return false;
+    if (!options.adaptive() || n < uint32_t(options.min_spp)) return true;
+    return film.relative_error(p) >= options.noise_threshold;
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <math/vec.h>
+#include <render/film.h>
+#include <render/thread_pool.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+struct tile {
+    vec2i min, max;
+    int index;
+};
+
+struct render_options {
+    int threads = 0;
+    int tile_size = 32;
+    // Keeps the tile layout independent of the thread count so that any
+    // per-tile state yields bit-identical output on every machine.
+    bool deterministic = false;
+
+    // Progressive sampling: the first pass takes min_spp samples per pixel,
+    // later passes add pass_spp more until a pixel has spp samples or, when
+    // noise_threshold > 0, its relative error falls below the threshold.
+    int spp = 1;
+    int min_spp = 8;
+    int pass_spp = 4;
+    float noise_threshold = 0;
+
+    bool adaptive() const { return noise_threshold > 0; }
+};
+
+// Tile sizes below one are treated as one.
+std::vector<tile> make_tiles(vec2i resolution, int tileSize);
+int tile_size_for(vec2i resolution, const render_options& options);
+
+// Calls fn(const tile&) once per tile on the global pool. Tiles cover
+// disjoint pixel ranges, so fn may write its pixels into a shared
+// framebuffer without synchronization.
+template <typename F>
+void render_tiles(vec2i resolution, const render_options& options, F&& fn) {
+    std::vector<tile> tiles = make_tiles(resolution, tile_size_for(resolution, options));
+
+    task_group group;
+    for (const tile& t : tiles)
+        group.run([&fn, &t] { fn(t); });
+    group.wait();
+}
+
+bool needs_samples(const film& film, vec2i p, const render_options& options);
+
+// Renders in passes: fn(const tile&, int samples) adds up to samples
+// samples to every pixel of the tile for which needs_samples() holds.
+// Tiles whose pixels have all converged are dropped from later passes.
+// Convergence is only evaluated between passes, so with a deterministic
+// tile layout the result does not depend on scheduling. onPass(samples)
+// runs on the calling thread after every pass, with samples the number of
+// samples per pixel taken so far.
+template <typename F, typename P>
+void render_progressive(film& film, const render_options& options, F&& fn, P&& onPass) {
+    std::vector<tile> tiles = make_tiles(film.dimensions(), tile_size_for(film.dimensions(), options));
+    std::vector<uint8_t> active(tiles.size(), 1);
+
+    int taken = 0;
+    while (taken < options.spp) {
+        int samples = taken == 0 ? (options.adaptive() ? std::min(options.min_spp, options.spp) : options.spp)
+                                 : std::min(options.pass_spp, options.spp - taken);
+
+        task_group group;
+        for (size_t i = 0; i < tiles.size(); i++) {
+            if (!active[i]) continue;
+            group.run([&, i] {
+                fn(tiles[i], samples);
+                active[i] = false;
+                for (int y = tiles[i].min.y; y < tiles[i].max.y && !active[i]; y++)
+                    for (int x = tiles[i].min.x; x < tiles[i].max.x && !active[i]; x++)
+                        active[i] = needs_samples(film, {x, y}, options);
+            });
+        }
+        group.wait();
+        taken += samples;
+        onPass(taken);
+    }
+}
+
+template <typename F>
+void render_progressive(film& film, const render_options& options, F&& fn) {
+    render_progressive(film, options, std::forward<F>(fn), [](int) {});
+}
\ No newline at end of file
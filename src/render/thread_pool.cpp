@@ -0,0 +1,106 @@
+#include "thread_pool.h"
+
+static thread_local const thread_pool* currentPool = nullptr;
+static thread_local int currentWorker = -1;
+
+thread_pool::thread_pool(int threads) {
+    if (threads <= 0) threads = int(std::max(1u, std::thread::hardware_concurrency()));
+
+    for (int i = 0; i < threads; i++)
+        queues.push_back(std::make_unique<work_queue>());
+    for (int i = 1; i < threads; i++)
+        workers.emplace_back(&thread_pool::worker_loop, this, i);
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+int thread_pool::worker_index() {
+    return currentWorker;
+}
+
+void thread_pool::submit(std::function<void()> task) {
+    int index = currentPool == this ? currentWorker : -1;
+    if (index < 0) index = int(nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size());
+
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    pending.fetch_add(1, std::memory_order_release);
+
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wake.notify_one();
+}
+
+bool thread_pool::pop(int index, std::function<void()>& task) {
+    if (pending.load(std::memory_order_acquire) == 0) return false;
+
+    if (index >= 0) {
+        work_queue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    int n = int(queues.size());
+    int start = index >= 0 ? index + 1 : int(nextQueue.load(std::memory_order_relaxed));
+    for (int i = 0; i < n; i++) {
+        work_queue& victim = *queues[(start + i) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool thread_pool::run_one() {
+    std::function<void()> task;
+    if (!pop(currentPool == this ? currentWorker : 0, task)) return false;
+    task();
+    return true;
+}
+
+void thread_pool::worker_loop(int index) {
+    currentPool = this;
+    currentWorker = index;
+
+    std::function<void()> task;
+    while (true) {
+        if (pop(index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || pending.load(std::memory_order_acquire) > 0; });
+        if (stopping) return;
+    }
+}
+
+static std::unique_ptr<thread_pool> globalPool;
+
+void init_thread_pool(int threads) {
+    globalPool = std::make_unique<thread_pool>(threads);
+}
+
+thread_pool& global_thread_pool() {
+    if (!globalPool) init_thread_pool(0);
+    return *globalPool;
+}
\ No newline at end of file
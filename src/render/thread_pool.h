@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool: every worker owns a deque, pops its own work LIFO and
+// steals FIFO from the others when it runs dry. Threads that wait on a
+// task_group help execute pending tasks, so a pool of N threads spawns N - 1
+// workers and the waiting thread is the N-th.
+class thread_pool {
+public:
+    explicit thread_pool(int threads = 0);
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    int size() const { return int(workers.size()) + 1; }
+
+    void submit(std::function<void()> task);
+    bool run_one();
+
+    static int worker_index();
+
+private:
+    struct work_queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<work_queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<int> pending{0};
+    std::atomic<uint32_t> nextQueue{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+
+    bool pop(int index, std::function<void()>& task);
+    void worker_loop(int index);
+};
+
+void init_thread_pool(int threads);
+thread_pool& global_thread_pool();
+
+class task_group {
+public:
+    explicit task_group(thread_pool& pool = global_thread_pool())
+        : pool(pool) {}
+    ~task_group() { wait(); }
+
+    template <typename F>
+    void run(F&& f) {
+        remaining.fetch_add(1, std::memory_order_relaxed);
+        pool.submit([this, f = std::forward<F>(f)]() mutable {
+            f();
+            remaining.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    void wait() {
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (!pool.run_one()) std::this_thread::yield();
+        }
+    }
+
+private:
+    thread_pool& pool;
+    std::atomic<int> remaining{0};
+};
+
+template <typename F>
+void parallel_for(int64_t begin, int64_t end, int64_t grain, F&& f) {
+    if (end - begin <= grain) {
+        for (int64_t i = begin; i < end; i++) f(i);
+        return;
+    }
+
+    task_group group;
+    for (int64_t chunk = begin; chunk < end; chunk += grain) {
+        int64_t chunkEnd = std::min(chunk + grain, end);
+        group.run([&f, chunk, chunkEnd] {
+            for (int64_t i = chunk; i < chunkEnd; i++) f(i);
+        });
+    }
+    group.wait();
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "blue_noise.h"
+
+#include <sampler/sobol.h>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr int tile_pixels = blue_noise_size * blue_noise_size;
+
+class void_and_cluster {
+public:
+    void_and_cluster()
+        : pattern(tile_pixels, false), energy(tile_pixels, 0.f) {
+        for (int dy = -radius; dy <= radius; dy++)
+            for (int dx = -radius; dx <= radius; dx++)
+                kernel[(dy + radius) * (2 * radius + 1) + dx + radius] = std::exp(-float(dx * dx + dy * dy) / (2.f * sigma * sigma));
+    }
+
+    void set(int i, bool value) {
+        if (pattern[i] == value) return;
+        pattern[i] = value;
+        float sign = value ? 1.f : -1.f;
+        int x = i % blue_noise_size, y = i / blue_noise_size;
+        for (int dy = -radius; dy <= radius; dy++) {
+            int row = (y + dy + blue_noise_size) % blue_noise_size * blue_noise_size;
+            for (int dx = -radius; dx <= radius; dx++)
+                energy[row + (x + dx + blue_noise_size) % blue_noise_size] += sign * kernel[(dy + radius) * (2 * radius + 1) + dx + radius];
+        }
+    }
+
+    int tightest_cluster() const {
+        int best = -1;
+        for (int i = 0; i < tile_pixels; i++)
+            if (pattern[i] && (best < 0 || energy[i] > energy[best])) best = i;
+        return best;
+    }
+
+    int largest_void() const {
+        int best = -1;
+        for (int i = 0; i < tile_pixels; i++)
+            if (!pattern[i] && (best < 0 || energy[i] < energy[best])) best = i;
+        return best;
+    }
+
+    std::vector<bool> pattern;
+    std::vector<float> energy;
+
+private:
+    static constexpr int radius = 6;
+    static constexpr float sigma = 1.5f;
+    float kernel[(2 * radius + 1) * (2 * radius + 1)];
+};
+
+std::vector<float> generate_blue_noise() {
+    void_and_cluster initial;
+    int ones = 0;
+    for (uint64_t i = 0; ones < tile_pixels / 10; i++) {
+        int p = int(mix_bits(i) % tile_pixels);
+        if (initial.pattern[p]) continue;
+        initial.set(p, true);
+        ones++;
+    }
+
+    // Spread the initial points by moving the tightest cluster into the
+    // largest void until that no longer changes anything.
+    for (int i = 0; i < tile_pixels; i++) {
+        int cluster = initial.tightest_cluster();
+        initial.set(cluster, false);
+        int hole = initial.largest_void();
+        initial.set(hole, true);
+        if (hole == cluster) break;
+    }
+
+    std::vector<int> rank(tile_pixels);
+
+    void_and_cluster removal = initial;
+    for (int r = ones - 1; r >= 0; r--) {
+        int cluster = removal.tightest_cluster();
+        removal.set(cluster, false);
+        rank[cluster] = r;
+    }
+
+    void_and_cluster insertion = initial;
+    for (int r = ones; r < tile_pixels; r++) {
+        int hole = insertion.largest_void();
+        insertion.set(hole, true);
+        rank[hole] = r;
+    }
+
+    std::vector<float> tile(tile_pixels);
+    for (int i = 0; i < tile_pixels; i++)
+        tile[i] = (float(rank[i]) + 0.5f) / float(tile_pixels);
+    return tile;
+}
+
+}
+
+std::span<const float> blue_noise_tile() {
+    static const std::vector<float> tile = generate_blue_noise();
+    return tile;
+}
+
+blue_noise_sampler::blue_noise_sampler(uint64_t seed)
+    : tile(blue_noise_tile()), seed(seed) {}
+
+float blue_noise_sampler::get_1d(vec2i pixel, uint32_t index, uint32_t dim) const {
+    uint64_t h = mix_bits(seed ^ (uint64_t(dim / 4) << 32));
+    uint32_t shuffled = owen_scramble(index, uint32_t(h));
+    float base = bits_to_float(owen_scramble(sobol_sample(shuffled, dim % 4), uint32_t(mix_bits(h ^ dim) >> 32)));
+
+    uint64_t offset = mix_bits(seed ^ dim);
+    int x = (pixel.x + int(offset & 63)) & (blue_noise_size - 1);
+    int y = (pixel.y + int((offset >> 8) & 63)) & (blue_noise_size - 1);
+    float v = base + tile[y * blue_noise_size + x];
+    return v >= 1.f ? v - 1.f : v;
+}
\ No newline at end of file
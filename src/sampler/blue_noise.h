@@ -0,0 +1,26 @@
+#pragma once
+
+#include <sampler/sampler.h>
+
+#include <span>
+
+inline constexpr int blue_noise_size = 64;
+
+// 64x64 tile of blue-noise ranks in [0, 1), generated once with Ulichney's
+// void-and-cluster method.
+std::span<const float> blue_noise_tile();
+
+// Scrambled Sobol points shared by all pixels and Cranley-Patterson
+// rotated per pixel by a blue-noise offset, so the error that remains at
+// low sample counts is pushed to high spatial frequencies. Each dimension
+// reads the tile at its own toroidal offset.
+class blue_noise_sampler : public sampler {
+public:
+    explicit blue_noise_sampler(uint64_t seed = 0);
+
+    float get_1d(vec2i pixel, uint32_t index, uint32_t dim) const override;
+
+private:
+    std::span<const float> tile;
+    uint64_t seed;
+};
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <math/vec.h>
+#include <util/hash.h>
+
+#include <cstdint>
+#include <span>
+
+// Dimensions every sampler consumer agrees on. Integrators draw their
+// own dimensions starting at integrator_dimension.
+inline constexpr uint32_t film_dimension = 0;
+inline constexpr uint32_t lens_dimension = 2;
+inline constexpr uint32_t time_dimension = 4;
+inline constexpr uint32_t integrator_dimension = 5;
+
+// Samplers are stateless: a sample is a pure function of the pixel, the
+// sample index within the pixel and the dimension, so any thread can
+// produce any sample without locks and the result never depends on the
+// order in which samples are drawn.
+class sampler {
+public:
+    virtual ~sampler() = default;
+
+    // Returns a value in [0, 1).
+    virtual float get_1d(vec2i pixel, uint32_t index, uint32_t dim) const = 0;
+
+    // Returns dimensions dim and dim + 1 as a point in [0, 1)^2.
+    virtual vec2f get_2d(vec2i pixel, uint32_t index, uint32_t dim) const {
+        return {get_1d(pixel, index, dim), get_1d(pixel, index, dim + 1)};
+    }
+
+    // Dimensions dim to dim + values.size() - 1, drawn in pairs by get_2d
+    // and an odd last one by get_1d; samplers override it to share work
+    // between dimensions of the same sample.
+    virtual void get_dimensions(vec2i pixel, uint32_t index, uint32_t dim, std::span<float> values) const {
+        size_t i = 0;
+        for (; i + 1 < values.size(); i += 2) {
+            vec2f u = get_2d(pixel, index, dim + uint32_t(i));
+            values[i] = u.x;
+            values[i + 1] = u.y;
+        }
+        if (i < values.size()) values[i] = get_1d(pixel, index, dim + uint32_t(i));
+    }
+};
+
+inline uint64_t hash_pixel(vec2i pixel, uint64_t seed) {
+    return mix_bits((uint64_t(uint32_t(pixel.y)) << 32 | uint32_t(pixel.x)) ^ mix_bits(seed));
+}
+
+inline float bits_to_float(uint32_t bits) {
+    return float(bits >> 8) * 0x1p-24f;
+}
+
+inline uint32_t reverse_bits(uint32_t v) {
+    v = (v << 16) | (v >> 16);
+    v = ((v & 0x00ff00ffu) << 8) | ((v & 0xff00ff00u) >> 8);
+    v = ((v & 0x0f0f0f0fu) << 4) | ((v & 0xf0f0f0f0u) >> 4);
+    v = ((v & 0x33333333u) << 2) | ((v & 0xccccccccu) >> 2);
+    v = ((v & 0x55555555u) << 1) | ((v & 0xaaaaaaaau) >> 1);
+    return v;
+}
+
+// Nested uniform (Owen) scrambling of the bits of v, keyed by seed. Uses
+// the hash-based formulation from Burley, "Practical Hash-based Owen
+// Scrambling" (JCGT 2020) with Vegdahl's improved constants.
+inline uint32_t owen_scramble(uint32_t v, uint32_t seed) {
+    v = reverse_bits(v);
+    v += seed;
+    v ^= v * 0x6c50b47cu;
+    v ^= v * 0xb82f1e52u;
+    v ^= v * 0xc7afe638u;
+    v ^= v * 0x8d22f6e6u;
+    return reverse_bits(v);
+}
+
+// Element i of a random permutation of [0, n) keyed by seed, without
+// storing the permutation (Kensler, "Correlated Multi-Jittered Sampling").
+inline uint32_t permutation_element(uint32_t i, uint32_t n, uint32_t seed) {
+    uint32_t w = n - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+    do {
+        i ^= seed;
+        i *= 0xe170893du;
+        i ^= seed >> 16;
+        i ^= (i & w) >> 4;
+        i ^= seed >> 8;
+        i *= 0x0929eb3fu;
+        i ^= seed >> 23;
+        i ^= (i & w) >> 1;
+        i *= 1 | seed >> 27;
+        i *= 0x6935fa69u;
+        i ^= (i & w) >> 11;
+        i *= 0x74dcb303u;
+        i ^= (i & w) >> 2;
+        i *= 0x9e501cc3u;
+        i ^= (i & w) >> 2;
+        i *= 0xc860a3dfu;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= n);
+    return (i + seed) % n;
+}
\ No newline at end of file
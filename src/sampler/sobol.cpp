@@ -0,0 +1,89 @@
+#include "sobol.h"
+
+#include <array>
+
+namespace {
+
+// Direction numbers from primitive polynomials of degree s with
+// coefficients a and initial values m (Joe and Kuo).
+constexpr std::array<uint32_t, 32> sobol_directions(int s, uint32_t a, std::array<uint32_t, 3> m) {
+    std::array<uint32_t, 32> v{};
+    for (int k = 0; k < 32; k++) {
+        if (k < s) {
+            v[k] = m[k] << (31 - k);
+            continue;
+        }
+        v[k] = v[k - s] ^ (v[k - s] >> s);
+        for (int j = 1; j < s; j++)
+            if ((a >> (s - 1 - j)) & 1) v[k] ^= v[k - j];
+    }
+    return v;
+}
+
+constexpr std::array<std::array<uint32_t, 32>, 4> directions = [] {
+    std::array<std::array<uint32_t, 32>, 4> d{};
+    for (int k = 0; k < 32; k++) d[0][k] = 1u << (31 - k);
+    d[1] = sobol_directions(1, 0, {1});
+    d[2] = sobol_directions(2, 1, {1, 3});
+    d[3] = sobol_directions(3, 1, {1, 3, 1});
+    return d;
+}();
+
+// The point is linear in the bits of the index, so it is the XOR of one
+// table entry per index byte: four lookups instead of a branch per bit.
+constexpr std::array<std::array<std::array<uint32_t, 256>, 4>, 4> byte_tables = [] {
+    std::array<std::array<std::array<uint32_t, 256>, 4>, 4> t{};
+    for (int dim = 0; dim < 4; dim++) {
+        for (int byte = 0; byte < 4; byte++) {
+            for (uint32_t b = 0; b < 256; b++) {
+                uint32_t v = 0;
+                for (int bit = 0; bit < 8; bit++)
+                    if ((b >> bit) & 1) v ^= directions[dim][8 * byte + bit];
+                t[dim][byte][b] = v;
+            }
+        }
+    }
+    return t;
+}();
+
+uint32_t scramble_seed(vec2i pixel, uint64_t seed, uint32_t group, uint32_t dim) {
+    return uint32_t(hash_pixel(pixel, seed ^ (uint64_t(group) << 8 | dim)) >> 32);
+}
+
+}
+
+uint32_t sobol_sample(uint32_t index, uint32_t dim) {
+    const auto& t = byte_tables[dim];
+    return t[0][index & 0xff] ^ t[1][(index >> 8) & 0xff] ^ t[2][(index >> 16) & 0xff] ^ t[3][index >> 24];
+}
+
+float sobol_sampler::get_1d(vec2i pixel, uint32_t index, uint32_t dim) const {
+    uint32_t group = dim / 4;
+    uint32_t shuffled = owen_scramble(index, scramble_seed(pixel, seed, group, 4));
+    return bits_to_float(owen_scramble(sobol_sample(shuffled, dim % 4), scramble_seed(pixel, seed, group, dim % 4)));
+}
+
+vec2f sobol_sampler::get_2d(vec2i pixel, uint32_t index, uint32_t dim) const {
+    // Dimension pairs that straddle a group boundary come from two
+    // independently shuffled groups.
+    if (dim % 4 == 3) return sampler::get_2d(pixel, index, dim);
+
+    uint32_t group = dim / 4;
+    uint32_t shuffled = owen_scramble(index, scramble_seed(pixel, seed, group, 4));
+    uint32_t x = owen_scramble(sobol_sample(shuffled, dim % 4), scramble_seed(pixel, seed, group, dim % 4));
+    uint32_t y = owen_scramble(sobol_sample(shuffled, dim % 4 + 1), scramble_seed(pixel, seed, group, dim % 4 + 1));
+    return {bits_to_float(x), bits_to_float(y)};
+}
+
+void sobol_sampler::get_dimensions(vec2i pixel, uint32_t index, uint32_t dim, std::span<float> values) const {
+    uint32_t group = ~0u, shuffled = 0;
+    for (size_t i = 0; i < values.size(); i++) {
+        uint32_t d = dim + uint32_t(i);
+        if (d / 4 != group) {
+            group = d / 4;
+            shuffled = owen_scramble(index, scramble_seed(pixel, seed, group, 4));
+        }
+        uint32_t bits = owen_scramble(sobol_sample(shuffled, d % 4), scramble_seed(pixel, seed, group, d % 4));
+        values[i] = bits_to_float(bits);
+    }
+}
\ No newline at end of file
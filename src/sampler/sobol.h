@@ -0,0 +1,25 @@
+#pragma once
+
+#include <sampler/sampler.h>
+
+// Point index of the first four Sobol dimensions, as 32-bit fixed point.
+uint32_t sobol_sample(uint32_t index, uint32_t dim);
+
+// Owen-scrambled Sobol sequence (Burley 2020). Dimensions are consumed in
+// groups of four; each group of each pixel shuffles the sample order and
+// scrambles every dimension with independent hashed seeds, which pads the
+// sequence to any number of dimensions. Stratification is best when the
+// samples per pixel are a power of two.
+class sobol_sampler : public sampler {
+public:
+    explicit sobol_sampler(uint64_t seed = 0)
+        : seed(seed) {}
+
+    float get_1d(vec2i pixel, uint32_t index, uint32_t dim) const override;
+    vec2f get_2d(vec2i pixel, uint32_t index, uint32_t dim) const override;
+    // Shuffles the index once per group of four rather than per dimension.
+    void get_dimensions(vec2i pixel, uint32_t index, uint32_t dim, std::span<float> values) const override;
+
+private:
+    uint64_t seed;
+};
\ No newline at end of file
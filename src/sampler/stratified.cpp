@@ -0,0 +1,29 @@
+#include "stratified.h"
+
+#include <algorithm>
+#include <cmath>
+
+stratified_sampler::stratified_sampler(int samplesPerPixel, uint64_t seed)
+    : samplesPerPixel(uint32_t(std::max(samplesPerPixel, 1))), seed(seed) {
+    gridX = uint32_t(std::ceil(std::sqrt(double(this->samplesPerPixel))));
+    gridY = (this->samplesPerPixel + gridX - 1) / gridX;
+}
+
+float stratified_sampler::get_1d(vec2i pixel, uint32_t index, uint32_t dim) const {
+    // Indices past samplesPerPixel start another permuted set of strata.
+    uint32_t round = index / samplesPerPixel;
+    uint64_t h = hash_pixel(pixel, seed ^ (uint64_t(dim) << 32 | round));
+    uint32_t stratum = permutation_element(index % samplesPerPixel, samplesPerPixel, uint32_t(h));
+    float jitter = bits_to_float(uint32_t(mix_bits(h ^ index) >> 32));
+    return std::min((float(stratum) + jitter) / float(samplesPerPixel), 0x1.fffffep-1f);
+}
+
+vec2f stratified_sampler::get_2d(vec2i pixel, uint32_t index, uint32_t dim) const {
+    uint32_t round = index / samplesPerPixel;
+    uint64_t h = hash_pixel(pixel, seed ^ (uint64_t(dim) << 32 | round));
+    uint32_t stratum = permutation_element(index % samplesPerPixel, gridX * gridY, uint32_t(h));
+    uint64_t jitter = mix_bits(h ^ index);
+    float x = (float(stratum % gridX) + bits_to_float(uint32_t(jitter))) / float(gridX);
+    float y = (float(stratum / gridX) + bits_to_float(uint32_t(jitter >> 32))) / float(gridY);
+    return {std::min(x, 0x1.fffffep-1f), std::min(y, 0x1.fffffep-1f)};
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <sampler/sampler.h>
+
+// Jittered stratification of each dimension into samples_per_pixel strata
+// (2D requests use a near-square grid). Every pixel and dimension gets its
+// own hashed permutation of the strata, which decorrelates dimensions
+// without storing any tables.
+class stratified_sampler : public sampler {
+public:
+    explicit stratified_sampler(int samplesPerPixel, uint64_t seed = 0);
+
+    float get_1d(vec2i pixel, uint32_t index, uint32_t dim) const override;
+    vec2f get_2d(vec2i pixel, uint32_t index, uint32_t dim) const override;
+
+private:
+    uint32_t samplesPerPixel;
+    uint32_t gridX, gridY;
+    uint64_t seed;
+};
\ No newline at end of file
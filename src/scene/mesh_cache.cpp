@@ -0,0 +1,212 @@
+#include "mesh_cache.h"
+
+#include <util/hash.h>
+#include <util/mapped_file.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+static constexpr char cache_magic[8] = {'R', 'N', 'D', 'R', 'M', 'S', 'H', '\0'};
+static constexpr uint64_t section_alignment = 64;
+
+enum mesh_section : uint32_t {
+    section_px, section_py, section_pz,
+    section_nx, section_ny, section_nz,
+    section_u, section_v,
+    section_indices,
+    section_bvh_nodes,
+    section_bvh_primitives,
+    section_count
+};
+
+namespace {
+
+struct cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t sections;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_hash;
+    uint64_t reserved[3];
+};
+
+struct cache_section {
+    uint32_t id;
+    uint32_t element_size;
+    uint64_t offset;
+    uint64_t count;
+};
+
+}
+
+static_assert(sizeof(cache_header) == 64);
+static_assert(sizeof(cache_section) == 24);
+
+template <typename T>
+static std::span<const std::byte> as_bytes_of(std::span<const T> s) {
+    return std::as_bytes(s);
+}
+
+bool write_mesh_cache(const std::string& path, const triangle_mesh& mesh, const mesh_source_stamp& source) {
+    const mesh_view& data = mesh.data();
+    struct section_data {
+        uint32_t elementSize;
+        std::span<const std::byte> bytes;
+    } sections[section_count] = {
+        {sizeof(float), as_bytes_of(data.px)}, {sizeof(float), as_bytes_of(data.py)},
+        {sizeof(float), as_bytes_of(data.pz)}, {sizeof(float), as_bytes_of(data.nx)},
+        {sizeof(float), as_bytes_of(data.ny)}, {sizeof(float), as_bytes_of(data.nz)},
+        {sizeof(float), as_bytes_of(data.u)}, {sizeof(float), as_bytes_of(data.v)},
+        {sizeof(uint32_t), as_bytes_of(data.indices)},
+        {sizeof(bvh_node), as_bytes_of(mesh.acceleration().node_span())},
+        {sizeof(uint32_t), as_bytes_of(mesh.acceleration().primitive_span())},
+    };
+
+    cache_header header{};
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = mesh_cache_version;
+    header.sections = section_count;
+    header.source_size = source.size;
+    header.source_mtime = source.mtime;
+    header.source_hash = source.hash;
+
+    cache_section table[section_count];
+    uint64_t offset = sizeof(header) + sizeof(table);
+    for (uint32_t i = 0; i < section_count; i++) {
+        offset = (offset + section_alignment - 1) / section_alignment * section_alignment;
+        table[i] = {i, sections[i].elementSize, offset, sections[i].bytes.size() / sections[i].elementSize};
+        offset += sections[i].bytes.size();
+    }
+
+    // Write next to the destination and rename, so a reader never maps a
+    // half-written cache.
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(table), sizeof(table));
+        uint64_t position = sizeof(header) + sizeof(table);
+        static const char padding[section_alignment] = {};
+        for (uint32_t i = 0; i < section_count; i++) {
+            out.write(padding, std::streamsize(table[i].offset - position));
+            out.write(reinterpret_cast<const char*>(sections[i].bytes.data()), std::streamsize(sections[i].bytes.size()));
+            position = table[i].offset + sections[i].bytes.size();
+        }
+        if (!out) return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+std::optional<mapped_mesh_cache> open_mesh_cache(const std::string& path) {
+    std::shared_ptr<const mapped_file> file = mapped_file::open(path);
+    if (!file || file->size() < sizeof(cache_header)) return {};
+
+    cache_header header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0) return {};
+    if (header.version != mesh_cache_version || header.sections != section_count) return {};
+    if (file->size() < sizeof(header) + section_count * sizeof(cache_section)) return {};
+
+    static constexpr uint32_t element_sizes[section_count] = {
+        sizeof(float), sizeof(float), sizeof(float), sizeof(float), sizeof(float), sizeof(float),
+        sizeof(float), sizeof(float), sizeof(uint32_t), sizeof(bvh_node), sizeof(uint32_t)};
+
+    std::span<const std::byte> sections[section_count];
+    for (uint32_t i = 0; i < section_count; i++) {
+        cache_section section;
+        std::memcpy(&section, file->data() + sizeof(header) + i * sizeof(section), sizeof(section));
+        if (section.id != i || section.element_size != element_sizes[i]) return {};
+        if (section.offset % section_alignment != 0) return {};
+        if (section.offset > file->size() || section.count > (file->size() - section.offset) / section.element_size)
+            return {};
+        sections[i] = file->bytes().subspan(section.offset, section.count * section.element_size);
+    }
+
+    auto floats = [&](mesh_section id) {
+        return std::span<const float>(reinterpret_cast<const float*>(sections[id].data()),
+                                      sections[id].size() / sizeof(float));
+    };
+    auto uints = [&](mesh_section id) {
+        return std::span<const uint32_t>(reinterpret_cast<const uint32_t*>(sections[id].data()),
+                                         sections[id].size() / sizeof(uint32_t));
+    };
+
+    mesh_view view{floats(section_px), floats(section_py), floats(section_pz),
+                   floats(section_nx), floats(section_ny), floats(section_nz),
+                   floats(section_u), floats(section_v),
+                   uints(section_indices)};
+    // Everything the mesh and its traversal index with must be in range; a
+    // truncated or corrupt cache is rejected and then rebuilt.
+    size_t vertices = view.vertex_count();
+    auto optional_attribute = [&](std::span<const float> a) { return a.empty() || a.size() == vertices; };
+    if (view.py.size() != vertices || view.pz.size() != vertices) return {};
+    if (!optional_attribute(view.nx) || view.ny.size() != view.nx.size() || view.nz.size() != view.nx.size()) return {};
+    if (!optional_attribute(view.u) || view.v.size() != view.u.size()) return {};
+    if (view.indices.size() % 3 != 0) return {};
+    uint32_t maxIndex = 0;
+    for (uint32_t index : view.indices)
+        maxIndex = std::max(maxIndex, index);
+    if (!view.indices.empty() && maxIndex >= vertices) return {};
+
+    std::span<const bvh_node> nodes(reinterpret_cast<const bvh_node*>(sections[section_bvh_nodes].data()),
+                                    sections[section_bvh_nodes].size() / sizeof(bvh_node));
+    std::span<const uint32_t> primitives = uints(section_bvh_primitives);
+    if (primitives.size() != view.triangle_count()) return {};
+    if (!bvh::well_formed(nodes, primitives, view.triangle_count())) return {};
+
+    mapped_mesh_cache cache;
+    cache.mesh = std::make_shared<triangle_mesh>(view, file, bvh(nodes, primitives, file));
+    cache.source = {header.source_size, header.source_mtime, header.source_hash};
+    return cache;
+}
+
+// Brings the recorded source mtime up to date once the content hash has
+// shown the source unchanged, so later loads skip hashing again.
+static bool update_source_mtime(const std::string& path, int64_t mtime) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file) return false;
+    file.seekp(offsetof(cache_header, source_mtime));
+    file.write(reinterpret_cast<const char*>(&mtime), sizeof(mtime));
+    return bool(file);
+}
+
+static uint64_t hash_file(const std::string& path) {
+    std::shared_ptr<const mapped_file> file = mapped_file::open(path);
+    return file ? hash_bytes(file->bytes()) : 0;
+}
+
+std::shared_ptr<triangle_mesh> load_mesh(const std::string& path, mesh_load_stats* stats) {
+    std::string cachePath = path + ".rmesh";
+    std::optional<file_stamp> stamp = stamp_file(path);
+    std::optional<mapped_mesh_cache> cache = open_mesh_cache(cachePath);
+
+    if (cache && !stamp) return cache->mesh;
+    if (!stamp) return nullptr;
+
+    uint64_t hash = 0;
+    if (cache && cache->source.size == stamp->size) {
+        if (cache->source.mtime == stamp->mtime) return cache->mesh;
+        hash = hash_file(path);
+        if (cache->source.hash == hash) {
+            update_source_mtime(cachePath, stamp->mtime);
+            return cache->mesh;
+        }
+    }
+
+    std::optional<mesh_buffers> buffers = import_mesh(path, stats);
+    if (!buffers) return nullptr;
+    if (!hash) hash = hash_file(path);
+
+    auto mesh = std::make_shared<triangle_mesh>(std::move(*buffers));
+    write_mesh_cache(cachePath, *mesh, {stamp->size, stamp->mtime, hash});
+    return mesh;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <shape/triangle_mesh.h>
+#include <scene/mesh_import.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+// Binary mesh cache ("<source>.rmesh"): a 64-byte header, a section table
+// and one 64-byte aligned section per array of the mesh and of its BVH, all
+// in native little-endian layout. Opening a cache maps the file and points
+// the mesh straight at the sections, with no parsing or per-primitive work.
+//
+// The header records the size, modification time and content hash of the
+// source it was imported from. The version must be bumped whenever the
+// layout of a section (including bvh_node) changes.
+constexpr uint32_t mesh_cache_version = 1;
+
+struct mesh_source_stamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t hash = 0;
+};
+
+bool write_mesh_cache(const std::string& path, const triangle_mesh& mesh, const mesh_source_stamp& source);
+
+struct mapped_mesh_cache {
+    std::shared_ptr<triangle_mesh> mesh;
+    mesh_source_stamp source;
+};
+
+std::optional<mapped_mesh_cache> open_mesh_cache(const std::string& path);
+
+// Loads an OBJ or PLY file through its cache: a cache whose source stamp
+// (or, after a touch, content hash) still matches is mapped directly; a
+// missing or stale one is rebuilt from the source and rewritten. stats is
+// only filled in when the source had to be imported.
+std::shared_ptr<triangle_mesh> load_mesh(const std::string& path, mesh_load_stats* stats = nullptr);
\ No newline at end of file
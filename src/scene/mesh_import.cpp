@@ -0,0 +1,15 @@
+#include "mesh_import.h"
+
+#include <scene/obj.h>
+#include <scene/ply.h>
+
+#include <cctype>
+#include <filesystem>
+
+std::optional<mesh_buffers> import_mesh(const std::string& path, mesh_load_stats* stats) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    for (char& c : extension) c = char(std::tolower(c));
+    if (extension == ".obj") return load_obj(path, stats);
+    if (extension == ".ply") return load_ply(path, stats);
+    return {};
+}
\ No newline at end of file
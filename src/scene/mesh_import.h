@@ -0,0 +1,24 @@
+#pragma once
+
+#include <shape/triangle_mesh.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+struct mesh_load_stats {
+    uint64_t bytes = 0;
+    double seconds = 0;
+    // Vertices duplicated because corners sharing a position differ in
+    // normal or UV.
+    uint64_t seam_vertices = 0;
+    // Normals or UVs given for only some face corners, and so discarded.
+    bool dropped_attributes = false;
+
+    double bytes_per_second() const {
+        return seconds > 0 ? double(bytes) / seconds : 0;
+    }
+};
+
+// Dispatches on the file extension (.obj, .ply).
+std::optional<mesh_buffers> import_mesh(const std::string& path, mesh_load_stats* stats = nullptr);
\ No newline at end of file
@@ -0,0 +1,337 @@
+#include "obj.h"
+
+#include <render/thread_pool.h>
+#include <util/hash.h>
+#include <util/mapped_file.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <unordered_map>
+
+static constexpr size_t obj_chunk_size = 8 << 20;
+static constexpr uint32_t no_attribute = UINT32_MAX;
+
+struct obj_chunk {
+    size_t begin = 0, end = 0;
+    uint64_t vertices = 0, normals = 0, uvs = 0, triangles = 0;
+    uint64_t vertexOffset = 0, normalOffset = 0, uvOffset = 0, triangleOffset = 0;
+    // Whether every face corner has a normal (UV), and whether it is the
+    // one its position index names.
+    bool normalsComplete = true, uvsComplete = true;
+    bool normalsMatch = true, uvsMatch = true;
+    bool valid = true;
+};
+
+struct obj_totals {
+    uint64_t vertices = 0, normals = 0, uvs = 0, triangles = 0;
+};
+
+// Normal and UV records as they appear in the file, indexed separately
+// from positions.
+struct obj_attributes {
+    std::vector<float> nx, ny, nz;
+    std::vector<float> u, v;
+};
+
+// Normal and UV index of every triangle corner, for meshes whose faces
+// index attributes differently from positions.
+struct obj_corners {
+    std::vector<uint32_t> normals, uvs;
+};
+
+// count tallies records, fill writes them at the chunk's offsets into the
+// final arrays, corners records the attribute indices of face corners.
+enum class obj_pass {
+    count,
+    fill,
+    corners
+};
+
+static const char* skip_spaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+static const char* parse_float(const char* p, const char* end, float& value) {
+    p = skip_spaces(p, end);
+    auto [next, error] = std::from_chars(p, end, value);
+    if (error != std::errc()) value = 0;
+    return next;
+}
+
+static const char* parse_index(const char* p, const char* end, int64_t& value) {
+    auto [next, error] = std::from_chars(p, end, value);
+    if (error != std::errc()) value = 0;
+    return next;
+}
+
+// Positive indices are absolute, negative ones count back from the
+// records defined so far.
+static bool resolve_index(int64_t index, uint64_t definedSoFar, uint64_t total, uint64_t& resolved) {
+    if (index > 0 && uint64_t(index) <= total) resolved = uint64_t(index - 1);
+    else if (index < 0 && uint64_t(-index) <= definedSoFar) resolved = definedSoFar - uint64_t(-index);
+    else return false;
+    return true;
+}
+
+template <obj_pass pass>
+static void parse_chunk(const char* text, obj_chunk& chunk, const obj_totals& totals, mesh_buffers* mesh,
+                        obj_attributes* attributes, obj_corners* corners) {
+    const char* p = text + chunk.begin;
+    const char* end = text + chunk.end;
+    uint64_t vertices = 0, normals = 0, uvs = 0, triangles = 0;
+
+    while (p < end) {
+        const char* lineEnd = p;
+        while (lineEnd < end && *lineEnd != '\n') lineEnd++;
+        p = skip_spaces(p, lineEnd);
+
+        if (lineEnd - p > 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            if constexpr (pass == obj_pass::fill) {
+                uint64_t i = chunk.vertexOffset + vertices;
+                p = parse_float(p + 2, lineEnd, mesh->px[i]);
+                p = parse_float(p, lineEnd, mesh->py[i]);
+                parse_float(p, lineEnd, mesh->pz[i]);
+            }
+            vertices++;
+        } else if (lineEnd - p > 3 && p[0] == 'v' && p[1] == 'n') {
+            if constexpr (pass == obj_pass::fill) {
+                uint64_t i = chunk.normalOffset + normals;
+                p = parse_float(p + 3, lineEnd, attributes->nx[i]);
+                p = parse_float(p, lineEnd, attributes->ny[i]);
+                parse_float(p, lineEnd, attributes->nz[i]);
+            }
+            normals++;
+        } else if (lineEnd - p > 3 && p[0] == 'v' && p[1] == 't') {
+            if constexpr (pass == obj_pass::fill) {
+                uint64_t i = chunk.uvOffset + uvs;
+                p = parse_float(p + 3, lineEnd, attributes->u[i]);
+                parse_float(p, lineEnd, attributes->v[i]);
+            }
+            uvs++;
+        } else if (lineEnd - p > 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            int cornerCount = 0;
+            uint32_t first[3] = {}, previous[3] = {};
+            p += 2;
+            while (true) {
+                p = skip_spaces(p, lineEnd);
+                if (p >= lineEnd || *p == '\r' || *p == '#') break;
+
+                int64_t v = 0, vt = 0, vn = 0;
+                p = parse_index(p, lineEnd, v);
+                if (p < lineEnd && *p == '/') {
+                    if (++p < lineEnd && *p != '/') p = parse_index(p, lineEnd, vt);
+                    if (p < lineEnd && *p == '/') p = parse_index(p + 1, lineEnd, vn);
+                }
+                while (p < lineEnd && *p != ' ' && *p != '\t' && *p != '\r') p++;
+
+                if constexpr (pass == obj_pass::count) {
+                    if (cornerCount >= 2) triangles++;
+                    cornerCount++;
+                    continue;
+                }
+
+                // Position, UV and normal index of the corner.
+                uint32_t corner[3] = {0, no_attribute, no_attribute};
+                uint64_t resolved;
+                if (resolve_index(v, chunk.vertexOffset + vertices, totals.vertices, resolved))
+                    corner[0] = uint32_t(resolved);
+                else chunk.valid = false;
+                if (vt && resolve_index(vt, chunk.uvOffset + uvs, totals.uvs, resolved)) corner[1] = uint32_t(resolved);
+                if (vn && resolve_index(vn, chunk.normalOffset + normals, totals.normals, resolved))
+                    corner[2] = uint32_t(resolved);
+
+                if constexpr (pass == obj_pass::fill) {
+                    chunk.uvsComplete &= corner[1] != no_attribute;
+                    chunk.uvsMatch &= corner[1] == corner[0];
+                    chunk.normalsComplete &= corner[2] != no_attribute;
+                    chunk.normalsMatch &= corner[2] == corner[0];
+                }
+
+                if (cornerCount == 0) std::copy_n(corner, 3, first);
+                if (cornerCount >= 2) {
+                    size_t i = 3 * (chunk.triangleOffset + triangles);
+                    if constexpr (pass == obj_pass::fill) {
+                        mesh->indices[i] = first[0];
+                        mesh->indices[i + 1] = previous[0];
+                        mesh->indices[i + 2] = corner[0];
+                    } else {
+                        corners->uvs[i] = first[1];
+                        corners->uvs[i + 1] = previous[1];
+                        corners->uvs[i + 2] = corner[1];
+                        corners->normals[i] = first[2];
+                        corners->normals[i + 1] = previous[2];
+                        corners->normals[i + 2] = corner[2];
+                    }
+                    triangles++;
+                }
+                std::copy_n(corner, 3, previous);
+                cornerCount++;
+            }
+        }
+
+        p = lineEnd + 1;
+    }
+
+    if constexpr (pass == obj_pass::count) {
+        chunk.vertices = vertices;
+        chunk.normals = normals;
+        chunk.uvs = uvs;
+        chunk.triangles = triangles;
+    }
+}
+
+struct obj_corner_key {
+    uint32_t position, uv, normal;
+    bool operator==(const obj_corner_key&) const = default;
+};
+
+struct obj_corner_hash {
+    size_t operator()(const obj_corner_key& k) const {
+        return size_t(mix_bits((uint64_t(k.position) << 32 | k.uv) ^ mix_bits(k.normal)));
+    }
+};
+
+// Gives every distinct (position, UV, normal) combination its own vertex,
+// as the single index buffer requires, and rewrites the indices to them.
+// Vertices no face uses are dropped. Returns how many vertices were added
+// along attribute seams.
+static uint64_t split_vertices(mesh_buffers& mesh, const obj_attributes& attributes, const obj_corners& corners,
+                               bool keepNormals, bool keepUvs) {
+    mesh_buffers split;
+    std::unordered_map<obj_corner_key, uint32_t, obj_corner_hash> vertices;
+    vertices.reserve(mesh.px.size());
+    std::vector<bool> used(mesh.px.size());
+    uint64_t seams = 0;
+
+    split.indices.resize(mesh.indices.size());
+    for (size_t i = 0; i < mesh.indices.size(); i++) {
+        obj_corner_key key{mesh.indices[i], keepUvs ? corners.uvs[i] : no_attribute,
+                           keepNormals ? corners.normals[i] : no_attribute};
+        auto [entry, added] = vertices.try_emplace(key, uint32_t(split.px.size()));
+        if (added) {
+            seams += used[key.position];
+            used[key.position] = true;
+            split.px.push_back(mesh.px[key.position]);
+            split.py.push_back(mesh.py[key.position]);
+            split.pz.push_back(mesh.pz[key.position]);
+            if (keepNormals) {
+                split.nx.push_back(attributes.nx[key.normal]);
+                split.ny.push_back(attributes.ny[key.normal]);
+                split.nz.push_back(attributes.nz[key.normal]);
+            }
+            if (keepUvs) {
+                split.u.push_back(attributes.u[key.uv]);
+                split.v.push_back(attributes.v[key.uv]);
+            }
+        }
+        split.indices[i] = entry->second;
+    }
+    mesh = std::move(split);
+    return seams;
+}
+
+std::optional<mesh_buffers> load_obj(const std::string& path, mesh_load_stats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<const mapped_file> file = mapped_file::open(path);
+    if (!file) return {};
+
+    const char* text = reinterpret_cast<const char*>(file->data());
+    size_t size = file->size();
+
+    std::vector<obj_chunk> chunks;
+    for (size_t begin = 0; begin < size;) {
+        size_t end = std::min(begin + obj_chunk_size, size);
+        while (end < size && text[end - 1] != '\n') end++;
+        obj_chunk chunk;
+        chunk.begin = begin;
+        chunk.end = end;
+        chunks.push_back(chunk);
+        begin = end;
+    }
+
+    obj_totals totals;
+    auto run_pass = [&](auto parse) {
+        parallel_for(0, int64_t(chunks.size()), 1, [&](int64_t c) {
+            parse(chunks[c]);
+            file->evict(chunks[c].begin, chunks[c].end - chunks[c].begin);
+        });
+    };
+    run_pass([&](obj_chunk& chunk) { parse_chunk<obj_pass::count>(text, chunk, totals, nullptr, nullptr, nullptr); });
+
+    for (obj_chunk& chunk : chunks) {
+        chunk.vertexOffset = totals.vertices;
+        chunk.normalOffset = totals.normals;
+        chunk.uvOffset = totals.uvs;
+        chunk.triangleOffset = totals.triangles;
+        totals.vertices += chunk.vertices;
+        totals.normals += chunk.normals;
+        totals.uvs += chunk.uvs;
+        totals.triangles += chunk.triangles;
+    }
+    if (totals.vertices > UINT32_MAX || totals.normals > UINT32_MAX || totals.uvs > UINT32_MAX ||
+        totals.triangles * 3 > UINT32_MAX)
+        return {};
+
+    mesh_buffers mesh;
+    mesh.px.resize(totals.vertices);
+    mesh.py.resize(totals.vertices);
+    mesh.pz.resize(totals.vertices);
+    mesh.indices.resize(totals.triangles * 3);
+    obj_attributes attributes;
+    attributes.nx.resize(totals.normals);
+    attributes.ny.resize(totals.normals);
+    attributes.nz.resize(totals.normals);
+    attributes.u.resize(totals.uvs);
+    attributes.v.resize(totals.uvs);
+
+    run_pass([&](obj_chunk& chunk) { parse_chunk<obj_pass::fill>(text, chunk, totals, &mesh, &attributes, nullptr); });
+
+    // An attribute is kept when every corner has one. When every corner's
+    // attribute index is also its position index, the records line up with
+    // the vertices as they are; otherwise vertices are split.
+    bool normalsComplete = totals.normals > 0, uvsComplete = totals.uvs > 0;
+    bool normalsMatch = true, uvsMatch = true;
+    for (const obj_chunk& chunk : chunks) {
+        if (!chunk.valid) return {};
+        normalsComplete &= chunk.normalsComplete;
+        uvsComplete &= chunk.uvsComplete;
+        normalsMatch &= chunk.normalsMatch;
+        uvsMatch &= chunk.uvsMatch;
+    }
+
+    if ((normalsComplete && !normalsMatch) || (uvsComplete && !uvsMatch)) {
+        obj_corners corners;
+        corners.normals.resize(mesh.indices.size());
+        corners.uvs.resize(mesh.indices.size());
+        run_pass([&](obj_chunk& chunk) {
+            parse_chunk<obj_pass::corners>(text, chunk, totals, nullptr, nullptr, &corners);
+        });
+        uint64_t seams = split_vertices(mesh, attributes, corners, normalsComplete, uvsComplete);
+        if (stats) stats->seam_vertices = seams;
+    } else {
+        // Attribute i belongs to vertex i; pad or trim to the vertex count.
+        if (normalsComplete) {
+            mesh.nx = std::move(attributes.nx);
+            mesh.ny = std::move(attributes.ny);
+            mesh.nz = std::move(attributes.nz);
+            mesh.nx.resize(totals.vertices);
+            mesh.ny.resize(totals.vertices);
+            mesh.nz.resize(totals.vertices);
+        }
+        if (uvsComplete) {
+            mesh.u = std::move(attributes.u);
+            mesh.v = std::move(attributes.v);
+            mesh.u.resize(totals.vertices);
+            mesh.v.resize(totals.vertices);
+        }
+    }
+
+    if (stats) {
+        stats->bytes = size;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stats->dropped_attributes = (totals.normals > 0 && !normalsComplete) || (totals.uvs > 0 && !uvsComplete);
+    }
+    return mesh;
+}
\ No newline at end of file
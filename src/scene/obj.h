@@ -0,0 +1,20 @@
+#pragma once
+
+#include <scene/mesh_import.h>
+
+#include <optional>
+#include <string>
+
+// Wavefront OBJ: v/vt/vn/f records, polygons are fan-triangulated. Meshes
+// share one index buffer across attributes, so when faces index normals or
+// UVs differently from positions (UV seams, hard edges) a third pass reads
+// every corner's indices and vertices are split on distinct (v, vt, vn)
+// triples; that step runs on one thread. A normal or UV set is dropped when
+// some corner lacks it, which mesh_load_stats reports.
+//
+// The file is mapped and split into line-aligned chunks that are parsed in
+// parallel twice: once to count records, then, after a prefix sum, straight
+// into the final arrays. Nothing is staged in between, and parsed chunks
+// are dropped from the mapping, so peak memory stays at the size of the
+// resulting mesh.
+std::optional<mesh_buffers> load_obj(const std::string& path, mesh_load_stats* stats = nullptr);
\ No newline at end of file
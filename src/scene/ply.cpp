@@ -0,0 +1,265 @@
+#include "ply.h"
+
+#include <render/thread_pool.h>
+#include <util/mapped_file.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+static constexpr size_t ply_vertex_grain = 1 << 16;
+static constexpr size_t ply_face_grain = 1 << 16;
+
+enum class ply_type { int8, uint8, int16, uint16, int32, uint32, float32, float64, invalid };
+
+static ply_type parse_type(const std::string& name) {
+    if (name == "char" || name == "int8") return ply_type::int8;
+    if (name == "uchar" || name == "uint8") return ply_type::uint8;
+    if (name == "short" || name == "int16") return ply_type::int16;
+    if (name == "ushort" || name == "uint16") return ply_type::uint16;
+    if (name == "int" || name == "int32") return ply_type::int32;
+    if (name == "uint" || name == "uint32") return ply_type::uint32;
+    if (name == "float" || name == "float32") return ply_type::float32;
+    if (name == "double" || name == "float64") return ply_type::float64;
+    return ply_type::invalid;
+}
+
+static int type_size(ply_type type) {
+    switch (type) {
+        case ply_type::int8:
+        case ply_type::uint8: return 1;
+        case ply_type::int16:
+        case ply_type::uint16: return 2;
+        case ply_type::int32:
+        case ply_type::uint32:
+        case ply_type::float32: return 4;
+        case ply_type::float64: return 8;
+        default: return 0;
+    }
+}
+
+template <typename T>
+static T read_as(const std::byte* p, bool swap) {
+    std::byte bytes[sizeof(T)];
+    std::memcpy(bytes, p, sizeof(T));
+    if (swap) std::reverse(bytes, bytes + sizeof(T));
+    T t;
+    std::memcpy(&t, bytes, sizeof(T));
+    return t;
+}
+
+static double read_value(ply_type type, const std::byte* p, bool swap) {
+    switch (type) {
+        case ply_type::int8: return read_as<int8_t>(p, swap);
+        case ply_type::uint8: return read_as<uint8_t>(p, swap);
+        case ply_type::int16: return read_as<int16_t>(p, swap);
+        case ply_type::uint16: return read_as<uint16_t>(p, swap);
+        case ply_type::int32: return read_as<int32_t>(p, swap);
+        case ply_type::uint32: return read_as<uint32_t>(p, swap);
+        case ply_type::float32: return read_as<float>(p, swap);
+        case ply_type::float64: return read_as<double>(p, swap);
+        default: return 0;
+    }
+}
+
+struct ply_property {
+    std::string name;
+    ply_type type = ply_type::invalid;
+    ply_type countType = ply_type::invalid;
+    bool list = false;
+};
+
+struct ply_element {
+    std::string name;
+    size_t count = 0;
+    std::vector<ply_property> properties;
+};
+
+// Byte offset and first triangle of every ply_face_grain-th face, found by
+// one sequential walk over the face counts.
+struct ply_face_chunk {
+    size_t offset;
+    size_t faces;
+    uint64_t triangleOffset;
+};
+
+std::optional<mesh_buffers> load_ply(const std::string& path, mesh_load_stats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<const mapped_file> file = mapped_file::open(path);
+    if (!file) return {};
+
+    const char* text = reinterpret_cast<const char*>(file->data());
+    const char* headerEnd = nullptr;
+    for (size_t i = 0; i + 10 <= file->size() && i < (1 << 16); i++) {
+        if (!std::memcmp(text + i, "end_header", 10)) {
+            headerEnd = text + i + 10;
+            break;
+        }
+    }
+    if (!headerEnd) return {};
+    while (headerEnd < text + file->size() && *headerEnd != '\n') headerEnd++;
+    headerEnd++;
+
+    std::istringstream header(std::string(text, headerEnd));
+    std::string line, keyword;
+    std::vector<ply_element> elements;
+    std::string format;
+    while (std::getline(header, line)) {
+        std::istringstream tokens(line);
+        tokens >> keyword;
+        if (keyword == "format") {
+            tokens >> format;
+        } else if (keyword == "element") {
+            ply_element element;
+            tokens >> element.name >> element.count;
+            elements.push_back(element);
+        } else if (keyword == "property" && !elements.empty()) {
+            ply_property property;
+            std::string type;
+            tokens >> type;
+            if (type == "list") {
+                std::string countType, valueType;
+                tokens >> countType >> valueType;
+                property.list = true;
+                property.countType = parse_type(countType);
+                property.type = parse_type(valueType);
+            } else {
+                property.type = parse_type(type);
+            }
+            tokens >> property.name;
+            if (property.type == ply_type::invalid || (property.list && property.countType == ply_type::invalid))
+                return {};
+            elements.back().properties.push_back(property);
+        }
+    }
+
+    bool swap;
+    if (format == "binary_little_endian") swap = std::endian::native != std::endian::little;
+    else if (format == "binary_big_endian") swap = std::endian::native != std::endian::big;
+    else return {};
+
+    mesh_buffers mesh;
+    const std::byte* p = file->data() + (headerEnd - text);
+    const std::byte* end = file->data() + file->size();
+
+    for (const ply_element& element : elements) {
+        if (element.name == "vertex") {
+            int stride = 0;
+            int offsets[8];
+            ply_type types[8];
+            std::fill(std::begin(offsets), std::end(offsets), -1);
+            for (const ply_property& property : element.properties) {
+                if (property.list) return {};
+                static const char* names[8][2] = {{"x", "x"}, {"y", "y"}, {"z", "z"},
+                                                  {"nx", "nx"}, {"ny", "ny"}, {"nz", "nz"},
+                                                  {"u", "s"}, {"v", "t"}};
+                for (int i = 0; i < 8; i++) {
+                    if (property.name == names[i][0] || property.name == names[i][1]) {
+                        offsets[i] = stride;
+                        types[i] = property.type;
+                    }
+                }
+                stride += type_size(property.type);
+            }
+            if (offsets[0] < 0 || offsets[1] < 0 || offsets[2] < 0) return {};
+            if (size_t(end - p) / stride < element.count || element.count > UINT32_MAX) return {};
+
+            bool normals = offsets[3] >= 0 && offsets[4] >= 0 && offsets[5] >= 0;
+            bool uvs = offsets[6] >= 0 && offsets[7] >= 0;
+            std::vector<float>* targets[8] = {&mesh.px, &mesh.py, &mesh.pz, &mesh.nx, &mesh.ny, &mesh.nz,
+                                              &mesh.u, &mesh.v};
+            bool used[8];
+            for (int i = 0; i < 8; i++) {
+                used[i] = i < 3 || (i < 6 && normals) || (i >= 6 && uvs);
+                if (used[i]) targets[i]->resize(element.count);
+            }
+
+            const std::byte* vertices = p;
+            int64_t chunks = int64_t((element.count + ply_vertex_grain - 1) / ply_vertex_grain);
+            parallel_for(0, chunks, 1, [&](int64_t c) {
+                size_t first = size_t(c) * ply_vertex_grain;
+                size_t last = std::min(element.count, first + ply_vertex_grain);
+                for (int i = 0; i < 8; i++) {
+                    if (!used[i]) continue;
+                    float* out = targets[i]->data();
+                    for (size_t v = first; v < last; v++)
+                        out[v] = float(read_value(types[i], vertices + v * stride + offsets[i], swap));
+                }
+                file->evict(size_t(vertices - file->data()) + first * stride, (last - first) * stride);
+            });
+            p += element.count * stride;
+            continue;
+        }
+
+        bool faces = element.name == "face";
+        int listProperty = -1;
+        size_t fixedBefore = 0, fixedAfter = 0;
+        for (size_t i = 0; i < element.properties.size(); i++) {
+            const ply_property& property = element.properties[i];
+            bool indices = faces && property.list &&
+                           (property.name == "vertex_indices" || property.name == "vertex_index");
+            if (indices && listProperty < 0) listProperty = int(i);
+            else if (property.list) return {};
+            else (listProperty < 0 ? fixedBefore : fixedAfter) += type_size(property.type);
+        }
+
+        if (listProperty < 0) {
+            size_t stride = fixedBefore;
+            if (size_t(end - p) / std::max<size_t>(stride, 1) < element.count) return {};
+            p += element.count * stride;
+            continue;
+        }
+
+        const ply_property& list = element.properties[listProperty];
+        int countSize = type_size(list.countType), indexSize = type_size(list.type);
+
+        std::vector<ply_face_chunk> chunks;
+        uint64_t triangles = 0;
+        for (size_t f = 0; f < element.count; f++) {
+            if (f % ply_face_grain == 0) chunks.push_back({size_t(p - file->data()), 0, triangles});
+            chunks.back().faces++;
+            if (size_t(end - p) < fixedBefore + countSize) return {};
+            size_t count = size_t(read_value(list.countType, p + fixedBefore, swap));
+            p += fixedBefore + countSize + count * indexSize + fixedAfter;
+            if (p > end) return {};
+            if (count >= 3) triangles += count - 2;
+        }
+        if (triangles * 3 > UINT32_MAX) return {};
+
+        mesh.indices.resize(triangles * 3);
+        parallel_for(0, int64_t(chunks.size()), 1, [&](int64_t c) {
+            const std::byte* q = file->data() + chunks[c].offset;
+            uint32_t* out = mesh.indices.data() + 3 * chunks[c].triangleOffset;
+            for (size_t f = 0; f < chunks[c].faces; f++) {
+                size_t count = size_t(read_value(list.countType, q + fixedBefore, swap));
+                const std::byte* indices = q + fixedBefore + countSize;
+                uint32_t first = uint32_t(read_value(list.type, indices, swap));
+                for (size_t i = 2; i < count; i++) {
+                    *out++ = first;
+                    *out++ = uint32_t(read_value(list.type, indices + (i - 1) * indexSize, swap));
+                    *out++ = uint32_t(read_value(list.type, indices + i * indexSize, swap));
+                }
+                q += fixedBefore + countSize + count * indexSize + fixedAfter;
+            }
+            file->evict(chunks[c].offset, size_t(q - file->data()) - chunks[c].offset);
+        });
+    }
+
+    size_t vertexCount = mesh.px.size();
+    std::atomic<bool> valid = true;
+    parallel_for(0, int64_t((mesh.indices.size() + ply_face_grain - 1) / ply_face_grain), 1, [&](int64_t c) {
+        size_t last = std::min(mesh.indices.size(), size_t(c + 1) * ply_face_grain);
+        for (size_t i = size_t(c) * ply_face_grain; i < last; i++)
+            if (mesh.indices[i] >= vertexCount) valid = false;
+    });
+    if (!valid) return {};
+
+    if (stats) {
+        stats->bytes = file->size();
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return mesh;
+}
\ No newline at end of file
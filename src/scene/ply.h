@@ -0,0 +1,12 @@
+#pragma once
+
+#include <scene/mesh_import.h>
+
+#include <optional>
+#include <string>
+
+// Binary PLY (either byte order) with a vertex element (x/y/z, optional
+// nx/ny/nz and u/v or s/t) and a face element holding an index list.
+// Vertices are converted in parallel ranges; faces are indexed in one
+// sequential pass over their counts and then converted in parallel.
+std::optional<mesh_buffers> load_ply(const std::string& path, mesh_load_stats* stats = nullptr);
\ No newline at end of file
@@ -0,0 +1,30 @@
+#include "scene.h"
+
+#include <shape/triangle_mesh.h>
+
+std::optional<light_sample> scene::sample_light(uint32_t index, vec3f p, vec2f u) const {
+    if (index < distant_lights.size()) return distant_lights[index].sample();
+    index -= uint32_t(distant_lights.size());
+    if (index < point_lights.size()) return point_lights[index].sample(p);
+    index -= uint32_t(point_lights.size());
+    return area_lights[index].sample(p, u);
+}
+
+bool add_area_lights(scene& scene, instance& emitter) {
+    auto mesh = std::dynamic_pointer_cast<const triangle_mesh>(emitter.get_prototype());
+    const material& m = scene.materials[emitter.get_material()];
+    if (!mesh || !m.is_emissive()) return false;
+
+    const mesh_view& data = mesh->data();
+    const transform& t = emitter.get_transform();
+    emitter.set_lights(uint32_t(scene.area_lights.size()));
+    for (size_t i = 0; i < data.triangle_count(); i++) {
+        vec3f p[3];
+        for (int k = 0; k < 3; k++) {
+            uint32_t index = data.indices[3 * i + k];
+            p[k] = t.apply(vec3f(data.px[index], data.py[index], data.pz[index]));
+        }
+        scene.area_lights.push_back({p[0], p[1], p[2], m.emission});
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <shape/shape.h>
+#include <shape/instance.h>
+#include <material/material.h>
+#include <light/light.h>
+#include <light/light_sampler.h>
+#include <texture/image_texture.h>
+
+#include <memory>
+#include <vector>
+
+// Everything an integrator needs: geometry, what its hits are made of and
+// what lights them. Rays that leave the scene see a uniform sky.
+//
+// Lights are numbered across the lists in order: distant, point, then
+// area lights.
+struct scene {
+    std::shared_ptr<const shape> geometry;
+    std::vector<material> materials = {material{}};
+    std::vector<std::shared_ptr<const image_texture>> textures;
+    std::vector<distant_light> distant_lights;
+    std::vector<point_light> point_lights;
+    std::vector<triangle_light> area_lights;
+    // Chooses the light each hit samples; uniform when unset.
+    std::shared_ptr<const light_sampler> light_sampling;
+    vec3f sky = vec3f(0.f);
+
+    const material& material_of(const shape_isect& isect) const { return materials[isect.material]; }
+
+    light_lists lights() const { return {distant_lights, point_lights, area_lights}; }
+    uint32_t light_count() const {
+        return uint32_t(distant_lights.size() + point_lights.size() + area_lights.size());
+    }
+    uint32_t area_light_index(uint32_t areaLight) const {
+        return uint32_t(distant_lights.size() + point_lights.size()) + areaLight;
+    }
+
+    // Incident light at p from light number index.
+    std::optional<light_sample> sample_light(uint32_t index, vec3f p, vec2f u) const;
+};
+
+// Makes the triangles of a placed mesh area lights with the emission of its
+// material, and points the instance's hits at them. False when the
+// prototype is not a triangle mesh or the material does not emit.
+bool add_area_lights(scene& scene, instance& emitter);
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "scenes.h"
+
+#include <math/util.h>
+#include <util/hash.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+struct grid_layout {
+    bounds3f bounds;
+    float spacing;
+    int side;
+
+    grid_layout(const shape& prototype, int count) : bounds(prototype.bounds()) {
+        vec3f extent = bounds.diagonal();
+        spacing = 1.5f * std::max(extent.x, std::max(extent.y, extent.z));
+        side = int(std::ceil(std::sqrt(double(count))));
+    }
+
+    // turn is added to the random angle, in degrees.
+    transform placement(int i, uint64_t h, vec3f shift = vec3f(0.f), float turn = 0) const {
+        float angle = float(h >> 40) * 0x1p-24f * 360.f;
+        float size = 0.8f + 0.4f * float(h & 0xffffff) * 0x1p-24f;
+        vec3f offset(float(i % side - side / 2) * spacing, float(i / side - side / 2) * spacing, 0);
+        return translate(offset + shift) * rotate_y(angle + turn) * scale(vec3f(size)) * translate(-bounds.centroid());
+    }
+};
+
+}
+
+std::shared_ptr<triangle_mesh> quad_mesh() {
+    mesh_buffers buffers;
+    buffers.px = {-0.5f, 0.5f, 0.5f, -0.5f};
+    buffers.py = {-0.5f, -0.5f, 0.5f, 0.5f};
+    buffers.pz = {0, 0, 0, 0};
+    buffers.u = {0, 1, 1, 0};
+    buffers.v = {0, 0, 1, 1};
+    buffers.indices = {0, 1, 2, 0, 2, 3};
+    return std::make_shared<triangle_mesh>(std::move(buffers));
+}
+
+std::shared_ptr<triangle_mesh> sphere_mesh(int rings) {
+    rings = std::max(rings, 2);
+    int segments = 2 * rings;
+    mesh_buffers buffers;
+    for (int i = 0; i <= rings; i++) {
+        float theta = pi * float(i) / float(rings);
+        for (int j = 0; j <= segments; j++) {
+            float phi = 2 * pi * float(j) / float(segments);
+            vec3f p(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            buffers.px.push_back(p.x);
+            buffers.py.push_back(p.y);
+            buffers.pz.push_back(p.z);
+            buffers.nx.push_back(p.x);
+            buffers.ny.push_back(p.y);
+            buffers.nz.push_back(p.z);
+            buffers.u.push_back(float(j) / float(segments));
+            buffers.v.push_back(1 - float(i) / float(rings));
+        }
+    }
+    for (int i = 0; i < rings; i++) {
+        for (int j = 0; j < segments; j++) {
+            uint32_t a = uint32_t(i * (segments + 1) + j), b = a + uint32_t(segments + 1);
+            buffers.indices.insert(buffers.indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+        }
+    }
+    return std::make_shared<triangle_mesh>(std::move(buffers));
+}
+
+std::shared_ptr<bvh_aggregate> instance_grid(std::shared_ptr<const shape> prototype, int count, uint64_t seed,
+                                             uint32_t materials) {
+    grid_layout grid(*prototype, count);
+    std::vector<std::shared_ptr<shape>> instances;
+    instances.reserve(count);
+    for (int i = 0; i < count; i++) {
+        uint64_t h = mix_bits(seed ^ uint64_t(i));
+        instances.push_back(std::make_shared<instance>(prototype, grid.placement(i, h), uint32_t((h >> 24) % materials)));
+    }
+    return std::make_shared<bvh_aggregate>(std::move(instances));
+}
+
+std::shared_ptr<bvh_aggregate> moving_instance_grid(std::shared_ptr<const shape> prototype, int count, float motion,
+                                                    uint64_t seed, uint32_t materials) {
+    grid_layout grid(*prototype, count);
+    std::vector<std::shared_ptr<shape>> instances;
+    instances.reserve(count);
+    for (int i = 0; i < count; i++) {
+        uint64_t h = mix_bits(seed ^ uint64_t(i));
+        float heading = float(mix_bits(h) >> 40) * 0x1p-24f * 2 * pi;
+        vec3f shift = motion * grid.spacing * vec3f(std::cos(heading), std::sin(heading), 0);
+        animated_transform motionPath(grid.placement(i, h), 0, grid.placement(i, h, shift, motion * 90), 1);
+        instances.push_back(std::make_shared<animated_instance>(prototype, std::move(motionPath),
+                                                                uint32_t((h >> 24) % materials)));
+    }
+    return std::make_shared<bvh_aggregate>(std::move(instances));
+}
+
+std::shared_ptr<bvh_aggregate> light_field(scene& world, int count, uint64_t seed) {
+    std::shared_ptr<triangle_mesh> quad = quad_mesh();
+    float size = 4 * std::sqrt(float(count));
+    std::vector<std::shared_ptr<shape>> shapes;
+    shapes.reserve(count + 1);
+    world.materials.push_back({material_type::diffuse, vec3f(0.6f)});
+    shapes.push_back(std::make_shared<instance>(quad, rotate_x(-90.f) * scale(vec3f(size)),
+                                                uint32_t(world.materials.size() - 1)));
+
+    auto unit = [](uint64_t h, int shift) { return float((h >> shift) & 0xffffff) * 0x1p-24f; };
+    for (int i = 0; i < count; i++) {
+        uint64_t h = mix_bits(seed ^ uint64_t(i)), h2 = mix_bits(h);
+        vec3f position(size * (unit(h, 0) - 0.5f), 0.5f + 2.5f * unit(h, 24), size * (unit(h2, 0) - 0.5f));
+        vec3f color = vec3f(0.2f) + 0.8f * vec3f(unit(h2, 24), unit(h2, 40), unit(h, 40));
+        float brightness = std::pow(100.f, unit(mix_bits(h2), 0));
+        if (i % 10 == 9) {
+            world.point_lights.push_back({position, color * brightness});
+            continue;
+        }
+        float side = 0.2f + 0.4f * unit(mix_bits(h2), 24);
+        world.materials.push_back({material_type::diffuse, vec3f(0.f), color * (4 * brightness)});
+        auto panel = std::make_shared<instance>(quad, translate(position) * rotate_x(90.f) * scale(vec3f(side)),
+                                                uint32_t(world.materials.size() - 1));
+        add_area_lights(world, *panel);
+        shapes.push_back(std::move(panel));
+    }
+    return std::make_shared<bvh_aggregate>(std::move(shapes));
+}
\ No newline at end of file
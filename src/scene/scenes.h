@@ -0,0 +1,37 @@
+#pragma once
+
+#include <accel/bvh.h>
+#include <shape/instance.h>
+#include <shape/triangle_mesh.h>
+#include <scene/scene.h>
+
+#include <memory>
+
+// Procedural test scenes for exercising the renderer at scale.
+
+// Unit square in the xy plane, centered on the origin and facing +z, as two
+// triangles. Placed with an emissive material it makes a panel light.
+std::shared_ptr<triangle_mesh> quad_mesh();
+
+// Unit sphere around the origin with rings x 2 rings quads, each split into
+// two triangles, with normals and longitude/latitude UVs.
+std::shared_ptr<triangle_mesh> sphere_mesh(int rings);
+
+// count copies of prototype on a square grid in the xy plane, each turned
+// by a random angle around y and scaled by up to +-20%. Each copy gets a
+// random material index below materials.
+std::shared_ptr<bvh_aggregate> instance_grid(std::shared_ptr<const shape> prototype, int count, uint64_t seed = 0,
+                                             uint32_t materials = 1);
+
+// instance_grid where every copy moves over the shutter interval [0, 1]:
+// it slides by motion grid spacings in a random direction in the xy plane
+// and turns a further motion * 90 degrees around y.
+std::shared_ptr<bvh_aggregate> moving_instance_grid(std::shared_ptr<const shape> prototype, int count, float motion,
+                                                    uint64_t seed = 0, uint32_t materials = 1);
+
+// Many-light benchmark: a square floor in the xz plane, 4 sqrt(count) across,
+// lit by count lights hovering at random heights above it. Nine in ten are
+// small downward-facing panels and the rest point lights, with random
+// colors and brightness spanning two orders of magnitude. Adds the
+// materials and lights to world and returns the geometry.
+std::shared_ptr<bvh_aggregate> light_field(scene& world, int count, uint64_t seed = 0);
\ No newline at end of file
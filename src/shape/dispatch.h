@@ -0,0 +1,20 @@
+#pragma once
+
+#include <shape/triangle_mesh.h>
+#include <shape/instance.h>
+#include <accel/bvh.h>
+
+// Calls f with s as its concrete type, so that f is compiled once per shape
+// type and its calls on s are direct, free to inline. Shapes of other kinds
+// reach f as the interface. Every instantiation of f must return the same
+// type.
+template <typename F>
+decltype(auto) dispatch_shape(const shape& s, F&& f) {
+    switch (s.kind()) {
+        case shape_kind::triangle_mesh: return f(static_cast<const triangle_mesh&>(s));
+        case shape_kind::instance: return f(static_cast<const instance&>(s));
+        case shape_kind::animated_instance: return f(static_cast<const animated_instance&>(s));
+        case shape_kind::aggregate: return f(static_cast<const bvh_aggregate&>(s));
+        default: return f(s);
+    }
+}
\ No newline at end of file
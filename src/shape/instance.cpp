@@ -0,0 +1,114 @@
+#include "instance.h"
+
+#include <shape/dispatch.h>
+
+#include <bit>
+
+instance::instance(std::shared_ptr<const shape> prototype, transform renderFromObject, uint32_t material)
+    : shape(shape_kind::instance), prototype(std::move(prototype)), renderFromObject(renderFromObject),
+      materialIndex(material) {
+    worldBounds = this->renderFromObject.apply(this->prototype->bounds());
+}
+
+void instance::set_transform(const transform& t) {
+    renderFromObject = t;
+    worldBounds = renderFromObject.apply(prototype->bounds());
+}
+
+static shape_isect to_render_space(const transform& renderFromObject, uint32_t material, const shape_isect& isect,
+                                   uint32_t firstLight = no_light) {
+    shape_isect result = isect;
+    result.material = material;
+    if (firstLight != no_light) result.light = firstLight + isect.primitive;
+    result.p = renderFromObject.apply(isect.p);
+    result.n = normalize(renderFromObject.apply_normal(isect.n));
+    result.dpdu = renderFromObject.apply(isect.dpdu, 0.f);
+    result.dpdv = renderFromObject.apply(isect.dpdv, 0.f);
+    return result;
+}
+
+std::optional<shape_isect> instance::intersect(const ray& r, float tMax) const {
+    ray local = renderFromObject.apply_inverse(r);
+    std::optional<shape_isect> isect =
+        dispatch_shape(*prototype, [&](const auto& s) { return s.intersect(local, tMax); });
+    if (!isect) return {};
+    return to_render_space(renderFromObject, materialIndex, *isect, firstLight);
+}
+
+bool instance::intersects(const ray& r, float tMax) const {
+    ray local = renderFromObject.apply_inverse(r);
+    return dispatch_shape(*prototype, [&](const auto& s) { return s.intersects(local, tMax); });
+}
+
+void instance::intersect(ray_packet& rays, shape_isect_packet& isects) const {
+    ray_packet local = rays;
+    renderFromObject.apply_inverse(local);
+
+    shape_isect_packet localIsects;
+    dispatch_shape(*prototype, [&](const auto& s) { s.intersect(local, localIsects); });
+    for (int i = 0; i < packet_width; i++) {
+        if (!((localIsects.mask >> i) & 1)) continue;
+        rays.tmax[i] = local.tmax[i];
+        isects.hits[i] = to_render_space(renderFromObject, materialIndex, localIsects.hits[i], firstLight);
+        isects.mask |= 1u << i;
+    }
+}
+
+animated_instance::animated_instance(std::shared_ptr<const shape> prototype, animated_transform renderFromObject,
+                                     uint32_t material)
+    : shape(shape_kind::animated_instance), prototype(std::move(prototype)),
+      renderFromObject(std::move(renderFromObject)), materialIndex(material) {
+    worldBounds = this->renderFromObject.motion_bounds(this->prototype->bounds());
+}
+
+void animated_instance::set_transform(const animated_transform& t) {
+    renderFromObject = t;
+    worldBounds = renderFromObject.motion_bounds(prototype->bounds());
+}
+
+std::optional<shape_isect> animated_instance::intersect(const ray& r, float tMax) const {
+    transform t = renderFromObject.interpolate(r.time());
+    ray local = t.apply_inverse(r);
+    std::optional<shape_isect> isect =
+        dispatch_shape(*prototype, [&](const auto& s) { return s.intersect(local, tMax); });
+    if (!isect) return {};
+    return to_render_space(t, materialIndex, *isect);
+}
+
+bool animated_instance::intersects(const ray& r, float tMax) const {
+    ray local = renderFromObject.apply_inverse(r);
+    return dispatch_shape(*prototype, [&](const auto& s) { return s.intersects(local, tMax); });
+}
+
+void animated_instance::intersect(ray_packet& rays, shape_isect_packet& isects) const {
+    if (!rays.active) return;
+
+    // Lanes usually differ in time, so each gets its own transform; a
+    // packet at a single time shares one.
+    transform lanes[packet_width];
+    int first = std::countr_zero(rays.active);
+    bool sharedTime = true;
+    for (int i = first + 1; i < packet_width; i++)
+        sharedTime &= !((rays.active >> i) & 1) || rays.time[i] == rays.time[first];
+
+    ray_packet local = rays;
+    if (sharedTime) {
+        lanes[first] = renderFromObject.interpolate(rays.time[first]);
+        lanes[first].apply_inverse(local);
+    } else {
+        for (int i = first; i < packet_width; i++) {
+            if (!((rays.active >> i) & 1)) continue;
+            lanes[i] = renderFromObject.interpolate(rays.time[i]);
+            local.set(i, lanes[i].apply_inverse(rays.get(i)), rays.tmax[i]);
+        }
+    }
+
+    shape_isect_packet localIsects;
+    dispatch_shape(*prototype, [&](const auto& s) { s.intersect(local, localIsects); });
+    for (int i = 0; i < packet_width; i++) {
+        if (!((localIsects.mask >> i) & 1)) continue;
+        rays.tmax[i] = local.tmax[i];
+        isects.hits[i] = to_render_space(lanes[sharedTime ? first : i], materialIndex, localIsects.hits[i]);
+        isects.mask |= 1u << i;
+    }
+}
\ No newline at end of file
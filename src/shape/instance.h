@@ -0,0 +1,70 @@
+#pragma once
+
+#include <shape/shape.h>
+#include <math/transform.h>
+#include <math/animated_transform.h>
+
+#include <memory>
+
+// A placement of shared geometry. Rays are moved into the prototype's
+// object space with the inverse transform instead of copying the geometry,
+// so memory grows with the number of unique prototypes, not placements.
+// The object-space direction is not renormalized, which keeps ray
+// parameters identical in both spaces.
+class instance final : public shape {
+public:
+    // Hits on the prototype report material instead of their own.
+    instance(std::shared_ptr<const shape> prototype, transform renderFromObject, uint32_t material = 0);
+
+    bounds3f bounds() const override { return worldBounds; }
+
+    std::optional<shape_isect> intersect(const ray& ray, float tMax = infinity) const override;
+    bool intersects(const ray& ray, float tMax = infinity) const override;
+    void intersect(ray_packet& rays, shape_isect_packet& isects) const override;
+
+    const transform& get_transform() const { return renderFromObject; }
+    // The aggregate holding this instance must be refit afterwards.
+    void set_transform(const transform& t);
+
+    const std::shared_ptr<const shape>& get_prototype() const { return prototype; }
+    uint32_t get_material() const { return materialIndex; }
+
+    // Hits on triangle i of the prototype report area light firstLight + i.
+    // The lights do not follow set_transform.
+    void set_lights(uint32_t firstLight) { this->firstLight = firstLight; }
+
+private:
+    std::shared_ptr<const shape> prototype;
+    transform renderFromObject;
+    bounds3f worldBounds;
+    uint32_t materialIndex;
+    uint32_t firstLight = no_light;
+};
+
+// An instance that moves over the shutter interval. Its bounds cover the
+// whole motion, so the aggregate above it needs no notion of time, and each
+// ray meets the prototype where it was at the ray's time. Motion blur then
+// costs one transform interpolation per ray rather than a render per
+// sub-frame.
+class animated_instance final : public shape {
+public:
+    animated_instance(std::shared_ptr<const shape> prototype, animated_transform renderFromObject, uint32_t material = 0);
+
+    bounds3f bounds() const override { return worldBounds; }
+
+    std::optional<shape_isect> intersect(const ray& ray, float tMax = infinity) const override;
+    bool intersects(const ray& ray, float tMax = infinity) const override;
+    void intersect(ray_packet& rays, shape_isect_packet& isects) const override;
+
+    const animated_transform& get_transform() const { return renderFromObject; }
+    // The aggregate holding this instance must be refit afterwards.
+    void set_transform(const animated_transform& t);
+
+    const std::shared_ptr<const shape>& get_prototype() const { return prototype; }
+
+private:
+    std::shared_ptr<const shape> prototype;
+    animated_transform renderFromObject;
+    bounds3f worldBounds;
+    uint32_t materialIndex;
+};
\ No newline at end of file
@@ -1,22 +1,82 @@
 #pragma once
 
 #include <math/ray.h>
+#include <math/bounds.h>
+#include <math/ray_packet.h>
 #include <common.h>
 
+#include <cstdint>
 #include <optional>
 
+inline constexpr uint32_t no_light = ~0u;
+
 struct shape_isect {
     vec3f p;
     vec3f n;
     float t;
+    vec2f uv;
+    // Change of p along u and v, for texture filtering.
+    vec3f dpdu = vec3f(0.f);
+    vec3f dpdv = vec3f(0.f);
+    // Index into the scene's materials.
+    uint32_t material = 0;
+    // Triangle of the mesh that was hit.
+    uint32_t primitive = 0;
+    // Index into the scene's area lights when the hit is on one.
+    uint32_t light = no_light;
+};
+
+// Ray leaving a hit point in direction d, moved off the surface to the
+// side it heads to so that it cannot hit the surface it starts on.
+inline ray spawn_ray(const shape_isect& isect, vec3f d, float time = 0) {
+    vec3f offset = isect.n * (1e-4f * (1 + max_of(abs(isect.p))));
+    if (dot(isect.n, d) < 0) offset = -offset;
+    return ray{isect.p + offset, d, time};
+}
+
+struct shape_isect_packet {
+    shape_isect hits[packet_width];
+    uint32_t mask = 0;
+};
+
+// The shapes that come with the renderer, for dispatch_shape() to call
+// their final classes directly. Any other shape is other and is only used
+// through the virtual interface.
+enum class shape_kind : uint8_t {
+    other,
+    triangle_mesh,
+    instance,
+    animated_instance,
+    aggregate
 };
 
 class shape {
 public:
+    explicit shape(shape_kind kind = shape_kind::other) : shapeKind(kind) {}
     virtual ~shape() = default;
 
+    shape_kind kind() const { return shapeKind; }
+
+    virtual bounds3f bounds() const = 0;
+
     virtual std::optional<shape_isect> intersect(const ray& ray, float tMax = infinity) const = 0;
-    virtual bool intersects(const ray& ray, float tMax = infinity) {
+    virtual bool intersects(const ray& ray, float tMax = infinity) const {
         return intersect(ray, tMax).has_value();
     }
+
+    // Intersects the active lanes, shrinking their tmax and recording the
+    // closer hits in isects.
+    virtual void intersect(ray_packet& rays, shape_isect_packet& isects) const {
+        for (int i = 0; i < packet_width; i++) {
+            if (!((rays.active >> i) & 1)) continue;
+            std::optional<shape_isect> isect = intersect(rays.get(i), rays.tmax[i]);
+            if (!isect) continue;
+            rays.tmax[i] = isect->t;
+            isects.hits[i] = *isect;
+            isects.mask |= 1u << i;
+        }
+    }
+
+private:
+    shape_kind shapeKind;
 };
\ No newline at end of file
@@ -0,0 +1,305 @@
+#include "triangle_mesh.h"
+
+#include <render/thread_pool.h>
+
+mesh_view view_of(const mesh_buffers& buffers) {
+    return {buffers.px, buffers.py, buffers.pz,
+            buffers.nx, buffers.ny, buffers.nz,
+            buffers.u, buffers.v,
+            buffers.indices};
+}
+
+// Ray prepared for the watertight test of Woop et al. 2013: vertices are
+// translated to the ray origin, permuted so the dominant direction axis
+// becomes z, and sheared so the ray runs along +z.
+struct triangle_ray {
+    vec3f o;
+    int kx, ky, kz;
+    float sx, sy, sz;
+};
+
+struct triangle_hit {
+    uint32_t triangle;
+    float b0, b1, b2, t;
+};
+
+static triangle_ray make_triangle_ray(const ray& r) {
+    vec3f d = r.direction();
+    vec3f a = abs(d);
+    int kz = (a.x > a.y && a.x > a.z) ? 0 : (a.y > a.z ? 1 : 2);
+    int kx = kz == 2 ? 0 : kz + 1;
+    int ky = kx == 2 ? 0 : kx + 1;
+    return {r.origin(), kx, ky, kz, -d[kx] / d[kz], -d[ky] / d[kz], 1 / d[kz]};
+}
+
+// Scalar version of the batch test below, used for the rare lanes where an
+// edge function rounds to exactly zero and has to be redone in double.
+static bool intersect_triangle(const mesh_view& mesh, const triangle_ray& r, uint32_t triangle, float tMax,
+                               triangle_hit& hit) {
+    const std::span<const float> pos[3] = {mesh.px, mesh.py, mesh.pz};
+    vec3f p[3];
+    for (int k = 0; k < 3; k++) {
+        uint32_t index = mesh.indices[3 * triangle + k];
+        p[k] = vec3f(pos[r.kx][index] - r.o[r.kx], pos[r.ky][index] - r.o[r.ky], pos[r.kz][index] - r.o[r.kz]);
+        p[k].x += r.sx * p[k].z;
+        p[k].y += r.sy * p[k].z;
+    }
+
+    float e0 = float(double(p[1].x) * p[2].y - double(p[1].y) * p[2].x);
+    float e1 = float(double(p[2].x) * p[0].y - double(p[2].y) * p[0].x);
+    float e2 = float(double(p[0].x) * p[1].y - double(p[0].y) * p[1].x);
+    if ((e0 < 0 || e1 < 0 || e2 < 0) && (e0 > 0 || e1 > 0 || e2 > 0)) return false;
+    float det = e0 + e1 + e2;
+    if (det == 0) return false;
+
+    for (vec3f& v : p) v.z *= r.sz;
+    float tScaled = e0 * p[0].z + e1 * p[1].z + e2 * p[2].z;
+    if (det < 0 && (tScaled >= 0 || tScaled < tMax * det)) return false;
+    if (det > 0 && (tScaled <= 0 || tScaled > tMax * det)) return false;
+
+    float invDet = 1 / det;
+    float t = tScaled * invDet;
+
+    float maxZt = max_of(abs(vec3f(p[0].z, p[1].z, p[2].z)));
+    float maxXt = max_of(abs(vec3f(p[0].x, p[1].x, p[2].x)));
+    float maxYt = max_of(abs(vec3f(p[0].y, p[1].y, p[2].y)));
+    float deltaZ = error_gamma(3) * maxZt;
+    float deltaX = error_gamma(5) * (maxXt + maxZt);
+    float deltaY = error_gamma(5) * (maxYt + maxZt);
+    float deltaE = 2 * (error_gamma(2) * maxXt * maxYt + deltaY * maxXt + deltaX * maxYt);
+    float maxE = max_of(abs(vec3f(e0, e1, e2)));
+    float deltaT = 3 * (error_gamma(3) * maxE * maxZt + deltaE * maxZt + deltaZ * maxE) * std::abs(invDet);
+    if (t <= deltaT) return false;
+
+    hit = {triangle, e0 * invDet, e1 * invDet, e2 * invDet, t};
+    return true;
+}
+
+// Tests one ray against up to simd_width triangles, one per lane, and keeps
+// the closest hit. Edge functions use the error-free diff_of_products, so
+// shared edges are classified identically from both sides.
+static bool intersect_triangles(const mesh_view& mesh, const triangle_ray& r, const uint32_t* triangles, int count,
+                                float tMax, triangle_hit& hit) {
+    const std::span<const float> pos[3] = {mesh.px, mesh.py, mesh.pz};
+    alignas(32) float v[3][3][simd_width];
+    for (int lane = 0; lane < simd_width; lane++) {
+        uint32_t triangle = triangles[std::min(lane, count - 1)];
+        for (int k = 0; k < 3; k++) {
+            uint32_t index = mesh.indices[3 * triangle + k];
+            v[k][0][lane] = pos[r.kx][index] - r.o[r.kx];
+            v[k][1][lane] = pos[r.ky][index] - r.o[r.ky];
+            v[k][2][lane] = pos[r.kz][index] - r.o[r.kz];
+        }
+    }
+
+    vfloatn sx(r.sx), sy(r.sy), sz(r.sz), zero(0.f);
+    vfloatn p0z = vfloatn::load(v[0][2]), p1z = vfloatn::load(v[1][2]), p2z = vfloatn::load(v[2][2]);
+    vfloatn p0x = vfloatn::load(v[0][0]) + sx * p0z, p0y = vfloatn::load(v[0][1]) + sy * p0z;
+    vfloatn p1x = vfloatn::load(v[1][0]) + sx * p1z, p1y = vfloatn::load(v[1][1]) + sy * p1z;
+    vfloatn p2x = vfloatn::load(v[2][0]) + sx * p2z, p2y = vfloatn::load(v[2][1]) + sy * p2z;
+
+    vfloatn e0 = diff_of_products(p1x, p2y, p1y, p2x);
+    vfloatn e1 = diff_of_products(p2x, p0y, p2y, p0x);
+    vfloatn e2 = diff_of_products(p0x, p1y, p0y, p1x);
+    uint32_t lanes = (1u << count) - 1;
+    uint32_t degenerate = ((e0 == zero) | (e1 == zero) | (e2 == zero)).movemask() & lanes;
+
+    vmaskn anyNegative = (e0 < zero) | (e1 < zero) | (e2 < zero);
+    vmaskn anyPositive = (e0 > zero) | (e1 > zero) | (e2 > zero);
+    vfloatn det = e0 + e1 + e2;
+    vmaskn valid = ~(anyNegative & anyPositive) & ~(det == zero);
+
+    p0z = p0z * sz;
+    p1z = p1z * sz;
+    p2z = p2z * sz;
+    vfloatn tScaled = e0 * p0z + e1 * p1z + e2 * p2z;
+    vfloatn tMaxDet = vfloatn(tMax) * det;
+    valid = valid & (((det < zero) & (tScaled < zero) & (tScaled >= tMaxDet)) |
+                     ((det > zero) & (tScaled > zero) & (tScaled <= tMaxDet)));
+
+    vfloatn invDet = vfloatn(1.f) / det;
+    vfloatn t = tScaled * invDet;
+
+    vfloatn maxZt = max(max(abs(p0z), abs(p1z)), abs(p2z));
+    vfloatn maxXt = max(max(abs(p0x), abs(p1x)), abs(p2x));
+    vfloatn maxYt = max(max(abs(p0y), abs(p1y)), abs(p2y));
+    vfloatn deltaZ = vfloatn(error_gamma(3)) * maxZt;
+    vfloatn deltaX = vfloatn(error_gamma(5)) * (maxXt + maxZt);
+    vfloatn deltaY = vfloatn(error_gamma(5)) * (maxYt + maxZt);
+    vfloatn deltaE = vfloatn(2.f) * (vfloatn(error_gamma(2)) * maxXt * maxYt + deltaY * maxXt + deltaX * maxYt);
+    vfloatn maxE = max(max(abs(e0), abs(e1)), abs(e2));
+    vfloatn deltaT = vfloatn(3.f) * (vfloatn(error_gamma(3)) * maxE * maxZt + deltaE * maxZt + deltaZ * maxE) *
+                     abs(invDet);
+    valid = valid & (t > deltaT);
+
+    uint32_t hits = valid.movemask() & lanes & ~degenerate;
+    bool found = false;
+    while (hits) {
+        int lane = std::countr_zero(hits);
+        hits &= hits - 1;
+        if (t[lane] >= tMax) continue;
+        float inv = invDet[lane];
+        hit = {triangles[lane], e0[lane] * inv, e1[lane] * inv, e2[lane] * inv, t[lane]};
+        tMax = t[lane];
+        found = true;
+    }
+    while (degenerate) {
+        int lane = std::countr_zero(degenerate);
+        degenerate &= degenerate - 1;
+        if (intersect_triangle(mesh, r, triangles[lane], tMax, hit)) {
+            tMax = hit.t;
+            found = true;
+        }
+    }
+    return found;
+}
+
+static bool intersect_leaf(const mesh_view& mesh, const triangle_ray& r, std::span<const uint32_t> triangles,
+                           float tMax, triangle_hit& hit) {
+    bool found = false;
+    for (size_t i = 0; i < triangles.size(); i += simd_width) {
+        int count = int(std::min<size_t>(simd_width, triangles.size() - i));
+        if (intersect_triangles(mesh, r, triangles.data() + i, count, tMax, hit)) {
+            tMax = hit.t;
+            found = true;
+        }
+    }
+    return found;
+}
+
+triangle_mesh::triangle_mesh(mesh_buffers buffers, const bvh_build_options& options)
+    : shape(shape_kind::triangle_mesh) {
+    auto owned = std::make_shared<const mesh_buffers>(std::move(buffers));
+    mesh = view_of(*owned);
+    storage = std::move(owned);
+    build(options);
+}
+
+triangle_mesh::triangle_mesh(mesh_view data, std::shared_ptr<const void> storage, const bvh_build_options& options)
+    : shape(shape_kind::triangle_mesh), storage(std::move(storage)), mesh(data) {
+    build(options);
+}
+
+void triangle_mesh::build(const bvh_build_options& options) {
+    std::vector<bounds3f> triangleBounds(triangle_count());
+    parallel_for(0, int64_t(triangleBounds.size()), 1 << 14, [&](int64_t i) {
+        triangleBounds[i] = triangle_bounds(uint32_t(i));
+    });
+    accel = bvh(triangleBounds, options);
+}
+
+bool triangle_mesh::update(std::span<const uint32_t> changedTriangles, bvh_update_stats* stats) {
+    auto bounds = [&](uint32_t triangle) { return triangle_bounds(triangle); };
+    return accel.refit(bounds, changedTriangles, stats) && accel.rebuild_degraded(bounds, stats);
+}
+
+size_t triangle_mesh::memory_bytes() const {
+    size_t floats = mesh.px.size() + mesh.py.size() + mesh.pz.size() +
+                    mesh.nx.size() + mesh.ny.size() + mesh.nz.size() +
+                    mesh.u.size() + mesh.v.size();
+    return floats * sizeof(float) + mesh.indices.size() * sizeof(uint32_t) +
+           accel.node_span().size_bytes() + accel.primitive_span().size_bytes();
+}
+
+bounds3f triangle_mesh::triangle_bounds(uint32_t triangle) const {
+    bounds3f b;
+    for (int k = 0; k < 3; k++) {
+        uint32_t index = mesh.indices[3 * triangle + k];
+        b = union_of(b, vec3f(mesh.px[index], mesh.py[index], mesh.pz[index]));
+    }
+    return b;
+}
+
+bounds3f triangle_mesh::bounds() const {
+    return accel.bounds();
+}
+
+shape_isect triangle_mesh::interaction(uint32_t triangle, float b0, float b1, float b2, float t) const {
+    uint32_t i0 = mesh.indices[3 * triangle], i1 = mesh.indices[3 * triangle + 1], i2 = mesh.indices[3 * triangle + 2];
+    vec3f p0(mesh.px[i0], mesh.py[i0], mesh.pz[i0]);
+    vec3f p1(mesh.px[i1], mesh.py[i1], mesh.pz[i1]);
+    vec3f p2(mesh.px[i2], mesh.py[i2], mesh.pz[i2]);
+
+    shape_isect isect;
+    isect.p = vec3f(inner_prod(b0, p0.x, b1, p1.x, b2, p2.x),
+                    inner_prod(b0, p0.y, b1, p1.y, b2, p2.y),
+                    inner_prod(b0, p0.z, b1, p1.z, b2, p2.z));
+    isect.n = normalize(cross(p1 - p0, p2 - p0));
+    isect.t = t;
+    isect.primitive = triangle;
+
+    if (mesh.has_normals()) {
+        vec3f ns = b0 * vec3f(mesh.nx[i0], mesh.ny[i0], mesh.nz[i0]) +
+                   b1 * vec3f(mesh.nx[i1], mesh.ny[i1], mesh.nz[i1]) +
+                   b2 * vec3f(mesh.nx[i2], mesh.ny[i2], mesh.nz[i2]);
+        if (length_sqr(ns) > 0) isect.n = normalize(ns);
+    }
+
+    // Without UVs the barycentrics stand in, as if the corners sat at (0, 0),
+    // (1, 0) and (0, 1).
+    vec2f uv0(0.f), uv1(1, 0), uv2(0, 1);
+    if (mesh.has_uvs()) {
+        uv0 = vec2f(mesh.u[i0], mesh.v[i0]);
+        uv1 = vec2f(mesh.u[i1], mesh.v[i1]);
+        uv2 = vec2f(mesh.u[i2], mesh.v[i2]);
+    }
+    isect.uv = b0 * uv0 + b1 * uv1 + b2 * uv2;
+
+    vec2f duv02 = uv0 - uv2, duv12 = uv1 - uv2;
+    vec3f dp02 = p0 - p2, dp12 = p1 - p2;
+    float determinant = duv02.x * duv12.y - duv02.y * duv12.x;
+    if (std::abs(determinant) > 1e-9f) {
+        float invDeterminant = 1 / determinant;
+        isect.dpdu = (dp02 * duv12.y - dp12 * duv02.y) * invDeterminant;
+        isect.dpdv = (dp12 * duv02.x - dp02 * duv12.x) * invDeterminant;
+    }
+    return isect;
+}
+
+std::optional<shape_isect> triangle_mesh::intersect(const ray& ray, float tMax) const {
+    triangle_ray r = make_triangle_ray(ray);
+    triangle_hit hit;
+    bool found = accel.intersect_leaves(ray, tMax, [&](std::span<const uint32_t> leaf, float& t) {
+        if (!intersect_leaf(mesh, r, leaf, t, hit)) return false;
+        t = hit.t;
+        return true;
+    });
+    if (!found) return {};
+    return interaction(hit.triangle, hit.b0, hit.b1, hit.b2, hit.t);
+}
+
+bool triangle_mesh::intersects(const ray& ray, float tMax) const {
+    triangle_ray r = make_triangle_ray(ray);
+    triangle_hit hit;
+    return accel.intersects_leaves(ray, tMax, [&](std::span<const uint32_t> leaf, float& t) {
+        return intersect_leaf(mesh, r, leaf, t, hit);
+    });
+}
+
+void triangle_mesh::intersect(ray_packet& rays, shape_isect_packet& isects) const {
+    triangle_ray r[packet_width];
+    triangle_hit hits[packet_width];
+    uint32_t found = 0;
+    for (int i = 0; i < packet_width; i++) {
+        if ((rays.active >> i) & 1) r[i] = make_triangle_ray(rays.get(i));
+    }
+
+    accel.intersect(rays, [&](std::span<const uint32_t> leaf, ray_packet& packet, uint32_t lanes) {
+        while (lanes) {
+            int lane = std::countr_zero(lanes);
+            lanes &= lanes - 1;
+            if (intersect_leaf(mesh, r[lane], leaf, packet.tmax[lane], hits[lane])) {
+                packet.tmax[lane] = hits[lane].t;
+                found |= 1u << lane;
+            }
+        }
+    });
+
+    while (found) {
+        int lane = std::countr_zero(found);
+        found &= found - 1;
+        const triangle_hit& hit = hits[lane];
+        isects.hits[lane] = interaction(hit.triangle, hit.b0, hit.b1, hit.b2, hit.t);
+        isects.mask |= 1u << lane;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <shape/shape.h>
+#include <accel/bvh.h>
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Owned mesh attributes, one array per component. Normals and UVs are
+// optional (left empty) and, when present, indexed like the positions.
+struct mesh_buffers {
+    std::vector<float> px, py, pz;
+    std::vector<float> nx, ny, nz;
+    std::vector<float> u, v;
+    std::vector<uint32_t> indices;
+};
+
+// Non-owning view of the same layout, so meshes can also live in memory
+// they do not allocate themselves.
+struct mesh_view {
+    std::span<const float> px, py, pz;
+    std::span<const float> nx, ny, nz;
+    std::span<const float> u, v;
+    std::span<const uint32_t> indices;
+
+    size_t vertex_count() const { return px.size(); }
+    size_t triangle_count() const { return indices.size() / 3; }
+    bool has_normals() const { return !nx.empty(); }
+    bool has_uvs() const { return !u.empty(); }
+};
+
+mesh_view view_of(const mesh_buffers& buffers);
+
+// Indexed triangle mesh with its own BVH over the triangles.
+//
+// Memory per triangle is fixed by the layout: 12 bytes of indices, 4 bytes
+// for the BVH primitive order and about 9 bytes of BVH nodes with the
+// default SIMD-wide leaves, plus 12 bytes of positions, 12 of normals and 8
+// of UVs per vertex. Closed meshes have about half a vertex per triangle, so
+// a mesh with every attribute costs roughly 41 bytes per triangle and 10M
+// triangles take ~410 MB; memory_bytes() reports the exact figure.
+// Construction additionally needs ~56 bytes per triangle of transient BVH
+// build state.
+class triangle_mesh final : public shape {
+public:
+    explicit triangle_mesh(mesh_buffers buffers, const bvh_build_options& options = default_bvh_options());
+    triangle_mesh(mesh_view data, std::shared_ptr<const void> storage,
+                  const bvh_build_options& options = default_bvh_options());
+    // Uses a BVH that was already built over this exact mesh.
+    triangle_mesh(mesh_view data, std::shared_ptr<const void> storage, bvh accel)
+        : shape(shape_kind::triangle_mesh), storage(std::move(storage)), mesh(data), accel(std::move(accel)) {}
+
+    static bvh_build_options default_bvh_options() {
+        // A leaf tests simd_width triangles for the price of one, which makes
+        // a node visit comparatively more expensive.
+        bvh_build_options options;
+        options.max_primitives_in_node = simd_width;
+        options.traversal_cost = 0.5f * simd_width;
+        return options;
+    }
+
+    const mesh_view& data() const { return mesh; }
+    const bvh& acceleration() const { return accel; }
+    size_t triangle_count() const { return mesh.triangle_count(); }
+    size_t memory_bytes() const;
+
+    bounds3f triangle_bounds(uint32_t triangle) const;
+
+    // For meshes over memory the caller owns and writes to: after moving
+    // the vertices of the given triangles, refits their part of the BVH and
+    // rebuilds subtrees that degraded. False when the BVH was adopted from
+    // a cache and cannot change.
+    bool update(std::span<const uint32_t> changedTriangles, bvh_update_stats* stats = nullptr);
+
+    bounds3f bounds() const override;
+
+    std::optional<shape_isect> intersect(const ray& ray, float tMax = infinity) const override;
+    bool intersects(const ray& ray, float tMax = infinity) const override;
+    void intersect(ray_packet& rays, shape_isect_packet& isects) const override;
+
+private:
+    std::shared_ptr<const void> storage;
+    mesh_view mesh;
+    bvh accel;
+
+    void build(const bvh_build_options& options);
+    shape_isect interaction(uint32_t triangle, float b0, float b1, float b2, float t) const;
+};
\ No newline at end of file
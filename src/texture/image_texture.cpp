@@ -0,0 +1,319 @@
+#include "image_texture.h"
+
+#include <color/color.h>
+#include <util/hash.h>
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+static constexpr char cache_magic[8] = {'R', 'N', 'D', 'R', 'T', 'E', 'X', '\0'};
+// Pages, so evicting a tile's bytes from the mapping drops exactly its pages.
+static constexpr uint64_t tile_alignment = 4096;
+static constexpr size_t tile_floats = size_t(texture_tile_size) * texture_tile_size * 3;
+static constexpr uint64_t tile_bytes = tile_floats * sizeof(float);
+
+namespace {
+
+struct texture_cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t levels;
+    uint32_t width;
+    uint32_t height;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_hash;
+    uint64_t reserved[2];
+};
+
+struct texture_cache_level {
+    uint32_t width;
+    uint32_t height;
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+    uint64_t offset;
+};
+
+}
+
+static_assert(sizeof(texture_cache_header) == 64);
+static_assert(sizeof(texture_cache_level) == 24);
+
+static int wrap(int i, int n) {
+    i %= n;
+    return i < 0 ? i + n : i;
+}
+
+// Halves a level with a 2x2 box filter; the last row or column of an odd
+// size is averaged with itself.
+static std::vector<float> downsample(std::span<const float> rgb, int width, int height, int& outWidth, int& outHeight) {
+    outWidth = std::max(1, (width + 1) / 2);
+    outHeight = std::max(1, (height + 1) / 2);
+    std::vector<float> result(size_t(outWidth) * outHeight * 3);
+    for (int y = 0; y < outHeight; y++) {
+        int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+        for (int x = 0; x < outWidth; x++) {
+            int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            for (int c = 0; c < 3; c++) {
+                float sum = rgb[(size_t(y0) * width + x0) * 3 + c] + rgb[(size_t(y0) * width + x1) * 3 + c] +
+                            rgb[(size_t(y1) * width + x0) * 3 + c] + rgb[(size_t(y1) * width + x1) * 3 + c];
+                result[(size_t(y) * outWidth + x) * 3 + c] = sum * 0.25f;
+            }
+        }
+    }
+    return result;
+}
+
+static void write_tiles(std::ofstream& out, std::span<const float> rgb, int width, int height, int tilesX, int tilesY) {
+    std::vector<float> tile(tile_floats);
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; tx++) {
+            std::fill(tile.begin(), tile.end(), 0.f);
+            for (int y = 0; y < texture_tile_size && ty * texture_tile_size + y < height; y++) {
+                int row = ty * texture_tile_size + y;
+                int columns = std::min(texture_tile_size, width - tx * texture_tile_size);
+                std::memcpy(tile.data() + size_t(y) * texture_tile_size * 3,
+                            rgb.data() + (size_t(row) * width + tx * texture_tile_size) * 3,
+                            size_t(columns) * 3 * sizeof(float));
+            }
+            out.write(reinterpret_cast<const char*>(tile.data()), std::streamsize(tile_bytes));
+        }
+    }
+}
+
+bool write_texture_cache(const std::string& path, int width, int height, std::span<const float> rgb,
+                         const texture_source_stamp& source) {
+    if (width <= 0 || height <= 0 || rgb.size() != size_t(width) * height * 3) return false;
+
+    std::vector<std::vector<float>> pyramid;
+    std::vector<texture_cache_level> table;
+    pyramid.emplace_back(rgb.begin(), rgb.end());
+    table.push_back({uint32_t(width), uint32_t(height), 0, 0, 0});
+    while (table.back().width > 1 || table.back().height > 1) {
+        int w, h;
+        pyramid.push_back(downsample(pyramid.back(), int(table.back().width), int(table.back().height), w, h));
+        table.push_back({uint32_t(w), uint32_t(h), 0, 0, 0});
+    }
+
+    uint64_t offset = sizeof(texture_cache_header) + table.size() * sizeof(texture_cache_level);
+    for (texture_cache_level& level : table) {
+        level.tiles_x = (level.width + texture_tile_size - 1) / texture_tile_size;
+        level.tiles_y = (level.height + texture_tile_size - 1) / texture_tile_size;
+        level.offset = offset = (offset + tile_alignment - 1) / tile_alignment * tile_alignment;
+        offset += uint64_t(level.tiles_x) * level.tiles_y * tile_bytes;
+    }
+
+    texture_cache_header header{};
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = texture_cache_version;
+    header.levels = uint32_t(table.size());
+    header.width = uint32_t(width);
+    header.height = uint32_t(height);
+    header.source_size = source.size;
+    header.source_mtime = source.mtime;
+    header.source_hash = source.hash;
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        uint64_t position = sizeof(header) + table.size() * sizeof(texture_cache_level);
+        out.write(reinterpret_cast<const char*>(table.data()), std::streamsize(position - sizeof(header)));
+        static const char padding[tile_alignment] = {};
+        for (size_t i = 0; i < table.size(); i++) {
+            out.write(padding, std::streamsize(table[i].offset - position));
+            write_tiles(out, pyramid[i], int(table[i].width), int(table[i].height),
+                        int(table[i].tiles_x), int(table[i].tiles_y));
+            position = table[i].offset + uint64_t(table[i].tiles_x) * table[i].tiles_y * tile_bytes;
+        }
+        if (!out) return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+image_texture::image_texture(std::shared_ptr<const mapped_file> file, std::vector<level> levels,
+                             std::shared_ptr<tile_cache> tiles)
+    : file(std::move(file)), levels(std::move(levels)), tiles(std::move(tiles)) {
+    keyPrefix = this->tiles->register_texture();
+}
+
+vec3f image_texture::texel(int level, int x, int y) const {
+    tile_cursor cursor;
+    return texel(level, x, y, cursor);
+}
+
+vec3f image_texture::texel(int level, int x, int y, tile_cursor& cursor) const {
+    const image_texture::level& l = levels[level];
+    x = wrap(x, l.width);
+    y = wrap(y, l.height);
+    uint64_t tile = uint64_t(y / texture_tile_size) * l.tiles_x + x / texture_tile_size;
+    uint64_t key = keyPrefix | uint64_t(level) << 34 | tile;
+    if (key != cursor.key) {
+        cursor.tile = tiles->get(key, [&] {
+            uint64_t offset = l.offset + tile * tile_bytes;
+            auto result = std::make_shared<texture_tile>();
+            result->rgb.resize(tile_floats);
+            std::memcpy(result->rgb.data(), file->data() + offset, tile_bytes);
+            // The copy is what stays resident; the mapped pages can go.
+            file->evict(offset, tile_bytes);
+            return result;
+        });
+        cursor.key = key;
+    }
+    const float* rgb = cursor.tile->rgb.data() +
+                       (size_t(y % texture_tile_size) * texture_tile_size + x % texture_tile_size) * 3;
+    return vec3f(rgb[0], rgb[1], rgb[2]);
+}
+
+vec3f image_texture::bilinear(int level, vec2f uv, tile_cursor& cursor) const {
+    // v points up the image, whose rows are stored from the top.
+    float x = uv.x * float(levels[level].width) - 0.5f;
+    float y = (1 - uv.y) * float(levels[level].height) - 0.5f;
+    float x0 = std::floor(x), y0 = std::floor(y);
+    float fx = x - x0, fy = y - y0;
+    int ix = int(x0), iy = int(y0);
+    return texel(level, ix, iy, cursor) * ((1 - fx) * (1 - fy)) +
+           texel(level, ix + 1, iy, cursor) * (fx * (1 - fy)) +
+           texel(level, ix, iy + 1, cursor) * ((1 - fx) * fy) +
+           texel(level, ix + 1, iy + 1, cursor) * (fx * fy);
+}
+
+vec3f image_texture::lookup(vec2f uv, float width) const {
+    if (!std::isfinite(uv.x) || !std::isfinite(uv.y)) return vec3f(0.f);
+    uv = vec2f(uv.x - std::floor(uv.x), uv.y - std::floor(uv.y));
+
+    // Level l has texels 2^l finer than the base, so the footprint covers
+    // about one texel of the level log2(width * resolution).
+    int top = level_count() - 1;
+    float resolution = float(std::max(levels[0].width, levels[0].height));
+    float l = width > 0 ? std::log2(width * resolution) : 0;
+    tile_cursor cursor;
+    if (!(l > 0)) return bilinear(0, uv, cursor);
+    if (l >= float(top)) return bilinear(top, uv, cursor);
+    int i = int(l);
+    float t = l - float(i);
+    return bilinear(i, uv, cursor) * (1 - t) + bilinear(i + 1, uv, cursor) * t;
+}
+
+std::optional<mapped_texture_cache> open_texture_cache(const std::string& path, std::shared_ptr<tile_cache> tiles) {
+    std::shared_ptr<const mapped_file> file = mapped_file::open(path);
+    if (!file || file->size() < sizeof(texture_cache_header)) return {};
+
+    texture_cache_header header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0) return {};
+    if (header.version != texture_cache_version || header.levels == 0 || header.levels > 64) return {};
+    if (file->size() < sizeof(header) + header.levels * sizeof(texture_cache_level)) return {};
+
+    std::vector<image_texture::level> levels;
+    for (uint32_t i = 0; i < header.levels; i++) {
+        texture_cache_level level;
+        std::memcpy(&level, file->data() + sizeof(header) + i * sizeof(level), sizeof(level));
+        if (level.width == 0 || level.height == 0) return {};
+        if (level.tiles_x != (level.width + texture_tile_size - 1) / texture_tile_size ||
+            level.tiles_y != (level.height + texture_tile_size - 1) / texture_tile_size)
+            return {};
+        if (level.offset % tile_alignment != 0 || level.offset > file->size() ||
+            uint64_t(level.tiles_x) * level.tiles_y > (file->size() - level.offset) / tile_bytes)
+            return {};
+        levels.push_back({int(level.width), int(level.height), int(level.tiles_x), int(level.tiles_y), level.offset});
+    }
+    if (levels[0].width != int(header.width) || levels[0].height != int(header.height)) return {};
+    // Tile indices have 34 bits of the key.
+    if (uint64_t(levels[0].tiles_x) * levels[0].tiles_y >= uint64_t(1) << 34) return {};
+
+    mapped_texture_cache cache;
+    cache.texture = std::make_shared<image_texture>(file, std::move(levels), std::move(tiles));
+    cache.source = {header.source_size, header.source_mtime, header.source_hash};
+    return cache;
+}
+
+// As for meshes: once the hash has shown the source unchanged, record its
+// new mtime so that later loads skip hashing.
+static bool update_source_mtime(const std::string& path, int64_t mtime) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file) return false;
+    file.seekp(offsetof(texture_cache_header, source_mtime));
+    file.write(reinterpret_cast<const char*>(&mtime), sizeof(mtime));
+    return bool(file);
+}
+
+static uint64_t hash_file(const std::string& path) {
+    std::shared_ptr<const mapped_file> file = mapped_file::open(path);
+    return file ? hash_bytes(file->bytes()) : 0;
+}
+
+static std::optional<std::vector<float>> load_image(const std::string& path, int& width, int& height) {
+    int channels;
+    std::vector<float> rgb;
+    if (stbi_is_hdr(path.c_str())) {
+        float* data = stbi_loadf(path.c_str(), &width, &height, &channels, 3);
+        if (!data) return {};
+        rgb.assign(data, data + size_t(width) * height * 3);
+        stbi_image_free(data);
+    } else {
+        stbi_uc* data = stbi_load(path.c_str(), &width, &height, &channels, 3);
+        if (!data) return {};
+        rgb.resize(size_t(width) * height * 3);
+        for (size_t i = 0; i < rgb.size(); i++)
+            rgb[i] = srgb_to_linear(float(data[i]) / 255.0f);
+        stbi_image_free(data);
+    }
+    return rgb;
+}
+
+std::shared_ptr<const image_texture> load_texture(const std::string& path, std::shared_ptr<tile_cache> tiles) {
+    std::string cachePath = path + ".rtex";
+    std::optional<file_stamp> stamp = stamp_file(path);
+    std::optional<mapped_texture_cache> cache = open_texture_cache(cachePath, tiles);
+
+    if (cache && !stamp) return cache->texture;
+    if (!stamp) return nullptr;
+
+    uint64_t hash = 0;
+    if (cache && cache->source.size == stamp->size) {
+        if (cache->source.mtime == stamp->mtime) return cache->texture;
+        hash = hash_file(path);
+        if (cache->source.hash == hash) {
+            update_source_mtime(cachePath, stamp->mtime);
+            return cache->texture;
+        }
+    }
+
+    int width, height;
+    std::optional<std::vector<float>> rgb = load_image(path, width, height);
+    if (!rgb) return nullptr;
+    if (!hash) hash = hash_file(path);
+
+    // The texture is always read back from its cache; there is no other
+    // place for tiles to come from.
+    if (!write_texture_cache(cachePath, width, height, *rgb, {stamp->size, stamp->mtime, hash})) return nullptr;
+    cache = open_texture_cache(cachePath, std::move(tiles));
+    return cache ? cache->texture : nullptr;
+}
+
+float uv_filter_width(vec3f dpdu, vec3f dpdv, vec3f dpdx, vec3f dpdy) {
+    // Least-squares solution of dpdu * du + dpdv * dv = dp for each step.
+    float a00 = dot(dpdu, dpdu), a01 = dot(dpdu, dpdv), a11 = dot(dpdv, dpdv);
+    float determinant = a00 * a11 - a01 * a01;
+    if (!(std::abs(determinant) > 1e-12f)) return 0;
+    float invDeterminant = 1 / determinant;
+    auto solve = [&](vec3f dp) {
+        float b0 = dot(dpdu, dp), b1 = dot(dpdv, dp);
+        float du = (a11 * b0 - a01 * b1) * invDeterminant;
+        float dv = (a00 * b1 - a01 * b0) * invDeterminant;
+        return std::max(std::abs(du), std::abs(dv));
+    };
+    float width = 2 * std::max(solve(dpdx), solve(dpdy));
+    return std::isfinite(width) ? width : 0;
+}
\ No newline at end of file
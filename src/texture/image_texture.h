@@ -0,0 +1,90 @@
+#pragma once
+
+#include <texture/tile_cache.h>
+#include <util/mapped_file.h>
+#include <math/vec.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// Tiled texture cache ("<source>.rtex"): a 64-byte header, a level table
+// and the MIP pyramid of the image, each level split into square tiles of
+// linear RGB floats, stored one after another from the top left. Every
+// tile is page-aligned and full size (edge tiles are padded), so a tile is
+// found by arithmetic and read without touching its neighbors.
+//
+// Like mesh caches, the header records the size, modification time and
+// content hash of the source; the version must be bumped whenever the
+// layout changes.
+constexpr uint32_t texture_cache_version = 1;
+constexpr int texture_tile_size = 32;
+
+struct texture_source_stamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t hash = 0;
+};
+
+// Builds the MIP pyramid of a width x height image of linear RGB texels,
+// rows from the top, and writes it tiled.
+bool write_texture_cache(const std::string& path, int width, int height, std::span<const float> rgb,
+                         const texture_source_stamp& source);
+
+// Image texture whose texels stay on disk: tiles are read from the mapped
+// cache file on first use and kept in a tile_cache shared between
+// textures, so only the tiles recent lookups touched take up memory.
+class image_texture {
+public:
+    struct level {
+        int width, height;
+        int tiles_x, tiles_y;
+        uint64_t offset;
+    };
+
+    image_texture(std::shared_ptr<const mapped_file> file, std::vector<level> levels, std::shared_ptr<tile_cache> tiles);
+
+    // Filtered texel color around uv (repeating outside [0, 1)) over a
+    // footprint width wide in uv space, blending the two nearest MIP levels.
+    vec3f lookup(vec2f uv, float width) const;
+
+    // One texel, with x and y wrapped around the level.
+    vec3f texel(int level, int x, int y) const;
+
+    int level_count() const { return int(levels.size()); }
+    vec2i resolution(int level = 0) const { return vec2i(levels[level].width, levels[level].height); }
+
+private:
+    std::shared_ptr<const mapped_file> file;
+    std::vector<level> levels;
+    std::shared_ptr<tile_cache> tiles;
+    uint64_t keyPrefix;
+
+    // Tile a lookup last read, so texels from the same tile skip the cache.
+    struct tile_cursor {
+        uint64_t key = ~uint64_t(0);
+        std::shared_ptr<const texture_tile> tile;
+    };
+
+    vec3f texel(int level, int x, int y, tile_cursor& cursor) const;
+    vec3f bilinear(int level, vec2f uv, tile_cursor& cursor) const;
+};
+
+struct mapped_texture_cache {
+    std::shared_ptr<const image_texture> texture;
+    texture_source_stamp source;
+};
+
+std::optional<mapped_texture_cache> open_texture_cache(const std::string& path, std::shared_ptr<tile_cache> tiles);
+
+// Loads an image through its cache, rebuilding a missing or stale one the
+// way load_mesh does. 8-bit images are taken to be sRGB; HDR images are
+// already linear.
+std::shared_ptr<const image_texture> load_texture(const std::string& path, std::shared_ptr<tile_cache> tiles);
+
+// Width in uv space of the footprint of a pixel step (dpdx, dpdy) on a
+// surface parameterized by dpdu and dpdv.
+float uv_filter_width(vec3f dpdu, vec3f dpdv, vec3f dpdx, vec3f dpdy);
\ No newline at end of file
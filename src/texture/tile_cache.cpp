@@ -0,0 +1,63 @@
+#include "tile_cache.h"
+
+#include <util/hash.h>
+
+static size_t tile_bytes(const texture_tile& tile) {
+    return sizeof(texture_tile) + tile.rgb.size() * sizeof(float);
+}
+
+tile_cache::tile_cache(size_t capacityBytes, int shardCount) {
+    shardCount = std::max(shardCount, 1);
+    shards.reserve(shardCount);
+    for (int i = 0; i < shardCount; i++)
+        shards.push_back(std::make_unique<shard>());
+    shardCapacity = capacityBytes / shardCount;
+}
+
+tile_cache::shard& tile_cache::shard_of(uint64_t key) const {
+    return *shards[mix_bits(key) % shards.size()];
+}
+
+std::shared_ptr<const texture_tile> tile_cache::find(shard& s, uint64_t key) {
+    std::lock_guard lock(s.mutex);
+    auto it = s.index.find(key);
+    if (it == s.index.end()) {
+        s.misses++;
+        return nullptr;
+    }
+    s.hits++;
+    s.lru.splice(s.lru.begin(), s.lru, it->second);
+    return it->second->tile;
+}
+
+std::shared_ptr<const texture_tile> tile_cache::insert(shard& s, uint64_t key,
+                                                       std::shared_ptr<const texture_tile> tile) {
+    if (!tile) return nullptr;
+    std::lock_guard lock(s.mutex);
+    auto it = s.index.find(key);
+    if (it != s.index.end()) return it->second->tile;
+
+    // The newest tile always stays, even in a shard too small for it.
+    s.bytes += tile_bytes(*tile);
+    while (s.bytes > shardCapacity && !s.lru.empty()) {
+        s.bytes -= tile_bytes(*s.lru.back().tile);
+        s.index.erase(s.lru.back().key);
+        s.lru.pop_back();
+        s.evictions++;
+    }
+    s.lru.push_front({key, tile});
+    s.index.emplace(key, s.lru.begin());
+    return tile;
+}
+
+tile_cache_stats tile_cache::stats() const {
+    tile_cache_stats result;
+    for (const auto& s : shards) {
+        std::lock_guard lock(s->mutex);
+        result.hits += s->hits;
+        result.misses += s->misses;
+        result.evictions += s->evictions;
+        result.resident_bytes += s->bytes;
+    }
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Texels of one tile of one MIP level, RGB interleaved.
+struct texture_tile {
+    std::vector<float> rgb;
+};
+
+struct tile_cache_stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t resident_bytes = 0;
+};
+
+// Fixed-size cache of texture tiles shared by all textures, so memory
+// stays bounded however large the textures are. Keys are split into
+// shards by hash, each with its own lock and least-recently-used list,
+// which keeps render threads from contending on one lock. Tiles are
+// handed out by shared_ptr, so an evicted tile lives on until its last
+// reader lets go.
+class tile_cache {
+public:
+    explicit tile_cache(size_t capacityBytes, int shardCount = 16);
+
+    // Key prefix for a new texture; the rest of the key is the texture's own.
+    uint64_t register_texture() { return uint64_t(nextTexture++) << 40; }
+
+    // The tile for key, loaded with load() on a miss. Loading runs without
+    // the lock, so a tile two threads miss at once is read twice and
+    // cached once.
+    template <typename F>
+    std::shared_ptr<const texture_tile> get(uint64_t key, F&& load) {
+        shard& s = shard_of(key);
+        if (std::shared_ptr<const texture_tile> tile = find(s, key)) return tile;
+        return insert(s, key, load());
+    }
+
+    size_t capacity() const { return shardCapacity * shards.size(); }
+    tile_cache_stats stats() const;
+
+private:
+    struct entry {
+        uint64_t key;
+        std::shared_ptr<const texture_tile> tile;
+    };
+
+    struct shard {
+        mutable std::mutex mutex;
+        // Most recently used first.
+        std::list<entry> lru;
+        std::unordered_map<uint64_t, std::list<entry>::iterator> index;
+        size_t bytes = 0;
+        uint64_t hits = 0, misses = 0, evictions = 0;
+    };
+
+    std::vector<std::unique_ptr<shard>> shards;
+    size_t shardCapacity;
+    std::atomic<uint32_t> nextTexture{0};
+
+    shard& shard_of(uint64_t key) const;
+    std::shared_ptr<const texture_tile> find(shard& s, uint64_t key);
+    std::shared_ptr<const texture_tile> insert(shard& s, uint64_t key, std::shared_ptr<const texture_tile> tile);
+};
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "allocation_counter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+static std::atomic<uint64_t> allocations{0};
+static thread_local uint64_t threadAllocations = 0;
+
+static void count_allocation() {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    threadAllocations++;
+}
+
+uint64_t allocation_count() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t thread_allocation_count() {
+    return threadAllocations;
+}
+
+static void* allocate(std::size_t size) {
+    count_allocation();
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+static void* allocate(std::size_t size, std::align_val_t alignment) {
+    count_allocation();
+    std::size_t a = std::max(std::size_t(alignment), sizeof(void*));
+#if !defined(_WIN32)
+    // aligned_alloc wants a multiple of the alignment.
+    void* p = std::aligned_alloc(a, (std::max<std::size_t>(size, 1) + a - 1) / a * a);
+#else
+    void* p = _aligned_malloc(std::max<std::size_t>(size, 1), a);
+#endif
+    if (p) return p;
+    throw std::bad_alloc();
+}
+
+static void free_aligned(void* p) {
+#if !defined(_WIN32)
+    std::free(p);
+#else
+    _aligned_free(p);
+#endif
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocate(size, alignment); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    count_allocation();
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    count_allocation();
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free_aligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free_aligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { free_aligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { free_aligned(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+// Heap allocations through operator new, which this module replaces to
+// count them: all threads together, and the calling thread alone. Taking
+// the thread's count before and after a piece of work tells whether that
+// work allocated.
+uint64_t allocation_count();
+uint64_t thread_allocation_count();
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "arena.h"
+
+#include <algorithm>
+
+void* memory_arena::allocate(size_t size, size_t alignment) {
+    size = std::max<size_t>(size, 1);
+    while (current < blocks.size()) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(blocks[current].data.get());
+        size_t aligned = (base + offset + alignment - 1) / alignment * alignment - base;
+        if (aligned + size <= blocks[current].size) {
+            offset = aligned + size;
+            return blocks[current].data.get() + aligned;
+        }
+        // Later blocks are kept from earlier peaks; one too small for this
+        // allocation is skipped until the next release.
+        current++;
+        offset = 0;
+    }
+
+    // new[] of bytes only guarantees fundamental alignment; pad for more.
+    size_t padded = size + std::max(alignment, alignof(std::max_align_t)) - alignof(std::max_align_t);
+    blocks.push_back({std::make_unique<std::byte[]>(std::max(blockSize, padded)), std::max(blockSize, padded)});
+    current = blocks.size() - 1;
+    offset = 0;
+    return allocate(size, alignment);
+}
+
+size_t memory_arena::capacity() const {
+    size_t total = 0;
+    for (const block& b : blocks)
+        total += b.size;
+    return total;
+}
+
+memory_arena& thread_arena() {
+    static thread_local memory_arena arena;
+    return arena;
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for scratch data that dies together. Blocks are kept when
+// allocations are released, so once a workload has grown the arena to its
+// peak, repeating it never touches the heap again.
+class memory_arena {
+public:
+    explicit memory_arena(size_t blockSize = size_t(256) << 10) : blockSize(blockSize) {}
+
+    memory_arena(const memory_arena&) = delete;
+    memory_arena& operator=(const memory_arena&) = delete;
+
+    // count value-initialized objects. Nothing is destroyed on release, so
+    // only trivially destructible types are allowed.
+    template <typename T>
+    std::span<T> alloc(size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>);
+        T* data = static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        for (size_t i = 0; i < count; i++)
+            new (data + i) T();
+        return {data, count};
+    }
+
+    struct position {
+        size_t block = 0;
+        size_t offset = 0;
+    };
+
+    position mark() const { return {current, offset}; }
+    // Frees everything allocated since mark was taken.
+    void release(position mark) {
+        current = mark.block;
+        offset = mark.offset;
+    }
+    void reset() { release({}); }
+
+    size_t capacity() const;
+
+    // Releases everything allocated in its lifetime. Scopes nest, so a
+    // thread that runs another task while waiting on its own keeps its
+    // scratch data intact.
+    class scope {
+    public:
+        explicit scope(memory_arena& arena) : arena(arena), start(arena.mark()) {}
+        ~scope() { arena.release(start); }
+
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+
+    private:
+        memory_arena& arena;
+        position start;
+    };
+
+private:
+    struct block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    size_t blockSize;
+    std::vector<block> blocks;
+    size_t current = 0;
+    size_t offset = 0;
+
+    void* allocate(size_t size, size_t alignment);
+};
+
+// Arena of the calling thread.
+memory_arena& thread_arena();
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include "hash.h"
+
+#include <render/thread_pool.h>
+
+#include <cstring>
+#include <vector>
+
+static constexpr size_t hash_chunk = 1 << 20;
+
+static uint64_t hash_chunk_bytes(const std::byte* data, size_t size, uint64_t seed) {
+    uint64_t h = mix_bits(seed ^ size);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ mix_bits(word)) * 0x9e3779b97f4a7c15ull;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    return mix_bits(h ^ tail);
+}
+
+uint64_t hash_bytes(std::span<const std::byte> data, uint64_t seed) {
+    if (data.size() <= hash_chunk) return hash_chunk_bytes(data.data(), data.size(), seed);
+
+    int64_t chunks = int64_t((data.size() + hash_chunk - 1) / hash_chunk);
+    std::vector<uint64_t> hashes(chunks);
+    parallel_for(0, chunks, 1, [&](int64_t c) {
+        size_t begin = size_t(c) * hash_chunk;
+        hashes[c] = hash_chunk_bytes(data.data() + begin, std::min(hash_chunk, data.size() - begin), seed + c);
+    });
+
+    uint64_t h = mix_bits(seed ^ data.size());
+    for (uint64_t chunkHash : hashes)
+        h = mix_bits(h ^ chunkHash) * 0x9e3779b97f4a7c15ull;
+    return mix_bits(h);
+}
\ No newline at end of file
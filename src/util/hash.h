@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// SplitMix64 finalizer.
+inline uint64_t mix_bits(uint64_t v) {
+    v ^= v >> 31;
+    v *= 0x7fb5d329728ea185ull;
+    v ^= v >> 27;
+    v *= 0x81dadef4bc2dd44dull;
+    v ^= v >> 33;
+    return v;
+}
+
+// 64-bit content hash. Large inputs are hashed in fixed-size chunks on the
+// thread pool and combined in order, so the result never depends on the
+// thread count.
+uint64_t hash_bytes(std::span<const std::byte> data, uint64_t seed = 0);
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::optional<file_stamp> stamp_file(const std::string& path) {
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(path, error);
+    if (error) return {};
+    auto time = std::filesystem::last_write_time(path, error);
+    if (error) return {};
+    return file_stamp{size, int64_t(time.time_since_epoch().count())};
+}
+
+std::shared_ptr<const mapped_file> mapped_file::open(const std::string& path) {
+    std::shared_ptr<mapped_file> file(new mapped_file());
+
+#if !defined(_WIN32)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat info {};
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    file->length = size_t(info.st_size);
+    if (file->length > 0) {
+        void* p = mmap(nullptr, file->length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            return nullptr;
+        }
+        file->base = static_cast<std::byte*>(p);
+        file->mapped = true;
+    }
+    ::close(fd);
+#else
+    // No mapping on this platform; fall back to reading the file in.
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return nullptr;
+    file->length = size_t(in.tellg());
+    file->base = new std::byte[file->length];
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(file->base), std::streamsize(file->length));
+    if (!in) return nullptr;
+#endif
+
+    return file;
+}
+
+void mapped_file::evict(size_t offset, size_t size) const {
+#if !defined(_WIN32)
+    if (!mapped) return;
+    size_t page = size_t(sysconf(_SC_PAGESIZE));
+    size_t begin = (offset + page - 1) / page * page;
+    size_t end = std::min(offset + size, length) / page * page;
+    if (end > begin) madvise(base + begin, end - begin, MADV_DONTNEED);
+#endif
+}
+
+mapped_file::~mapped_file() {
+#if !defined(_WIN32)
+    if (mapped) munmap(base, length);
+#else
+    delete[] base;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+
+struct file_stamp {
+    uint64_t size;
+    int64_t mtime;
+};
+
+std::optional<file_stamp> stamp_file(const std::string& path);
+
+// Read-only view of a whole file. Pages are mapped lazily by the OS, so
+// opening a large file costs nothing until its bytes are touched.
+class mapped_file {
+public:
+    static std::shared_ptr<const mapped_file> open(const std::string& path);
+    ~mapped_file();
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    const std::byte* data() const { return base; }
+    size_t size() const { return length; }
+    std::span<const std::byte> bytes() const { return {base, length}; }
+
+    // Hints that a range will not be read again, letting the OS drop its
+    // pages from this process (they are reread from the file if touched).
+    void evict(size_t offset, size_t size) const;
+
+private:
+    mapped_file() = default;
+
+    std::byte* base = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+};
\ No newline at end of file
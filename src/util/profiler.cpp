@@ -0,0 +1,190 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace profiling {
+
+struct trace_event {
+    profile_stage stage;
+    int64_t arg;
+    int64_t start_ns;
+    int64_t end_ns;
+};
+
+// Owned by one thread, which is the only writer; others read the atomics
+// (relaxed, so writes stay plain adds) and the events once it is idle.
+struct thread_state {
+    int id = 0;
+    thread_counters counters;
+    struct stage_state {
+        std::atomic<uint64_t> calls{0};
+        std::atomic<int64_t> total_ns{0};
+        std::atomic<int64_t> max_ns{0};
+    } stages[size_t(profile_stage::count)];
+    std::vector<trace_event> events;
+    std::atomic<uint64_t> dropped{0};
+};
+
+}
+
+namespace {
+
+constexpr size_t max_events_per_thread = size_t(1) << 18;
+
+std::mutex registryMutex;
+// States outlive their threads so their counts survive a pool restart.
+std::vector<std::unique_ptr<profiling::thread_state>> registry;
+std::atomic<bool> tracing{false};
+const auto epoch = std::chrono::steady_clock::now();
+
+template <typename T>
+void bump(std::atomic<T>& value, T n) {
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+}
+
+profiling::thread_state& profiling::this_thread() {
+    static thread_local thread_state* state = [] {
+        std::lock_guard lock(registryMutex);
+        registry.push_back(std::make_unique<thread_state>());
+        registry.back()->id = int(registry.size());
+        current_counters = &registry.back()->counters;
+        return registry.back().get();
+    }();
+    return *state;
+}
+
+profiling::thread_counters& profiling::register_thread() {
+    return this_thread().counters;
+}
+
+int64_t profiling::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void profiling::record(thread_state& state, profile_stage stage, int64_t arg, int64_t startNs, int64_t endNs) {
+    thread_state::stage_state& s = state.stages[size_t(stage)];
+    int64_t duration = endNs - startNs;
+    bump(s.calls, uint64_t(1));
+    bump(s.total_ns, duration);
+    if (duration > s.max_ns.load(std::memory_order_relaxed)) s.max_ns.store(duration, std::memory_order_relaxed);
+
+    if (!tracing.load(std::memory_order_relaxed)) return;
+    if (state.events.size() == max_events_per_thread) {
+        bump(state.dropped, uint64_t(1));
+        return;
+    }
+    // Reserved in one go so that recording does not allocate as it grows.
+    if (state.events.capacity() == 0) state.events.reserve(max_events_per_thread);
+    state.events.push_back({stage, arg, startNs, endNs});
+}
+
+const char* profile_counter_name(profile_counter c) {
+    static const char* names[] = {"rays", "shadow rays", "BVH nodes", "primitive tests", "samples"};
+    static_assert(std::size(names) == size_t(profile_counter::count));
+    return names[size_t(c)];
+}
+
+const char* profile_stage_name(profile_stage s) {
+    static const char* names[] = {"tile", "camera samples", "trace", "wave generate", "wave intersect", "wave shade",
+                                  "wave shadow", "wave compact", "film add", "resolve", "image write"};
+    static_assert(std::size(names) == size_t(profile_stage::count));
+    return names[size_t(s)];
+}
+
+void set_profile_tracing(bool enabled) {
+    tracing = enabled;
+}
+
+profile_totals collect_profile() {
+    profile_totals totals;
+    std::lock_guard lock(registryMutex);
+    for (const auto& state : registry) {
+        for (size_t i = 0; i < size_t(profile_counter::count); i++)
+            totals.counters[i] += state->counters.values[i].load(std::memory_order_relaxed);
+        for (size_t i = 0; i < size_t(profile_stage::count); i++) {
+            totals.stages[i].calls += state->stages[i].calls.load(std::memory_order_relaxed);
+            totals.stages[i].total_ns += state->stages[i].total_ns.load(std::memory_order_relaxed);
+            totals.stages[i].max_ns = std::max(totals.stages[i].max_ns,
+                                               state->stages[i].max_ns.load(std::memory_order_relaxed));
+        }
+        totals.dropped_events += state->dropped.load(std::memory_order_relaxed);
+    }
+    return totals;
+}
+
+void reset_profile() {
+    std::lock_guard lock(registryMutex);
+    for (const auto& state : registry) {
+        for (auto& c : state->counters.values)
+            c.store(0, std::memory_order_relaxed);
+        for (auto& s : state->stages) {
+            s.calls.store(0, std::memory_order_relaxed);
+            s.total_ns.store(0, std::memory_order_relaxed);
+            s.max_ns.store(0, std::memory_order_relaxed);
+        }
+        state->events.clear();
+        state->dropped.store(0, std::memory_order_relaxed);
+    }
+}
+
+void print_profile_summary(std::FILE* out, double wallSeconds) {
+    profile_totals totals = collect_profile();
+    std::fprintf(out, "%-16s %14s %12s\n", "counter", "total", "per second");
+    for (size_t i = 0; i < size_t(profile_counter::count); i++) {
+        std::fprintf(out, "%-16s %14llu %12.3g\n", profile_counter_name(profile_counter(i)),
+                     (unsigned long long) totals.counters[i], double(totals.counters[i]) / wallSeconds);
+    }
+    // Stage times are summed over threads, so they can exceed the wall time.
+    std::fprintf(out, "%-16s %10s %12s %12s %12s\n", "stage", "calls", "thread ms", "mean us", "max us");
+    for (size_t i = 0; i < size_t(profile_stage::count); i++) {
+        const profile_totals::stage_total& s = totals.stages[i];
+        if (!s.calls) continue;
+        std::fprintf(out, "%-16s %10llu %12.2f %12.2f %12.2f\n", profile_stage_name(profile_stage(i)),
+                     (unsigned long long) s.calls, double(s.total_ns) * 1e-6,
+                     double(s.total_ns) * 1e-3 / double(s.calls), double(s.max_ns) * 1e-3);
+    }
+    if (totals.dropped_events)
+        std::fprintf(out, "%llu trace events dropped\n", (unsigned long long) totals.dropped_events);
+}
+
+bool write_chrome_trace(const std::string& path) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+    profile_totals totals = collect_profile();
+
+    out << "{\"displayTimeUnit\": \"ms\", \"otherData\": {";
+    for (size_t i = 0; i < size_t(profile_counter::count); i++)
+        out << (i ? ", " : "") << '"' << profile_counter_name(profile_counter(i)) << "\": " << totals.counters[i];
+    out << "},\n\"traceEvents\": [\n";
+
+    std::lock_guard lock(registryMutex);
+    bool first = true;
+    char line[256];
+    for (const auto& state : registry) {
+        std::snprintf(line, sizeof(line),
+                      "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"thread %d\"}}",
+                      first ? "" : ",\n", state->id, state->id);
+        out << line;
+        first = false;
+        for (const profiling::trace_event& e : state->events) {
+            // Microseconds, as the format expects.
+            int n = std::snprintf(line, sizeof(line),
+                                  ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+                                  profile_stage_name(e.stage), state->id, double(e.start_ns) * 1e-3,
+                                  double(e.end_ns - e.start_ns) * 1e-3);
+            out.write(line, n);
+            if (e.arg >= 0) out << ", \"args\": {\"index\": " << e.arg << "}";
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    return bool(out);
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Hot-path instrumentation: event counters and scoped stage timers kept per
+// thread, so recording never takes a lock. Building
+// with RENDERER_INSTRUMENTATION=0 turns every call into a no-op.
+#if !defined(RENDERER_INSTRUMENTATION)
+#define RENDERER_INSTRUMENTATION 1
+#endif
+
+inline constexpr bool profiling_enabled = RENDERER_INSTRUMENTATION != 0;
+
+enum class profile_counter : uint8_t {
+    rays,
+    shadow_rays,
+    bvh_nodes,
+    primitive_tests,
+    samples,
+    count
+};
+
+enum class profile_stage : uint8_t {
+    // One tile of a progressive pass; its trace event carries the tile.
+    tile,
+    // Within a tile: choosing camera samples, then tracing and shading them.
+    camera_samples,
+    trace,
+    // Wavefront integrator stages.
+    wave_generate,
+    wave_intersect,
+    wave_shade,
+    wave_shadow,
+    wave_compact,
+    film_add,
+    resolve,
+    image_write,
+    count
+};
+
+const char* profile_counter_name(profile_counter c);
+const char* profile_stage_name(profile_stage s);
+
+namespace profiling {
+    // Written only by their thread, so adds are a relaxed load and store;
+    // other threads read them when collecting.
+    struct thread_counters {
+        std::atomic<uint64_t> values[size_t(profile_counter::count)] = {};
+    };
+    struct thread_state;
+
+    // Counting stays inline: one thread-local load and an add.
+    inline thread_local thread_counters* current_counters = nullptr;
+    thread_counters& register_thread();
+    inline thread_counters& this_thread_counters() {
+        thread_counters* counters = current_counters;
+        return counters ? *counters : register_thread();
+    }
+    inline void add(thread_counters& counters, profile_counter c, uint64_t n) {
+        std::atomic<uint64_t>& value = counters.values[size_t(c)];
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    thread_state& this_thread();
+    void record(thread_state& state, profile_stage stage, int64_t arg, int64_t startNs, int64_t endNs);
+    int64_t now_ns();
+}
+
+inline void profile_count(profile_counter c, uint64_t n = 1) {
+    if constexpr (profiling_enabled) profiling::add(profiling::this_thread_counters(), c, n);
+}
+
+// Counter total of the calling thread; the difference across a piece of
+// work is what that work counted.
+inline uint64_t profile_thread_count(profile_counter c) {
+    if constexpr (profiling_enabled)
+        return profiling::this_thread_counters().values[size_t(c)].load(std::memory_order_relaxed);
+    return 0;
+}
+
+// Times its lifetime as one call of stage; arg (a tile index, say) shows
+// up in the trace event when not negative.
+class profile_scope {
+public:
+    explicit profile_scope(profile_stage stage, int64_t arg = -1) {
+        if constexpr (profiling_enabled) {
+            this->stage = stage;
+            this->arg = arg;
+            start = profiling::now_ns();
+        }
+    }
+    ~profile_scope() {
+        if constexpr (profiling_enabled) profiling::record(profiling::this_thread(), stage, arg, start, profiling::now_ns());
+    }
+
+    profile_scope(const profile_scope&) = delete;
+    profile_scope& operator=(const profile_scope&) = delete;
+
+private:
+    profile_stage stage{};
+    int64_t arg = -1;
+    int64_t start = 0;
+};
+
+// Nodes and primitives one BVH traversal visits, added to the thread's
+// counters when it goes out of scope. Traversal counts locally so the hot
+// loop never touches thread-local storage.
+class traversal_tally {
+public:
+    void node() {
+        if constexpr (profiling_enabled) nodes++;
+    }
+    void primitives(size_t n) {
+        if constexpr (profiling_enabled) tested += uint32_t(n);
+    }
+    ~traversal_tally() {
+        if constexpr (profiling_enabled) {
+            if (!nodes) return;
+            profiling::thread_counters& counters = profiling::this_thread_counters();
+            profiling::add(counters, profile_counter::bvh_nodes, nodes);
+            profiling::add(counters, profile_counter::primitive_tests, tested);
+        }
+    }
+
+private:
+    uint32_t nodes = 0;
+    uint32_t tested = 0;
+};
+
+// Trace events are only kept while recording, up to a fixed number per
+// thread; stage totals are always kept.
+void set_profile_tracing(bool enabled);
+
+struct profile_totals {
+    uint64_t counters[size_t(profile_counter::count)] = {};
+    struct stage_total {
+        uint64_t calls = 0;
+        int64_t total_ns = 0;
+        int64_t max_ns = 0;
+    } stages[size_t(profile_stage::count)];
+    uint64_t dropped_events = 0;
+};
+
+// Sums over every thread. Only meaningful while no thread is recording.
+profile_totals collect_profile();
+// Zeroes the counters and timers and drops recorded events.
+void reset_profile();
+
+void print_profile_summary(std::FILE* out, double wallSeconds);
+// Chrome trace-event JSON (chrome://tracing, Perfetto) of the recorded
+// events, one track per thread, with the counter totals in the metadata.
+bool write_chrome_trace(const std::string& path);
\ No newline at end of file